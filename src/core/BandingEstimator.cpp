@@ -23,7 +23,8 @@
 #include "models/HKY85Model.hpp"
 #include "models/AminoacidSubstitutionModel.hpp"
 #include "models/NegativeBinomialGapModel.hpp"
-#include "hmm/DpMatrixFull.hpp"
+#include <algorithm>
+#include <numeric>
 
 namespace EBC
 {
@@ -32,6 +33,7 @@ BandingEstimator::ProgressBar::ProgressBar(unsigned int width) : bw(width) {
 }
 
 void BandingEstimator::ProgressBar::tick() {
+	lock_guard<mutex> guard(tickLock);
 	curr++;
 
 	if ( (curr != n) && (curr % (n/100+1) != 0) ) return;
@@ -56,9 +58,11 @@ void BandingEstimator::ProgressBar::done(){
 }
 
 BandingEstimator::BandingEstimator(Definitions::AlgorithmType at, Sequences* inputSeqs, Definitions::ModelType model ,std::vector<double> indel_params,
-		std::vector<double> subst_params, Definitions::OptimizationType ot, unsigned int rateCategories, double alpha, GuideTree* g) :
+		std::vector<double> subst_params, Definitions::OptimizationType ot, unsigned int rateCategories, double alpha, GuideTree* g,
+		unsigned int threads, Definitions::DivergenceOptimizerType dot) :
 				inputSequences(inputSeqs), gammaRateCategories(rateCategories), pairCount(inputSequences->getPairCount()),
-				/*hmms(pairCount), bands(pairCount),*/ divergenceTimes(pairCount), algorithm(at), gt(g)
+				/*hmms(pairCount), bands(pairCount),*/ divergenceTimes(pairCount), singlePrecisionTimes(pairCount, -1.0), algorithm(at), gt(g), threadCount(threads),
+				optimizerType(dot)
 {
 	//Banding estimator means banding enabled!
 
@@ -139,10 +143,21 @@ BandingEstimator::BandingEstimator(Definitions::AlgorithmType at, Sequences* inp
 
 	EvolutionaryPairHMM *hmm;
 
-	numopt = new BrentOptimizer(modelParams, NULL);
+	numopt = createOptimizer(modelParams);
 
 }
 
+Definitions::ShortPairMode BandingEstimator::shortPairMode = Definitions::ShortPairMode::PairByPair;
+
+bool BandingEstimator::comparePrecision = false;
+
+BrentOptimizer* BandingEstimator::createOptimizer(OptimizedModelParameters* mp)
+{
+	if (optimizerType == Definitions::DivergenceOptimizerType::Newton)
+		return new NewtonOptimizer(mp, NULL);
+	return new BrentOptimizer(mp, NULL);
+}
+
 BandingEstimator::~BandingEstimator()
 {
 	//for(auto hmm : hmms)
@@ -156,78 +171,344 @@ BandingEstimator::~BandingEstimator()
     delete substModel;
 }
 
-void BandingEstimator::optimizePairByPair()
+double BandingEstimator::estimatePairCost(unsigned int pairIdx)
+{
+	std::pair<unsigned int, unsigned int> idxs = inputSequences->getPairOfSequenceIndices(pairIdx);
+	double len1 = inputSequences->getSequencesAt(idxs.first)->size();
+	double len2 = inputSequences->getSequencesAt(idxs.second)->size();
+	return len1 * len2 * BandCalculator::getBandCoverage(gt->getDistanceMatrix()->getDistance(idxs.first,idxs.second));
+}
+
+void BandingEstimator::optimizePair(unsigned int i, OptimizedModelParameters* mp, BrentOptimizer* opt, PairHmmCalculationWrapper* wrapper,
+		DpWorkspace* ws)
 {
 	EvolutionaryPairHMM* hmm;
 	Band* band;
-	DistanceMatrix* dm = gt->getDistanceMatrix();
-	PairHmmCalculationWrapper* wrapper = new PairHmmCalculationWrapper();
 	double result;
 
-	ProgressBar pb(80);
-	pb.setIter(pairCount);
+	DEBUG("Optimizing distance for pair #" << i);
+	std::pair<unsigned int, unsigned int> idxs = inputSequences->getPairOfSequenceIndices(i);
+	INFO("Running pairwise calculator for sequence id " << idxs.first << " and " << idxs.second
+			<< " ,number " << i+1 <<" out of " << pairCount << " pairs" );
+	//screening runs stay on the k-mer diagonal band, the posterior refinement costs more than the Viterbi optimization
+	BandCalculator* bc = new BandCalculator(inputSequences->getSequencesAt(idxs.first), inputSequences->getSequencesAt(idxs.second),
+			substModel, indelModel, gt->getDistanceMatrix()->getDistance(idxs.first,idxs.second),
+			algorithm == Definitions::AlgorithmType::Forward, ws);
+	band = bc->getBand();
+	double startTime = bc->getClosestDistance();
+	if (algorithm == Definitions::AlgorithmType::ViterbiForward)
+	{
+		DEBUG("Screening the pairwise divergence time with integer Viterbi...");
+		ViterbiPairHMM* viterbi = new ViterbiPairHMM(inputSequences->getSequencesAt(idxs.first), inputSequences->getSequencesAt(idxs.second),
+				substModel, indelModel, Definitions::DpMatrixType::Rolling, band);
+		hmm = viterbi;
+		hmm->setWorkspace(ws);
+		wrapper->setTargetHMM(hmm);
+		wrapper->setModelParameters(mp);
+		mp->setUserDivergenceParams({startTime});
+		opt->setTarget(wrapper);
+		opt->setAccuracy(bc->getBrentAccuracy());
+		opt->setBounds(bc->getLeftBound(), bc->getRightBound() < 0 ? mp->divergenceBound : bc->getRightBound());
+		opt->optimize();
+		startTime = mp->getDivergenceTime(0);
+		DEBUG("Viterbi distance " << startTime << " used as the forward starting point");
+
+		//the forward iterations only need the cells around the Viterbi path, not the whole k-mer band
+		viterbi->setDivergenceTimeAndCalculateModels(startTime);
+		viterbi->runAlgorithmWithAlignment();
+		Band* pathBand = viterbi->createPathBand(Definitions::viterbiPathBandDelta);
+		delete hmm;
+		delete band;
+		band = pathBand;
+	}
 
-	for(unsigned int i =0; i< pairCount; i++)
+	auto createHMM = [&](Band* bnd) -> EvolutionaryPairHMM*
 	{
-		DEBUG("Optimizing distance for pair #" << i);
-		std::pair<unsigned int, unsigned int> idxs = inputSequences->getPairOfSequenceIndices(i);
-		INFO("Running pairwise calculator for sequence id " << idxs.first << " and " << idxs.second
-				<< " ,number " << i+1 <<" out of " << pairCount << " pairs" );
-		BandCalculator* bc = new BandCalculator(inputSequences->getSequencesAt(idxs.first), inputSequences->getSequencesAt(idxs.second),
-				substModel, indelModel, gt->getDistanceMatrix()->getDistance(idxs.first,idxs.second));
-		band = bc->getBand();
+		EvolutionaryPairHMM* created;
 		if (algorithm == Definitions::AlgorithmType::Viterbi)
 		{
 			DEBUG("Creating Viterbi algorithm to optimize the pairwise divergence time...");
-			hmm = new ViterbiPairHMM(inputSequences->getSequencesAt(idxs.first), inputSequences->getSequencesAt(idxs.second),
-					substModel, indelModel, Definitions::DpMatrixType::Full, band);
+			//distance only - banded integer scores, no traceback
+			created = new ViterbiPairHMM(inputSequences->getSequencesAt(idxs.first), inputSequences->getSequencesAt(idxs.second),
+					substModel, indelModel, Definitions::DpMatrixType::Rolling, bnd);
 		}
-		else if (algorithm == Definitions::AlgorithmType::Forward)
+		else
 		{
 			DEBUG("Creating forward algorithm to optimize the pairwise divergence time...");
-			hmm = new ForwardPairHMM(inputSequences->getSequencesAt(idxs.first), inputSequences->getSequencesAt(idxs.second),
-					substModel, indelModel, Definitions::DpMatrixType::Full, band);
+			//only the likelihood is needed - keep two band columns instead of whole matrices
+			created = new ForwardPairHMM(inputSequences->getSequencesAt(idxs.first), inputSequences->getSequencesAt(idxs.second),
+					substModel, indelModel, Definitions::DpMatrixType::Rolling, bnd);
 		}
+		created->setWorkspace(ws);
+		return created;
+	};
 
-		//hmm->setDivergenceTimeAndCalculateModels(modelParams->getDivergenceTime(0)); //zero as there's only one pair!
+	hmm = createHMM(band);
 
-		//LikelihoodSurfacePlotter lsp;
-		//lsp.setTargetHMM(hmm);
-		//lsp.getLikelihoodSurface();
+	//hmm->setDivergenceTimeAndCalculateModels(modelParams->getDivergenceTime(0)); //zero as there's only one pair!
 
+	//LikelihoodSurfacePlotter lsp;
+	//lsp.setTargetHMM(hmm);
+	//lsp.getLikelihoodSurface();
+
+
+	wrapper->setTargetHMM(hmm);
+	DUMP("Set model parameter in the hmm...");
+	wrapper->setModelParameters(mp);
+	mp->setUserDivergenceParams({startTime});
+	opt->setTarget(wrapper);
+	opt->setAccuracy(bc->getBrentAccuracy());
+	opt->setBounds(bc->getLeftBound(), bc->getRightBound() < 0 ? mp->divergenceBound : bc->getRightBound());
 
-		wrapper->setTargetHMM(hmm);
-		DUMP("Set model parameter in the hmm...");
-		wrapper->setModelParameters(modelParams);
-		modelParams->setUserDivergenceParams({bc->getClosestDistance()});
-		numopt->setTarget(wrapper);
-		numopt->setAccuracy(bc->getBrentAccuracy());
-		numopt->setBounds(bc->getLeftBound(), bc->getRightBound() < 0 ? modelParams->divergenceBound : bc->getRightBound());
 
+	result = opt->optimize() * -1.0;
+	DEBUG("Likelihood after pairwise optimization: " << result);
 
-		result = numopt->optimize() * -1.0;
+	//the band misses every alignment - optimize again on wider diagonal bands, the last try unbanded
+	double coverage = BandCalculator::getBandCoverage(gt->getDistanceMatrix()->getDistance(idxs.first,idxs.second));
+	while (result <= (Definitions::minMatrixLikelihood /2.0) && band != nullptr)
+	{
+		coverage *= 2.0;
+		DEBUG("Optimization failed for pair #" << i << " Zero probability FWD, widening the band to coverage " << coverage);
+		delete hmm;
+		delete band;
+		band = coverage < 1.0 ? new Band(inputSequences->getSequencesAt(idxs.first)->size(),
+				inputSequences->getSequencesAt(idxs.second)->size(), coverage) : nullptr;
+		hmm = createHMM(band);
+		wrapper->setTargetHMM(hmm);
+		mp->setUserDivergenceParams({startTime});
+		result = opt->optimize() * -1.0;
 		DEBUG("Likelihood after pairwise optimization: " << result);
-		if (result <= (Definitions::minMatrixLikelihood /2.0))
+	}
+	//each pair owns its slot, no locking needed
+	this->divergenceTimes[i] = mp->getDivergenceTime(0);
+
+	//same band and starting point in single precision, the distance matrix keeps the double result
+	if (comparePrecision && algorithm != Definitions::AlgorithmType::Viterbi && hmm->getPrecision() == Definitions::DpPrecision::Double)
+	{
+		hmm->setPrecision(Definitions::DpPrecision::Single);
+		mp->setUserDivergenceParams({startTime});
+		opt->optimize();
+		this->singlePrecisionTimes[i] = mp->getDivergenceTime(0);
+		DEBUG("Pair #" << i << " divergence time double " << this->divergenceTimes[i] << " single " << this->singlePrecisionTimes[i]);
+	}
+
+	delete band;
+	delete bc;
+	delete hmm;
+}
+
+bool BandingEstimator::useBatchedPairs()
+{
+	//the batched kernel has no single precision variant
+	if (algorithm != Definitions::AlgorithmType::Forward || shortPairMode == Definitions::ShortPairMode::PairByPair || comparePrecision)
+		return false;
+
+	vector<unsigned int> lengths(inputSequences->getSequenceCount());
+	for(unsigned int i = 0; i < lengths.size(); i++)
+		lengths[i] = inputSequences->getSequencesAt(i)->size();
+	nth_element(lengths.begin(), lengths.begin() + lengths.size()/2, lengths.end());
+	return lengths[lengths.size()/2] < Definitions::shortSequenceBatchLength;
+}
+
+void BandingEstimator::optimizePairsBatched(ProgressBar& pb)
+{
+	const unsigned int lanes = BatchedForwardPairHMM::lanes;
+	const unsigned int batchCount = (pairCount + lanes - 1) / lanes;
+	unsigned int workers = max(1u, min(threadCount, batchCount));
+
+	DEBUG("Optimizing pairwise distances in batches of " << lanes << " pairs using " << workers << " threads");
+
+	//similar sizes next to each other, the lanes of a batch share the padded matrix
+	vector<double> costs(pairCount);
+	vector<unsigned int> order(pairCount);
+	for(unsigned int i =0; i< pairCount; i++)
+	{
+		std::pair<unsigned int, unsigned int> idxs = inputSequences->getPairOfSequenceIndices(i);
+		costs[i] = inputSequences->getSequencesAt(idxs.first)->size() * (double) inputSequences->getSequencesAt(idxs.second)->size();
+	}
+	iota(order.begin(), order.end(), 0);
+	stable_sort(order.begin(), order.end(), [&costs](unsigned int a, unsigned int b) {return costs[a] > costs[b];});
+
+	vector<BatchedForwardPairHMM*> engines(workers);
+	for(unsigned int w = 0; w < workers; w++)
+		engines[w] = new BatchedForwardPairHMM(substModel, indelModel);
+
+	auto optimizeBatch = [&](unsigned int w, unsigned int b)
+	{
+		vector<BatchedForwardPairHMM::SequencePair> pairs;
+		vector<Band*> bands;
+		vector<BrentSearch> searches;
+		vector<double> times;
+		unsigned int first = b*lanes;
+		unsigned int count = min(lanes, pairCount - first);
+		unsigned int remaining = count;
+
+		for(unsigned int l = 0; l < count; l++)
 		{
-			DEBUG("Optimization failed for pair #" << i << " Zero probability FWD");
-			band->output();
-			dynamic_cast<DpMatrixFull*>(hmm->M->getDpMatrix())->outputValuesWithBands(band->getMatchBand() ,band->getInsertBand(),band->getDeleteBand(),'|', '-');
-			dynamic_cast<DpMatrixFull*>(hmm->X->getDpMatrix())->outputValuesWithBands(band->getInsertBand(),band->getMatchBand() ,band->getDeleteBand(),'\\', '-');
-			dynamic_cast<DpMatrixFull*>(hmm->Y->getDpMatrix())->outputValuesWithBands(band->getDeleteBand(),band->getMatchBand() ,band->getInsertBand(),'\\', '|');
+			std::pair<unsigned int, unsigned int> idxs = inputSequences->getPairOfSequenceIndices(order[first+l]);
+			pairs.push_back(std::make_pair(inputSequences->getSequencesAt(idxs.first), inputSequences->getSequencesAt(idxs.second)));
+			//k-mer distance start and diagonal band, no posterior refinement - the bounds and accuracy of a pair optimized on its own
+			double time = gt->getDistanceMatrix()->getDistance(idxs.first,idxs.second);
+			double coverage = max(BandCalculator::getBandCoverage(time), static_cast<double>(Definitions::batchedMinBandCoverage));
+			bands.push_back(new Band(pairs.back().first->size(), pairs.back().second->size(), coverage));
+			searches.push_back(BrentSearch(time, Definitions::almostZero, modelParams->divergenceBound, Definitions::highDivergenceAccuracyDelta));
+			times.push_back(time);
 		}
-		this->divergenceTimes[i] = modelParams->getDivergenceTime(0);
+		engines[w]->setPairs(pairs, bands);
 
-		pb.tick();
+		vector<bool> active(count, true);
+		while(remaining > 0)
+		{
+			vector<double> lnls = engines[w]->runAlgorithm(times);
+			for(unsigned int l = 0; l < count; l++)
+			{
+				//converged lanes keep their minimum until the whole batch is done
+				if (active[l] && !searches[l].step(lnls[l], times[l]))
+				{
+					active[l] = false;
+					times[l] = searches[l].getMinimum();
+					remaining--;
+				}
+			}
+		}
 
-		delete band;
-		delete bc;
-		delete hmm;
+		//each pair owns its slot, no locking needed
+		for(unsigned int l = 0; l < count; l++)
+		{
+			this->divergenceTimes[order[first+l]] = searches[l].getMinimum();
+			DEBUG("Likelihood after pairwise optimization of pair #" << order[first+l] << " : " << -searches[l].getMinimumValue());
+			pb.tick();
+		}
+		for(auto band : bands)
+			delete band;
+	};
+
+	if (workers == 1)
+	{
+		for(unsigned int b = 0; b < batchCount; b++)
+			optimizeBatch(0, b);
+	}
+	else
+	{
+		vector<unsigned int> batches(batchCount);
+		iota(batches.begin(), batches.end(), 0);
+		WorkStealingPool pool(workers);
+		pool.submit(batches);
+		pool.run(optimizeBatch);
+	}
+
+	for(unsigned int w = 0; w < workers; w++)
+		delete engines[w];
+}
+
+void BandingEstimator::optimizePairByPair()
+{
+	ProgressBar pb(80);
+	pb.setIter(pairCount);
+
+	if (useBatchedPairs())
+	{
+		optimizePairsBatched(pb);
+	}
+	else if (threadCount <= 1)
+	{
+		PairHmmCalculationWrapper* wrapper = new PairHmmCalculationWrapper();
+		DpWorkspace* ws = new DpWorkspace();
+		for(unsigned int i =0; i< pairCount; i++)
+		{
+			optimizePair(i, modelParams, numopt, wrapper, ws);
+			pb.tick();
+		}
+		delete ws;
+		delete wrapper;
+	}
+	else
+	{
+		unsigned int workers = min(threadCount, pairCount);
+		DEBUG("Optimizing pairwise distances using " << workers << " threads");
+
+		//longest pairs first
+		vector<double> costs(pairCount);
+		vector<unsigned int> order(pairCount);
+		for(unsigned int i =0; i< pairCount; i++)
+			costs[i] = estimatePairCost(i);
+		iota(order.begin(), order.end(), 0);
+		stable_sort(order.begin(), order.end(), [&costs](unsigned int a, unsigned int b) {return costs[a] > costs[b];});
+
+		//each worker gets its own copy of the parameters and the optimizer
+		//the substitution and indel models are not modified at this stage and are shared
+		vector<OptimizedModelParameters*> wParams(workers);
+		vector<BrentOptimizer*> wOptimizers(workers);
+		vector<PairHmmCalculationWrapper*> wWrappers(workers);
+		vector<DpWorkspace*> wWorkspaces(workers);
+		for(unsigned int w = 0; w < workers; w++)
+		{
+			wParams[w] = new OptimizedModelParameters(*modelParams);
+			wOptimizers[w] = createOptimizer(wParams[w]);
+			wWrappers[w] = new PairHmmCalculationWrapper();
+			wWorkspaces[w] = new DpWorkspace();
+		}
+
+		//busy workers hold their cores, those out of pairs lend them to the tiled dp of the remaining long pairs
+		WavefrontScheduler::claimThreads(workers-1);
+		WorkStealingPool pool(workers);
+		pool.submit(order);
+		pool.run([&](unsigned int w, unsigned int i)
+		{
+			optimizePair(i, wParams[w], wOptimizers[w], wWrappers[w], wWorkspaces[w]);
+			pb.tick();
+		},
+		[](unsigned int w)
+		{
+			WavefrontScheduler::releaseThreads(1);
+		});
+		//back on the calling thread only
+		WavefrontScheduler::claimThreads(1);
+
+		for(unsigned int w = 0; w < workers; w++)
+		{
+			delete wWorkspaces[w];
+			delete wWrappers[w];
+			delete wOptimizers[w];
+			delete wParams[w];
+		}
 	}
 
 	pb.done();
 
 	INFO("Optimized divergence times:");
 	INFO(this->divergenceTimes);
+
+	if (comparePrecision)
+		reportPrecisionError();
+}
+
+void BandingEstimator::reportPrecisionError()
+{
+	double maxError = 0;
+	double sumError = 0;
+	unsigned int count = 0;
+
+	for(unsigned int i = 0; i < pairCount; i++)
+	{
+		if (singlePrecisionTimes[i] < 0 || divergenceTimes[i] <= 0)
+			continue;
+		double error = fabs(singlePrecisionTimes[i] - divergenceTimes[i]) / divergenceTimes[i];
+		maxError = max(maxError, error);
+		sumError += error;
+		count++;
+	}
+
+	if (count == 0)
+	{
+		cout << "No pairs compared in single precision" << endl;
+		return;
+	}
+	cout << "Single vs double precision divergence times of " << count << " pairs, max relative error "
+			<< maxError << ", mean " << sumError / count << endl;
+	INFO("Single precision divergence times:");
+	INFO(this->singlePrecisionTimes);
 }
 
 
@@ -34,7 +34,10 @@
 #include "core/HmmException.hpp"
 #include "core/Optimizer.hpp"
 #include "core/BrentOptimizer.hpp"
+#include "core/NewtonOptimizer.hpp"
 #include "core/PairHmmCalculationWrapper.hpp"
+#include "core/WorkStealingPool.hpp"
+#include "core/WavefrontScheduler.hpp"
 
 #include "models/SubstitutionModelBase.hpp"
 #include "models/IndelModel.hpp"
@@ -44,10 +47,12 @@
 #include "heuristics/Band.hpp"
 
 #include "hmm/ForwardPairHMM.hpp"
+#include "hmm/BatchedForwardPairHMM.hpp"
 #include "hmm/ViterbiPairHMM.hpp"
 
 #include <vector>
 #include <sstream>
+#include <mutex>
 
 using namespace std;
 
@@ -69,6 +74,8 @@ private:
 		unsigned int n;
 		//current iter;
 		unsigned int curr;
+		//workers tick concurrently
+		mutex tickLock;
 	public:
 		ProgressBar(unsigned int width);
 		void tick();
@@ -101,16 +108,48 @@ protected:
 
 	unsigned int pairCount;
 
+	//worker threads for the pairwise stage
+	unsigned int threadCount;
+
+	//pairwise divergence time optimizer
+	Definitions::DivergenceOptimizerType optimizerType;
+
 	//vector<EvolutionaryPairHMM*> hmms;
 	//delete bands in the destructor
 	//vector<Band*> bands;
 	vector<double> divergenceTimes;
 
+	//the same pairs optimized in single precision, negative if not compared
+	vector<double> singlePrecisionTimes;
+
 	OptimizedModelParameters* modelParams;
 
+	//optimize a single pair using the supplied optimizer objects and DP scratch memory (one set per worker thread)
+	void optimizePair(unsigned int pairIdx, OptimizedModelParameters* mp, BrentOptimizer* opt, PairHmmCalculationWrapper* wrapper,
+			DpWorkspace* ws);
+
+	//a new divergence time optimizer of the requested type
+	BrentOptimizer* createOptimizer(OptimizedModelParameters* mp);
+
+	//approximate DP cost of a pair - len1 x len2 x band coverage
+	double estimatePairCost(unsigned int pairIdx);
+
+	//short sequences - pairs of similar size share SIMD lanes, forward on k-mer bands and one Brent search per lane
+	bool useBatchedPairs();
+	void optimizePairsBatched(ProgressBar& pb);
+
+	//max and mean relative error of the single precision divergence times
+	void reportPrecisionError();
+
 public:
+	static Definitions::ShortPairMode shortPairMode;
+
+	//optimize every pair again in single precision and report the divergence time error
+	static bool comparePrecision;
+
 	BandingEstimator(Definitions::AlgorithmType at, Sequences* inputSeqs, Definitions::ModelType model,std::vector<double> indel_params,
-			std::vector<double> subst_params, Definitions::OptimizationType ot, unsigned int rateCategories, double alpha, GuideTree* gt);
+			std::vector<double> subst_params, Definitions::OptimizationType ot, unsigned int rateCategories, double alpha, GuideTree* gt,
+			unsigned int threads = 1, Definitions::DivergenceOptimizerType dot = Definitions::DivergenceOptimizerType::Brent);
 
 	virtual ~BandingEstimator();
 
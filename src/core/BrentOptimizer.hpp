@@ -34,6 +34,34 @@
 
 namespace EBC {
 
+//Brent's method driven from the outside, one function value at a time.
+//Several searches can advance in lock-step when their objectives are evaluated together
+class BrentSearch
+{
+protected:
+	double a, b, x, v, w, u, d, e;
+	double fx, fv, fw;
+	double epsilon;
+	int counter;
+	bool started;
+
+public:
+	//x0 is the first point to evaluate
+	BrentSearch(double x0, double leftEnd, double rightEnd, double accuracy);
+
+	//f is the value at the point handed out last, returns false once converged
+	//otherwise next is set to the point to evaluate
+	bool step(double f, double& next);
+
+	double getMinimum() const {
+		return x;
+	}
+
+	double getMinimumValue() const {
+		return fx;
+	}
+};
+
 class BrentOptimizer
 {
 protected:
@@ -46,7 +74,8 @@ protected:
 
 public:
 	BrentOptimizer(OptimizedModelParameters* mp, IOptimizable* opt, double accuracy=Definitions::accuracyBFGS);
-	double optimize();
+	virtual ~BrentOptimizer() {}
+	virtual double optimize();
 	void setTarget(IOptimizable* opt);
 	double objectiveFunction(double x);
 
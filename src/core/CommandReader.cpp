@@ -50,6 +50,30 @@ CommandReader::CommandReader(int argc, char** argv)
 
 		parser.add_option("estimateAlpha", "Specify to estimate discrete Gamma shape parameter alpha 0|1, default is 1",1 );
 
+		parser.add_option("threads", "Specify the number of threads used to estimate pairwise distances, spare threads split the dp of long pairs, default is 1",1 );
+
+		parser.add_option("forward", "Specify the forward algorithm kernel scalar|wavefront|scaled|interleaved (M/X/Y of a cell in one AVX register, avx2/avx512 builds only), default is wavefront",1);
+
+		parser.add_option("logsum", "Specify the log-sum-exp evaluation exact|approx (table based, max abs error 3.2e-10), default is exact",1);
+
+		parser.add_option("optimizer", "Specify the pairwise divergence optimizer brent|newton (analytic derivatives, fewer evaluations, distances within ~1% of brent), default is brent",1);
+
+		parser.add_option("algorithm", "Specify the pairwise distance algorithm forward|viterbi (integer scores, fast screening)|viterbi-forward (forward started from the viterbi distance), default is forward",1);
+
+		parser.add_option("precision", "Specify the forward DP precision double|single (float cells, double scaling and sums), default is double",1);
+
+		parser.add_option("precisionCheck", "Report the divergence time error of single vs double precision, every pair is optimized in both (one pair at a time, no batching)");
+
+		parser.add_option("pages", "Specify the DP matrix memory standard|transparent (transparent huge pages)|huge (reserved 2MB pages), huge pages are Linux only, default is standard",1);
+
+		parser.add_option("shortPairs", "Specify how pairs of short sequences are optimized single|batched (SIMD lanes on k-mer bands, distances may differ from single), default is single",1);
+
+		parser.add_option("posteriors", "Specify how the forward and backward passes of the posteriors run sequential|concurrent (two threads if one is spare), default is concurrent",1);
+
+		parser.add_option("nearIdentical", "Specify the band of near-identical pairs general|anchored (a few cells around shared k-mers, general if the posteriors reach its edges), default is general",1);
+
+		parser.add_option("ambiguousRuns", "Specify how the forward handles runs of N or X symbols cells|transfer (one step across the run, distances may differ slightly), default is transfer",1);
+
 		parser.add_option("lE", "log error");
 		parser.add_option("lW", "log warning");
 		parser.add_option("lI", "log info");
@@ -104,6 +128,41 @@ CommandReader::CommandReader(int argc, char** argv)
 
 		parser.check_option_arg_range("estimateAlpha", 0, 1);
 		parser.check_option_arg_range("rateCat", 0, 1000);
+		parser.check_option_arg_range("threads", 1, 1024);
+
+#if defined(__AVX__)
+		const char* forwardKernels[] = {"scalar", "wavefront", "scaled", "interleaved"};
+#else
+		const char* forwardKernels[] = {"scalar", "wavefront", "scaled"};
+#endif
+		parser.check_option_arg_range("forward", forwardKernels);
+
+		const char* logSumModes[] = {"exact", "approx"};
+		parser.check_option_arg_range("logsum", logSumModes);
+
+		const char* optimizers[] = {"brent", "newton"};
+		parser.check_option_arg_range("optimizer", optimizers);
+
+		const char* algorithms[] = {"forward", "viterbi", "viterbi-forward"};
+		parser.check_option_arg_range("algorithm", algorithms);
+
+		const char* precisions[] = {"double", "single"};
+		parser.check_option_arg_range("precision", precisions);
+
+		const char* pageModes[] = {"standard", "transparent", "huge"};
+		parser.check_option_arg_range("pages", pageModes);
+
+		const char* shortPairModes[] = {"single", "batched"};
+		parser.check_option_arg_range("shortPairs", shortPairModes);
+
+		const char* posteriorModes[] = {"sequential", "concurrent"};
+		parser.check_option_arg_range("posteriors", posteriorModes);
+
+		const char* nearIdenticalModes[] = {"general", "anchored"};
+		parser.check_option_arg_range("nearIdentical", nearIdenticalModes);
+
+		const char* ambiguousRunModes[] = {"cells", "transfer"};
+		parser.check_option_arg_range("ambiguousRuns", ambiguousRunModes);
 
 
 	}
@@ -106,6 +106,104 @@ public:
 		return get_option(parser,"rateCat",4);
 	}
 
+	unsigned int getThreadCount()
+	{
+		return get_option(parser,"threads",1);
+	}
+
+	Definitions::ForwardKernelType getForwardKernel()
+	{
+		string kernel = get_option(parser,"forward","wavefront");
+		if (kernel == "scalar")
+			return Definitions::ForwardKernelType::Scalar;
+		if (kernel == "scaled")
+			return Definitions::ForwardKernelType::Scaled;
+		if (kernel == "interleaved")
+			return Definitions::ForwardKernelType::Interleaved;
+		return Definitions::ForwardKernelType::Wavefront;
+	}
+
+	Definitions::LogSumAccuracy getLogSumAccuracy()
+	{
+		string mode = get_option(parser,"logsum","exact");
+		if (mode == "approx")
+			return Definitions::LogSumAccuracy::Approximate;
+		return Definitions::LogSumAccuracy::Exact;
+	}
+
+	Definitions::DivergenceOptimizerType getDivergenceOptimizer()
+	{
+		string optimizer = get_option(parser,"optimizer","brent");
+		if (optimizer == "newton")
+			return Definitions::DivergenceOptimizerType::Newton;
+		return Definitions::DivergenceOptimizerType::Brent;
+	}
+
+	Definitions::AlgorithmType getAlgorithm()
+	{
+		string algorithm = get_option(parser,"algorithm","forward");
+		if (algorithm == "viterbi")
+			return Definitions::AlgorithmType::Viterbi;
+		if (algorithm == "viterbi-forward")
+			return Definitions::AlgorithmType::ViterbiForward;
+		return Definitions::AlgorithmType::Forward;
+	}
+
+	bool checkPrecision()
+	{
+		return parser.option("precisionCheck");
+	}
+
+	Definitions::DpPrecision getPrecision()
+	{
+		string precision = get_option(parser,"precision","double");
+		if (precision == "single")
+			return Definitions::DpPrecision::Single;
+		return Definitions::DpPrecision::Double;
+	}
+
+	Definitions::DpPageMode getPageMode()
+	{
+		string pages = get_option(parser,"pages","standard");
+		if (pages == "transparent")
+			return Definitions::DpPageMode::Transparent;
+		if (pages == "huge")
+			return Definitions::DpPageMode::Huge;
+		return Definitions::DpPageMode::Standard;
+	}
+
+	Definitions::ShortPairMode getShortPairMode()
+	{
+		string mode = get_option(parser,"shortPairs","single");
+		if (mode == "batched")
+			return Definitions::ShortPairMode::Batched;
+		return Definitions::ShortPairMode::PairByPair;
+	}
+
+	Definitions::PosteriorMode getPosteriorMode()
+	{
+		string mode = get_option(parser,"posteriors","concurrent");
+		if (mode == "sequential")
+			return Definitions::PosteriorMode::Sequential;
+		return Definitions::PosteriorMode::Concurrent;
+	}
+
+	Definitions::NearIdenticalMode getNearIdenticalMode()
+	{
+		string mode = get_option(parser,"nearIdentical","general");
+		if (mode == "anchored")
+			return Definitions::NearIdenticalMode::Anchored;
+		return Definitions::NearIdenticalMode::General;
+	}
+
+	Definitions::AmbiguousRunMode getAmbiguousRunMode()
+	{
+		string mode = get_option(parser,"ambiguousRuns","transfer");
+		if (mode == "cells")
+			return Definitions::AmbiguousRunMode::Cells;
+		return Definitions::AmbiguousRunMode::Transfer;
+	}
+
 	bool estimateAlpha()
 	{
 		int res = get_option(parser,"estimateAlpha",1);
@@ -72,6 +72,21 @@ public:
 	//for band calculations
 	constexpr static const double bandPosteriorLikelihoodLimit = -3;
 	constexpr static const double bandPosteriorLikelihoodDelta = -9;
+	//posterior mass of the band edge cells in a column above which the search band is widened there
+	constexpr static const double bandEdgeMassLimit = 1e-4;
+	//widen and recompute the search band at most this many times
+	constexpr static const unsigned int bandWideningRounds = 3;
+	//near-identical pairs - an anchor chain is tried below this k-mer distance
+	constexpr static const double anchoredKmerDistance = 0.1;
+	//fraction of the longer sequence the chained anchors must cover
+	constexpr static const double anchoredMinCoverage = 0.8;
+	//rows on both sides of the anchor chain, narrower bands leave edge mass on pairs a few percent apart
+	constexpr static const int anchoredBandDelta = 7;
+	//anchor k-mer sizes, long enough to be unique in a few kb of sequence
+	constexpr static const unsigned int anchorKmerSizeNuc = 12;
+	constexpr static const unsigned int anchorKmerSizeAa = 5;
+	//rows on both sides of the Viterbi path that viterbi-forward runs the forward optimization on
+	constexpr static const int viterbiPathBandDelta = 16;
 
 	constexpr static const double normalDivergenceAccuracyDelta = 1e-3;
 
@@ -85,6 +100,15 @@ public:
 
 	constexpr static const int BrentMaxIter = 100;
 
+	//below this median sequence length pairs are optimized in lock-step SIMD batches
+	constexpr static const unsigned int shortSequenceBatchLength = 150;
+	//narrowest diagonal band of a batched lane - without the posterior refinement the k-mer band misses end gaps of short pairs
+	constexpr static const double batchedMinBandCoverage = 0.3;
+
+	//integer Viterbi - finest score quantization (units per nat) and the largest magnitude a path score may reach
+	constexpr static const double viterbiScoreScale = 65536.0;
+	constexpr static const int viterbiScoreRange = 1 << 28;
+
 	//band factor default for intial fwd likelihood calculations
 	constexpr static const double narrowBandFactor = 0.1;
 	constexpr static const double initialBandFactor = 0.33;
@@ -132,6 +156,25 @@ public:
 
 	constexpr static const double minMatrixLikelihood = -1000000.0;
 
+	//dp matrix arenas start on a cache line and pad their rows to whole cache lines
+	constexpr static const size_t dpArenaAlignment = 64;
+	//huge page size, arenas asking for huge pages are aligned and rounded up to it
+	constexpr static const size_t hugePageSize = 2*1024*1024;
+	//smaller arenas never use huge pages - they would waste most of the page
+	constexpr static const size_t hugePageMinArena = 4*1024*1024;
+	//edge of the dp tiles that the threads of one long pair calculate in wavefront order
+	constexpr static const unsigned int wavefrontTileSize = 256;
+	//dp cells of a pair (band cells if banded) from which spare threads split it into tiles
+	constexpr static const double wavefrontMinCells = 4e6;
+	//Brent needs 2-3 times the evaluations of Newton - long pairs switch to it from this many threads besides the main one
+	constexpr static const unsigned int wavefrontBrentMinThreads = 3;
+	//dp cells of a pair below which a second thread for its forward and backward passes costs more than it saves
+	constexpr static const double concurrentPosteriorMinCells = 2e5;
+	//shortest run of fully ambiguous symbols (N, X) that the forward may cross in one transfer step
+	constexpr static const unsigned int ambiguousRunMinLength = 32;
+	//multiply-adds of the transfer kernel that take as long as one state of one dp cell
+	constexpr static const double ambiguousRunCellCost = 6.0;
+
 
 	constexpr static const unsigned int HKY85ParamCount = 1;
 	constexpr static const unsigned int GTRParamCount = 5;
@@ -159,9 +202,44 @@ public:
 
 	enum OptimizationType {BFGS, BOBYQA};
 
-	enum AlgorithmType {Forward, Viterbi, MLE};
+	//ViterbiForward - forward optimization started from the integer Viterbi distance
+	enum AlgorithmType {Forward, Viterbi, MLE, ViterbiForward};
+
+	enum DpMatrixType {Full, Limited, Banded, Rolling, FullFloat};
+
+	enum ForwardKernelType {Scalar, Wavefront, Scaled, Interleaved};
+
+	enum LogSumAccuracy {Exact, Approximate};
+
+	enum DivergenceOptimizerType {Brent, Newton};
+
+	enum DpPrecision {Double, Single};
+
+	//backing memory of the dp matrix arenas
+	//Standard - aligned heap memory
+	//Transparent - huge page aligned, advised to the kernel for transparent huge pages (Linux)
+	//Huge - explicit 2MB pages from the huge page pool, transparent ones if the pool is empty (Linux)
+	enum DpPageMode {Standard, Transparent, Huge};
+
+	//pairs of short sequences
+	//PairByPair - banded, one pair at a time like the longer ones
+	//Batched - pairs of similar size in the lanes of one SIMD forward, each lane on its k-mer band
+	enum ShortPairMode {PairByPair, Batched};
+
+	//forward and backward passes of the posterior calculations
+	//Sequential - one after the other on the calling thread
+	//Concurrent - on two threads when a core is spare, posteriors combined segment by segment
+	enum PosteriorMode {Sequential, Concurrent};
+
+	//bands of near-identical pairs
+	//General - k-mer diagonal band refined by posteriors at several divergence times, as for any pair
+	//Anchored - ultra-narrow band along a chain of shared k-mers, checked by one posterior pass
+	enum NearIdenticalMode {General, Anchored};
 
-	enum DpMatrixType {Full, Limited};
+	//runs of fully ambiguous symbols in the likelihood-only forward
+	//Cells - dp over every cell like any other symbol
+	//Transfer - one doubling-step transfer across a run where it needs fewer operations than the cells
+	enum AmbiguousRunMode {Cells, Transfer};
 
 	enum StateId {Match, Insert , Delete};
 
@@ -34,7 +34,10 @@ double EBC::DistanceMatrix::getDistance(unsigned int i, unsigned int j)
 {
 	double dst = 0;
 
-	dst = this->distances[make_pair(i,j)];
+	//lookup only - this is called concurrently by the pairwise workers
+	auto it = this->distances.find(make_pair(i,j));
+	if (it != this->distances.end())
+		dst = it->second;
 
 	//DEBUG("Distance matrix getting distance");
 
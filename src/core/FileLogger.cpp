@@ -23,6 +23,7 @@ namespace EBC
 {
 
 std::ofstream FileLogger::logFile;
+std::mutex FileLogger::logLock;
 
 FileLogger FileLogger::errL;
 FileLogger FileLogger::wrnL;
@@ -25,6 +25,7 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <mutex>
 
 using namespace std;
 
@@ -141,6 +142,7 @@ public:
 
 		if(logger.active)
 		{
+			lock_guard<mutex> guard(logLock);
 			logFile << param;
 			if (logger.stderrout)
 				std::cerr << param;
@@ -154,6 +156,7 @@ public:
 	{
 		if (v.size() != 0 && logger.active)
 		{
+			lock_guard<mutex> guard(logLock);
 			for(unsigned int i = 0; i < v.size(); i++)
 			{
 				logFile << v[i] << "\t\t";
@@ -182,6 +185,8 @@ private:
 	static FileLogger dmpL;
 	static FileLogger infL;
 	static std::ofstream logFile;
+	//pairwise estimation may log from several threads
+	static std::mutex logLock;
 };
 
 }
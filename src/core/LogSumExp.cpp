@@ -0,0 +1,44 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+
+#include "core/LogSumExp.hpp"
+
+namespace EBC
+{
+
+Definitions::LogSumAccuracy LogSumExp::accuracy = Definitions::LogSumAccuracy::Exact;
+
+double LogSumExp::table[2*LogSumExp::tableSize+2];
+
+bool LogSumExp::initialized = LogSumExp::initializeTable();
+
+bool LogSumExp::initializeTable()
+{
+	//one spare node so that the interpolation never reads past the end
+	for(unsigned int k = 0; k <= tableSize; k++)
+	{
+		double x = k * tableStep;
+		table[2*k] = log1p(exp(-x));
+		table[2*k+1] = -tableStep / (1.0 + exp(x));
+	}
+	return true;
+}
+
+} /* namespace EBC */
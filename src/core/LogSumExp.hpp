@@ -0,0 +1,140 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+
+#ifndef CORE_LOGSUMEXP_HPP_
+#define CORE_LOGSUMEXP_HPP_
+
+#include <cmath>
+#include <algorithm>
+
+#include "core/Definitions.hpp"
+#include "core/VectorMaths.hpp"
+
+namespace EBC
+{
+
+//log(exp(a)+exp(b)) and log(exp(a)+exp(b)+exp(c)) for the DP kernels.
+//
+//Exact      - libm log1p/exp in the scalar path, Cephes exp/log (~1 ulp) in the SIMD path.
+//             Returns max(a,b) once exp(-|a-b|) underflows.
+//Approximate - log1p(exp(-d)) from a cubic Hermite table with step 1/32 on [0, 37);
+//             maximum absolute error 3.2e-10 per pairwise sum (6.4e-10 for three terms),
+//             for d >= 37 the correction is below 1e-16 and max(a,b) is returned.
+class LogSumExp
+{
+public:
+
+	static constexpr double tableStep = 1.0/32.0;
+	static constexpr double tableRange = 37.0;
+	static constexpr unsigned int tableSize = 1185;
+	static constexpr double exactRange = 745.2;
+
+protected:
+
+	static Definitions::LogSumAccuracy accuracy;
+
+	//interleaved value and scaled derivative of log1p(exp(-x)) at x = k * tableStep
+	static double table[2*tableSize+2];
+
+	static bool initialized;
+
+	static bool initializeTable();
+
+	static inline double approximate(double d)
+	{
+		double t = d * (1.0/tableStep);
+		unsigned int k = static_cast<unsigned int>(t);
+		double u = t - k;
+		const double* node = table + 2*k;
+		double u2 = u*u;
+		double u3 = u2*u;
+		return (2*u3 - 3*u2 + 1) * node[0] + (u3 - 2*u2 + u) * node[1]
+			+ (3*u2 - 2*u3) * node[2] + (u3 - u2) * node[3];
+	}
+
+	//any double vector type, the vdouble SIMD lanes or a vstate cell
+	template<typename V>
+	static inline V approximate(V a, V b)
+	{
+		typedef decltype(a < b) L;
+		const unsigned int lanes = sizeof(V) / sizeof(double);
+
+		V m = VectorMaths::max(a,b);
+		V d = m - (a > b ? b : a);
+		L near = d < tableRange;
+		V t = (near ? d : VectorMaths::splat<V>(0.0)) * (1.0/tableStep);
+		L k = __builtin_convertvector(t, L);
+		V u = t - __builtin_convertvector(k, V);
+
+		V f0, d0, f1, d1;
+		for(unsigned int l = 0; l < lanes; l++)
+		{
+			const double* node = table + 2*k[l];
+			f0[l] = node[0];
+			d0[l] = node[1];
+			f1[l] = node[2];
+			d1[l] = node[3];
+		}
+
+		V u2 = u*u;
+		V u3 = u2*u;
+		V corr = (2*u3 - 3*u2 + 1) * f0 + (u3 - 2*u2 + u) * d0 + (3*u2 - 2*u3) * f1 + (u3 - u2) * d1;
+		return near ? m + corr : m;
+	}
+
+public:
+
+	static void setAccuracy(Definitions::LogSumAccuracy acc)
+	{
+		accuracy = acc;
+	}
+
+	static Definitions::LogSumAccuracy getAccuracy()
+	{
+		return accuracy;
+	}
+
+	static inline double logSum(double a, double b)
+	{
+		double m = a > b ? a : b;
+		double d = a > b ? a - b : b - a;
+
+		if (accuracy == Definitions::LogSumAccuracy::Approximate)
+			return d < tableRange ? m + approximate(d) : m;
+		return d < exactRange ? m + log1p(exp(-d)) : m;
+	}
+
+	static inline double logSum(double a, double b, double c)
+	{
+		return logSum(logSum(a,b),c);
+	}
+
+	template<typename V>
+	static inline V logSum(V a, V b, V c)
+	{
+		if (accuracy == Definitions::LogSumAccuracy::Approximate)
+			return approximate(approximate(a,b),c);
+		return VectorMaths::logSum(a,b,c);
+	}
+};
+
+} /* namespace EBC */
+
+#endif /* CORE_LOGSUMEXP_HPP_ */
@@ -21,6 +21,7 @@
 //==============================================================================
 
 #include "core/Maths.hpp"
+#include "core/LogSumExp.hpp"
 #include <iostream>
 
 namespace EBC
@@ -35,20 +36,12 @@ Maths::Maths()
 
 double Maths::logSum(double a, double b, double c)
 {
-	double partialSum = logSum(a,b);
-	return logSum(partialSum,c);
+	return LogSumExp::logSum(a,b,c);
 }
 
 double Maths::logSum(double a, double b)
 {
-	if (a > b)
-	{
-		return a + log(1+exp(b-a));
-	}
-	else
-	{
-		return b + log(1+exp(a-b));
-	}
+	return LogSumExp::logSum(a,b);
 }
 
 
@@ -0,0 +1,102 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+/*
+ * NewtonOptimizer.cpp
+ *
+ *  Safeguarded Newton-Raphson search for the pairwise divergence time
+ */
+
+#include <cmath>
+#include <limits>
+#include "core/NewtonOptimizer.hpp"
+
+namespace EBC {
+
+
+NewtonOptimizer::NewtonOptimizer(OptimizedModelParameters* mp,
+		IOptimizable* opt, double accuracy) : BrentOptimizer(mp, opt, accuracy)
+{
+	DEBUG("Newton numerical optimizer with 1" << " parameter created");
+}
+
+double NewtonOptimizer::objectiveFunction(double x, double& first, double& second)
+{
+	omp->setSingleDivergenceParam(0,x);
+	return static_cast<PairHmmCalculationWrapper*>(target)->runIterationWithDerivatives(first, second);
+}
+
+double NewtonOptimizer::optimize()
+{
+	PairHmmCalculationWrapper* wrapper = dynamic_cast<PairHmmCalculationWrapper*>(target);
+	if (wrapper == NULL || !wrapper->providesDerivatives())
+		return BrentOptimizer::optimize();
+
+	double a = leftBound;
+	double b = rightBound;
+	double x = omp->getDivergenceTime(0);
+	double ZEPS = numeric_limits<double>::epsilon() * 0.001;
+
+	double fx, first, second, u, tol;
+	double minLoc, fmin;
+	bool converged = false;
+
+	if (x <= a || x >= b)
+		x = 0.5*(a + b);
+
+	fmin = numeric_limits<double>::max();
+	minLoc = x;
+
+	for (int counter=0; counter < Definitions::BrentMaxIter; counter++)
+	{
+		fx = this->objectiveFunction(x, first, second);
+		if (fx < fmin)
+		{
+			fmin = fx;
+			minLoc = x;
+		}
+		if (converged)
+			break;
+
+		// -lnL increases to the right of x, the minimum lies to the left
+		(first > 0) ? b = x : a = x;
+
+		tol = ZEPS + (fabs(x)*accuracy);
+		if (b - a < 2.0*tol)
+			break;
+
+		u = 0.5*(a + b);
+		if (second > 0)
+		{
+			// Newton step, kept strictly inside the bracket
+			double d = -1.0*first/second;
+			if (x + d > a && x + d < b)
+			{
+				u = x + d;
+				// the last step is still taken - it is far more accurate than tol
+				converged = fabs(d) < tol;
+			}
+		}
+		x = u;
+	}
+
+	omp->setSingleDivergenceParam(0,minLoc);
+	return fmin;
+}
+
+} /* namespace EBC */
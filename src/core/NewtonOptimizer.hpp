@@ -0,0 +1,51 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+/*
+ * NewtonOptimizer.hpp
+ *
+ *  Safeguarded Newton-Raphson search for the pairwise divergence time
+ */
+
+#ifndef CORE_NEWTONOPTIMIZER_HPP_
+#define CORE_NEWTONOPTIMIZER_HPP_
+
+#include "core/BrentOptimizer.hpp"
+#include "core/PairHmmCalculationWrapper.hpp"
+
+
+namespace EBC {
+
+//Newton steps on the analytic derivatives of -lnL, bisection of the bracket [leftBound, rightBound]
+//whenever the step leaves it or the curvature is not positive.
+//Targets without derivatives are optimized with Brent's method
+class NewtonOptimizer : public BrentOptimizer
+{
+protected:
+
+	double objectiveFunction(double x, double& first, double& second);
+
+public:
+	NewtonOptimizer(OptimizedModelParameters* mp, IOptimizable* opt, double accuracy=Definitions::accuracyBFGS);
+
+	double optimize();
+};
+
+} /* namespace EBC */
+
+#endif /* CORE_NEWTONOPTIMIZER_HPP_ */
@@ -23,10 +23,12 @@
 namespace EBC
 {
 
-PMatrixDouble::PMatrixDouble(SubstitutionModelBase* m) : PMatrix(m)
+PMatrixDouble::PMatrixDouble(SubstitutionModelBase* m) : PMatrix(m), symbolCount(0)
 {
 	this->fastPairGammaPt = new double[matrixFullSize];
 	this->fastLogPairGammaPt = new double[matrixFullSize];
+	this->fastPairGammaPtDt = new double[matrixFullSize];
+	this->fastPairGammaPtDt2 = new double[matrixFullSize];
 	this->sitePatterns = new double*[matrixSize+1];
 	for (int i =0; i<= matrixSize; i++ )
 	{
@@ -39,6 +41,8 @@ PMatrixDouble::~PMatrixDouble()
 {
 	delete [] fastPairGammaPt;
 	delete [] fastLogPairGammaPt;
+	delete [] fastPairGammaPtDt;
+	delete [] fastPairGammaPtDt2;
 
 	for (int i =0; i<= matrixSize; i++ )
 	{
@@ -91,25 +95,68 @@ void PMatrixDouble::calculate()
 		}
 
 		calculatePairSitePatterns();
+		calculateSymbolEmissions();
 	}
 	else
 		throw HmmException("PMatrixDouble : attempting to calculate p(t) with t set to 0");
 }
 
 
-double PMatrixDouble::getPairTransition(array<unsigned int, 2>& nodes)
+void PMatrixDouble::calculateDerivatives()
 {
-	return getPairTransition(nodes[0],nodes[1]);
+	double* dt;
+	double* dt2;
+
+	std::fill(fastPairGammaPtDt, fastPairGammaPtDt+matrixFullSize, 0);
+	std::fill(fastPairGammaPtDt2, fastPairGammaPtDt2+matrixFullSize, 0);
+
+	for(unsigned int i = 0; i< rateCategories; i++)
+	{
+		dt = this->model->calculatePtDerivative(time, 1, i);
+		dt2 = this->model->calculatePtDerivative(time, 2, i);
+		for (int j=0; j< matrixFullSize; j++)
+		{
+			fastPairGammaPtDt[j] += dt[j] * model->gammaFrequencies[i];
+			fastPairGammaPtDt2[j] += dt2[j] * model->gammaFrequencies[i];
+		}
+		delete [] dt;
+		delete [] dt2;
+	}
 }
 
-double PMatrixDouble::getPairTransition(unsigned int xi, unsigned int yi)
+void PMatrixDouble::addSymbols(vector<SequenceElement*>* sequence)
 {
-	return model->getEquilibriumFrequencies(xi) * fastPairGammaPt[xi*matrixSize+yi];
+	for(auto el : *sequence)
+	{
+		if (el->getMatrixIndex() >= symbols.size())
+			symbols.resize(el->getMatrixIndex()+1, nullptr);
+		symbols[el->getMatrixIndex()] = el;
+	}
+	symbolCount = symbols.size();
+
+	if (time != 0)
+		calculateSymbolEmissions();
 }
 
-double PMatrixDouble::getLogPairTransition(unsigned int xi, unsigned int yi)
+void PMatrixDouble::calculateSymbolEmissions()
 {
-	return model->getLogEquilibriumFrequencies(xi) + fastLogPairGammaPt[xi*matrixSize+yi];
+	//a long run of N or X costs one table entry instead of a class sum and a log per cell
+	logSymbolFreq.assign(symbolCount, 0.0);
+	logSymbolPair.assign(symbolCount*symbolCount, 0.0);
+	for(unsigned int a = 0; a < symbolCount; a++)
+	{
+		if (symbols[a] == nullptr)
+			continue;
+		logSymbolFreq[a] = getLogEquilibriumFreqClass(symbols[a]);
+		for(unsigned int b = 0; b < symbolCount; b++)
+			if (symbols[b] != nullptr)
+				logSymbolPair[a*symbolCount+b] = getLogPairTransitionClass(symbols[a], symbols[b]);
+	}
+}
+
+double PMatrixDouble::getPairTransition(array<unsigned int, 2>& nodes)
+{
+	return getPairTransition(nodes[0],nodes[1]);
 }
 
 double PMatrixDouble::getLogEquilibriumFreqClass(SequenceElement* se)
@@ -148,6 +195,25 @@ double PMatrixDouble::getLogPairTransitionClass(SequenceElement* se1, SequenceEl
 
 }
 
+double PMatrixDouble::getPairTransitionDerivativeClass(SequenceElement* se1, SequenceElement* se2, unsigned int order)
+{
+	auto sz1 = se1->getClassSize();
+	auto sz2 = se2->getClassSize();
+	auto ids1 = se1->getClassIndices();
+	auto ids2 = se2->getClassIndices();
+	double* derivative = order == 1 ? fastPairGammaPtDt : fastPairGammaPtDt2;
+	double res = 0;
+	double tcz;
+
+	for (unsigned short i = 0; i < sz1; i++){
+		tcz = 0;
+		for (unsigned short j = 0; j < sz2; j++)
+			tcz += derivative[ids1[i]*matrixSize+ids2[j]];
+		res += getEquilibriumFreq(ids1[i])*tcz;
+	}
+	return res;
+}
+
 void PMatrixDouble::summarize()
 {
 	cout << "P(t) matrix summary :" << endl;
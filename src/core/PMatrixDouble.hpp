@@ -41,16 +41,33 @@ protected:
 	double* fastPairGammaPt;
 	double* fastLogPairGammaPt;
 
+	//first and second time derivatives of the gamma averaged P(t)
+	double* fastPairGammaPtDt;
+	double* fastPairGammaPtDt2;
+
 	double ** sitePatterns;
 
+	//symbols and FASTA classes met in the sequences by matrix index, nullptr for the others
+	vector<SequenceElement*> symbols;
+	unsigned int symbolCount;
+
+	//class emissions of the registered symbols, rebuilt with P(t) so that DP cells only look them up
+	vector<double> logSymbolFreq;
+	vector<double> logSymbolPair;
+
 	void calculatePairSitePatterns();
 
+	void calculateSymbolEmissions();
+
 public:
 	PMatrixDouble(SubstitutionModelBase* m);
 	virtual ~PMatrixDouble();
 
 	void calculate();
 
+	//time derivatives of P(t) at the current time, needed by getPairTransitionDerivativeClass only
+	void calculateDerivatives();
+
 	inline double getPairSitePattern(unsigned int xi, unsigned int yi)
 	{
 		return sitePatterns[xi][yi];
@@ -58,14 +75,37 @@ public:
 
 	double getPairTransition(array<unsigned int, 2>& nodes);
 
-	double getPairTransition(unsigned int xi, unsigned int yi);
+	inline double getPairTransition(unsigned int xi, unsigned int yi)
+	{
+		return model->getEquilibriumFrequencies(xi) * fastPairGammaPt[xi*matrixSize+yi];
+	}
 
-	double getLogPairTransition(unsigned int xi, unsigned int yi);
+	inline double getLogPairTransition(unsigned int xi, unsigned int yi)
+	{
+		return model->getLogEquilibriumFrequencies(xi) + fastLogPairGammaPt[xi*matrixSize+yi];
+	}
 
 	double getLogEquilibriumFreqClass(SequenceElement* se);
 
 	double getLogPairTransitionClass(SequenceElement* se1, SequenceElement* se2);
 
+	//adds the symbols of a sequence to the emission tables
+	void addSymbols(vector<SequenceElement*>* sequence);
+
+	//table lookups of the class emissions, the symbols must have been added
+	inline double getLogEquilibriumFreqSymbol(SequenceElement* se)
+	{
+		return logSymbolFreq[se->getMatrixIndex()];
+	}
+
+	inline double getLogPairTransitionSymbol(SequenceElement* se1, SequenceElement* se2)
+	{
+		return logSymbolPair[se1->getMatrixIndex()*symbolCount + se2->getMatrixIndex()];
+	}
+
+	//linear space d/dt (order 1) or d2/dt2 (order 2) of the pair emission
+	double getPairTransitionDerivativeClass(SequenceElement* se1, SequenceElement* se2, unsigned int order);
+
 
 
 	void summarize();
@@ -19,6 +19,7 @@
 
 
 #include <core/PairHmmCalculationWrapper.hpp>
+#include "hmm/ForwardPairHMM.hpp"
 
 namespace EBC
 {
@@ -36,6 +37,17 @@ double PairHmmCalculationWrapper::runIteration() {
 	return this->phmm->runAlgorithm();
 }
 
+bool PairHmmCalculationWrapper::providesDerivatives() {
+	ForwardPairHMM* fwd = dynamic_cast<ForwardPairHMM*>(this->phmm);
+	return fwd != NULL && fwd->providesDerivatives();
+}
+
+double PairHmmCalculationWrapper::runIterationWithDerivatives(double& first, double& second) {
+
+	this->phmm->setDivergenceTimeAndCalculateModels(modelParams->getDivergenceTime(0));
+	return dynamic_cast<ForwardPairHMM*>(this->phmm)->runAlgorithmWithDerivatives(first, second);
+}
+
 void PairHmmCalculationWrapper::setTargetHMM(EvolutionaryPairHMM* hmm) {
 	this->phmm = hmm;
 }
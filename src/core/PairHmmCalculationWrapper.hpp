@@ -41,6 +41,12 @@ public:
 
 	double runIteration();
 
+	//true if the target HMM can evaluate the derivatives of -lnL w.r.t. the divergence time
+	bool providesDerivatives();
+
+	//-lnL with its first and second derivative w.r.t. the divergence time
+	double runIterationWithDerivatives(double& first, double& second);
+
 	void setTargetHMM(EvolutionaryPairHMM* hmm);
 	void setModelParameters(OptimizedModelParameters* mp);
 
@@ -35,6 +35,8 @@ void TransitionProbabilities::calculate()
 {
 	this->gapExtension = indelModel->calculateGapExtension(this->time);
 	this->gapOpening = indelModel->calculateGapOpening(this->time);
+	this->gapOpeningDt = indelModel->calculateGapOpeningDerivative(this->time, 1);
+	this->gapOpeningDt2 = indelModel->calculateGapOpeningDerivative(this->time, 2);
 }
 
 } /* namespace EBC */
@@ -33,6 +33,10 @@ protected:
 	double gapOpening;
 	double gapExtension;
 
+	//time derivatives of the gap opening probability
+	double gapOpeningDt;
+	double gapOpeningDt2;
+
 	double time;
 
 	IndelModel* indelModel;
@@ -54,6 +58,16 @@ public:
 		return gapOpening;
 	}
 
+	double getGapOpeningDt() const
+	{
+		return gapOpeningDt;
+	}
+
+	double getGapOpeningDt2() const
+	{
+		return gapOpeningDt2;
+	}
+
 	void setTime(double time)
 	{
 		this->time = time;
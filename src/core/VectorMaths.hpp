@@ -0,0 +1,193 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+
+#ifndef CORE_VECTORMATHS_HPP_
+#define CORE_VECTORMATHS_HPP_
+
+namespace EBC
+{
+
+//Lane-parallel log-space arithmetic on GCC vector extensions.
+//The lane count follows the instruction set the build targets:
+//8 doubles with AVX-512, 4 with AVX/AVX2, 2 with SSE2
+namespace VectorMaths
+{
+
+#if defined(__AVX512F__)
+constexpr unsigned int lanes = 8;
+#elif defined(__AVX__)
+constexpr unsigned int lanes = 4;
+#else
+constexpr unsigned int lanes = 2;
+#endif
+
+typedef double vdouble __attribute__ ((vector_size (lanes * sizeof(double))));
+typedef long long vlong __attribute__ ((vector_size (lanes * sizeof(long long))));
+
+//unaligned view used for loads and stores from plain double arrays
+typedef double vdoubleu __attribute__ ((vector_size (lanes * sizeof(double)), aligned (sizeof(double)), may_alias));
+
+inline vdouble broadcast(double val)
+{
+	vdouble res = {};
+	return res + val;
+}
+
+inline vdouble load(const double* ptr)
+{
+	return *reinterpret_cast<const vdoubleu*>(ptr);
+}
+
+inline void store(double* ptr, vdouble val)
+{
+	*reinterpret_cast<vdoubleu*>(ptr) = val;
+}
+
+#if defined(__AVX__)
+//one DP cell with the M, X and Y states in lanes 0-2 and a padding lane, a single ymm register
+typedef double vstate __attribute__ ((vector_size (4 * sizeof(double))));
+typedef long long vstatel __attribute__ ((vector_size (4 * sizeof(long long))));
+typedef double vstateu __attribute__ ((vector_size (4 * sizeof(double)), aligned (sizeof(double)), may_alias));
+
+inline vstate loadState(const double* ptr)
+{
+	return *reinterpret_cast<const vstateu*>(ptr);
+}
+
+inline void storeState(double* ptr, vstate val)
+{
+	*reinterpret_cast<vstateu*>(ptr) = val;
+}
+#endif
+
+//val in every lane of a vdouble or vstate
+template<typename V>
+inline V splat(double val)
+{
+	V res = {};
+	return res + val;
+}
+
+template<typename V>
+inline V max(V a, V b)
+{
+	return a > b ? a : b;
+}
+
+//Cephes exp - Pade approximation after range reduction by ln2
+//Returns 0 below -708
+template<typename V>
+inline V exp(V x)
+{
+	typedef decltype(x < x) L;
+	const double magic = 6755399441055744.0;	//1.5 * 2^52
+
+	L under = x < -708.0;
+	x = x < -708.0 ? splat<V>(-708.0) : x;
+	x = x > 709.0 ? splat<V>(709.0) : x;
+
+	V n = (x * 1.4426950408889634073599 + magic) - magic;
+
+	x = x - n * 6.93145751953125E-1;
+	x = x - n * 1.42860682030941723212E-6;
+
+	V xx = x * x;
+	V px = x * ((1.26177193074810590878E-4 * xx + 3.02994407707441961300E-2) * xx + 9.99999999999999999910E-1);
+	V qx = ((3.00198505138664455042E-6 * xx + 2.52448340349684104192E-3) * xx + 2.27265548208155028766E-1) * xx + 2.0;
+	x = 1.0 + 2.0 * (px / (qx - px));
+
+	//2^n assembled directly in the exponent field
+	L pow2n = reinterpret_cast<L>(n + (1023.0 + magic)) << 52;
+	x = x * reinterpret_cast<V>(pow2n);
+
+	return under ? splat<V>(0.0) : x;
+}
+
+//Cephes log - valid for positive normal arguments
+template<typename V>
+inline V log(V x)
+{
+	typedef decltype(x < x) L;
+	const double sqrth = 0.70710678118654752440;
+
+	L bits = reinterpret_cast<L>(x);
+	L expBits = ((bits >> 52) & 0x7ff) - 1022;
+	bits = (bits & 0x800fffffffffffffLL) | 0x3fe0000000000000LL;
+
+	V m = reinterpret_cast<V>(bits);
+	V e = __builtin_convertvector(expBits, V);
+
+	L small = m < sqrth;
+	e = small ? e - 1.0 : e;
+	x = small ? m + m - 1.0 : m - 1.0;
+
+	V z = x * x;
+	V px = ((((1.01875663804580931796E-4 * x + 4.97494994976747001425E-1) * x + 4.70579119878881725854E0) * x
+			+ 1.44989225341610930846E1) * x + 1.79368678507819816313E1) * x + 7.70838733755885391666E0;
+	V qx = ((((x + 1.12873587189167450590E1) * x + 4.52279145837532221105E1) * x + 8.29875266912776603211E1) * x
+			+ 7.11544750618134371524E1) * x + 2.31251620126765340583E1;
+
+	V y = x * (z * px / qx);
+	y = y - e * 2.121944400546905827679e-4;
+	y = y - 0.5 * z;
+	z = x + y;
+	return z + e * 0.693359375;
+}
+
+//log(exp(a) + exp(b) + exp(c)) in every lane
+template<typename V>
+inline V logSum(V a, V b, V c)
+{
+	V m = max(max(a,b),c);
+	return m + log(exp(a - m) + exp(b - m) + exp(c - m));
+}
+
+//int32 max-plus arithmetic, twice as many lanes as doubles in the same register width
+constexpr unsigned int intLanes = 2 * lanes;
+
+typedef int vint __attribute__ ((vector_size (intLanes * sizeof(int))));
+typedef int vintu __attribute__ ((vector_size (intLanes * sizeof(int)), aligned (sizeof(int)), may_alias));
+
+inline vint broadcastInt(int val)
+{
+	vint res = {};
+	return res + val;
+}
+
+inline vint load(const int* ptr)
+{
+	return *reinterpret_cast<const vintu*>(ptr);
+}
+
+inline void store(int* ptr, vint val)
+{
+	*reinterpret_cast<vintu*>(ptr) = val;
+}
+
+inline vint max(vint a, vint b)
+{
+	return a > b ? a : b;
+}
+
+} /* namespace VectorMaths */
+
+} /* namespace EBC */
+
+#endif /* CORE_VECTORMATHS_HPP_ */
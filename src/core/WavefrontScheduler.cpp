@@ -0,0 +1,271 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+
+#include "core/WavefrontScheduler.hpp"
+#include <thread>
+#include <algorithm>
+
+namespace EBC
+{
+
+atomic<int> WavefrontScheduler::spareThreads(0);
+
+unsigned int WavefrontScheduler::threadBudget = 0;
+
+WavefrontScheduler::WavefrontScheduler(unsigned int xSize, unsigned int ySize, unsigned int tile, bool rev) :
+		tileSize(tile), rows((xSize + tile - 1) / tile), cols((ySize + tile - 1) / tile), reversed(rev),
+		active(rows*cols, 0), pending(new atomic<int>[rows*cols]), remaining(0), failed(false)
+{
+}
+
+void WavefrontScheduler::addColumn(unsigned int col, int lo, int hi)
+{
+	if (lo > hi)
+		return;
+	for(unsigned int r = lo / tileSize; r <= hi / tileSize; r++)
+		active[r*cols + col / tileSize] = 1;
+}
+
+void WavefrontScheduler::closeActiveSet()
+{
+	bool changed = true;
+	unsigned int r, c;
+	int first, last = -1;
+
+	while(changed)
+	{
+		changed = false;
+		for(r = 0; r < rows; r++)
+		{
+			first = -1;
+			for(c = 0; c < cols; c++)
+				if (active[r*cols+c])
+				{
+					if (first < 0)
+						first = c;
+					last = c;
+				}
+			for(c = first+1; first >= 0 && (int) c < last; c++)
+				if (!active[r*cols+c])
+				{
+					active[r*cols+c] = 1;
+					changed = true;
+				}
+		}
+		for(c = 0; c < cols; c++)
+		{
+			first = -1;
+			for(r = 0; r < rows; r++)
+				if (active[r*cols+c])
+				{
+					if (first < 0)
+						first = r;
+					last = r;
+				}
+			for(r = first+1; first >= 0 && (int) r < last; r++)
+				if (!active[r*cols+c])
+				{
+					active[r*cols+c] = 1;
+					changed = true;
+				}
+		}
+	}
+}
+
+unsigned int WavefrontScheduler::getMaxParallelism()
+{
+	closeActiveSet();
+
+	vector<unsigned int> perDiagonal(rows+cols, 0);
+	for(unsigned int r = 0; r < rows; r++)
+		for(unsigned int c = 0; c < cols; c++)
+			if (active[r*cols+c])
+				perDiagonal[r+c]++;
+	return *std::max_element(perDiagonal.begin(), perDiagonal.end());
+}
+
+void WavefrontScheduler::finishTile(unsigned int tile)
+{
+	const int r = tile / cols;
+	const int c = tile % cols;
+	const int step = reversed ? -1 : 1;
+	const int next[3][2] = {{r+step, c}, {r, c+step}, {r+step, c+step}};
+	unsigned int released[3];
+	unsigned int count = 0;
+
+	for(auto& n : next)
+	{
+		if (n[0] < 0 || n[0] >= (int) rows || n[1] < 0 || n[1] >= (int) cols || !active[n[0]*cols+n[1]])
+			continue;
+		if (--pending[n[0]*cols+n[1]] == 0)
+			released[count++] = n[0]*cols+n[1];
+	}
+
+	lock_guard<mutex> guard(readyLock);
+	for(unsigned int t = 0; t < count; t++)
+		ready.push_back(released[t]);
+	remaining--;
+	if (count > 0 || remaining == 0)
+		readyCondition.notify_all();
+}
+
+void WavefrontScheduler::work(unsigned int worker, const function<void(unsigned int, unsigned int, unsigned int)>& fn)
+{
+	unsigned int tile;
+
+	while(true)
+	{
+		{
+			unique_lock<mutex> guard(readyLock);
+			readyCondition.wait(guard, [this]{ return !ready.empty() || remaining == 0 || failed; });
+			if (remaining == 0 || failed)
+				return;
+			tile = ready.front();
+			ready.pop_front();
+		}
+		try
+		{
+			fn(worker, tile / cols, tile % cols);
+		}
+		catch(...)
+		{
+			lock_guard<mutex> guard(readyLock);
+			if (!failed)
+				failure = current_exception();
+			failed = true;
+			readyCondition.notify_all();
+			return;
+		}
+		finishTile(tile);
+	}
+}
+
+void WavefrontScheduler::run(unsigned int maxHelpers, const function<void(unsigned int, unsigned int, unsigned int)>& fn)
+{
+	const int step = reversed ? -1 : 1;
+	int r, c;
+
+	closeActiveSet();
+
+	ready.clear();
+	remaining = 0;
+	failed = false;
+	for(r = 0; r < (int) rows; r++)
+		for(c = 0; c < (int) cols; c++)
+		{
+			if (!active[r*cols+c])
+				continue;
+			const int prev[3][2] = {{r-step, c}, {r, c-step}, {r-step, c-step}};
+			int count = 0;
+			for(auto& p : prev)
+				if (p[0] >= 0 && p[0] < (int) rows && p[1] >= 0 && p[1] < (int) cols && active[p[0]*cols+p[1]])
+					count++;
+			pending[r*cols+c] = count;
+			if (count == 0)
+				ready.push_back(r*cols+c);
+			remaining++;
+		}
+
+	if (remaining == 0)
+		return;
+
+	unsigned int helpers = claimThreads(min(maxHelpers, getMaxParallelism() - 1));
+	vector<thread> threads;
+
+	for(unsigned int w = 1; w <= helpers; w++)
+		threads.push_back(thread(&WavefrontScheduler::work, this, w, std::cref(fn)));
+
+	//the calling thread is worker 0
+	this->work(0, fn);
+
+	for(auto& t : threads)
+		t.join();
+
+	releaseThreads(helpers);
+
+	if (failed)
+		rethrow_exception(failure);
+}
+
+void WavefrontScheduler::setThreadBudget(unsigned int threads)
+{
+	threadBudget = threads;
+	spareThreads = threads;
+}
+
+unsigned int WavefrontScheduler::claimThreads(unsigned int count)
+{
+	int available = spareThreads.load();
+	int taken;
+	do
+	{
+		taken = min((int) count, max(0, available));
+	}
+	while(!spareThreads.compare_exchange_weak(available, available - taken));
+	return taken;
+}
+
+void WavefrontScheduler::releaseThreads(unsigned int count)
+{
+	spareThreads += count;
+}
+
+void WavefrontScheduler::runConcurrently(const function<void()>& first, const function<void()>& second)
+{
+	if (claimThreads(1) == 0)
+	{
+		first();
+		second();
+		return;
+	}
+
+	exception_ptr firstFailure;
+	thread helper([&]()
+	{
+		try
+		{
+			first();
+		}
+		catch(...)
+		{
+			firstFailure = current_exception();
+		}
+	});
+
+	exception_ptr secondFailure;
+	try
+	{
+		second();
+	}
+	catch(...)
+	{
+		secondFailure = current_exception();
+	}
+
+	helper.join();
+	releaseThreads(1);
+
+	if (firstFailure)
+		rethrow_exception(firstFailure);
+	if (secondFailure)
+		rethrow_exception(secondFailure);
+}
+
+} /* namespace EBC */
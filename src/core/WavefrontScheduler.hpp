@@ -0,0 +1,124 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+
+#ifndef CORE_WAVEFRONTSCHEDULER_HPP_
+#define CORE_WAVEFRONTSCHEDULER_HPP_
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <atomic>
+#include <memory>
+
+using namespace std;
+
+namespace EBC
+{
+
+//Runs the tiles of one dynamic programming matrix on several threads.
+//Tile (r,c) starts once its upper, left and upper-left neighbours are done
+//(lower, right and lower-right ones for a reversed sweep). Only the tiles marked
+//by addColumn are run - the marked set is closed to be contiguous along every
+//tile row and column, so the edges a tile hands on always reach the next tile.
+class WavefrontScheduler
+{
+protected:
+
+	unsigned int tileSize;
+
+	unsigned int rows;
+	unsigned int cols;
+
+	bool reversed;
+
+	vector<char> active;
+
+	//unfinished active predecessors of every tile
+	unique_ptr<atomic<int>[]> pending;
+
+	mutex readyLock;
+	condition_variable readyCondition;
+	deque<unsigned int> ready;
+	unsigned int remaining;
+
+	//first exception thrown by a tile, rethrown by run()
+	exception_ptr failure;
+	bool failed;
+
+	//cores not used by anyone else, shared by all tiled runs
+	static atomic<int> spareThreads;
+
+	static unsigned int threadBudget;
+
+	void closeActiveSet();
+
+	void finishTile(unsigned int tile);
+
+	void work(unsigned int worker, const function<void(unsigned int, unsigned int, unsigned int)>& fn);
+
+public:
+	//xSize x ySize cells cut into tileSize x tileSize tiles
+	WavefrontScheduler(unsigned int xSize, unsigned int ySize, unsigned int tileSize, bool reversed = false);
+
+	//rows lo..hi of column col hold cells to calculate
+	void addColumn(unsigned int col, int lo, int hi);
+
+	//Run fn(workerId, tileRow, tileCol) for all the active tiles on the calling thread and
+	//up to maxHelpers spare ones. If a tile throws, the exception is rethrown here
+	void run(unsigned int maxHelpers, const function<void(unsigned int, unsigned int, unsigned int)>& fn);
+
+	//most tiles ready at the same time - more threads would only wait
+	unsigned int getMaxParallelism();
+
+	unsigned int getTileSize() const
+	{
+		return tileSize;
+	}
+
+	//cores the tiled runs may use besides their calling thread
+	static void setThreadBudget(unsigned int threads);
+
+	//takes up to count spare cores, returns how many were taken
+	static unsigned int claimThreads(unsigned int count);
+
+	static void releaseThreads(unsigned int count);
+
+	//first on a spare thread while second runs on the calling one, one after the other if no core is spare.
+	//An exception of either is rethrown once both are done
+	static void runConcurrently(const function<void()>& first, const function<void()>& second);
+
+	static unsigned int getSpareThreads()
+	{
+		return max(0, spareThreads.load());
+	}
+
+	//spare threads when no pair is running, fixed for the whole run
+	static unsigned int getThreadBudget()
+	{
+		return threadBudget;
+	}
+};
+
+} /* namespace EBC */
+
+#endif /* CORE_WAVEFRONTSCHEDULER_HPP_ */
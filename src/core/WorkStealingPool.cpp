@@ -0,0 +1,117 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+
+#include "core/WorkStealingPool.hpp"
+#include <thread>
+
+namespace EBC
+{
+
+WorkStealingPool::WorkStealingPool(unsigned int workers) : workerCount(workers > 0 ? workers : 1), queues(workerCount), failed(false)
+{
+	for(unsigned int w = 0; w < workerCount; w++)
+		queues[w] = new WorkerQueue();
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+	for(auto q : queues)
+		delete q;
+}
+
+void WorkStealingPool::submit(const vector<unsigned int>& orderedTasks)
+{
+	for(unsigned int t = 0; t < orderedTasks.size(); t++)
+	{
+		WorkerQueue* q = queues[t % workerCount];
+		lock_guard<mutex> guard(q->lock);
+		q->tasks.push_back(orderedTasks[t]);
+	}
+}
+
+bool WorkStealingPool::popLocal(unsigned int worker, unsigned int& task)
+{
+	WorkerQueue* q = queues[worker];
+	lock_guard<mutex> guard(q->lock);
+	if (q->tasks.empty())
+		return false;
+	task = q->tasks.front();
+	q->tasks.pop_front();
+	return true;
+}
+
+bool WorkStealingPool::steal(unsigned int thief, unsigned int& task)
+{
+	for(unsigned int offset = 1; offset < workerCount; offset++)
+	{
+		WorkerQueue* q = queues[(thief + offset) % workerCount];
+		lock_guard<mutex> guard(q->lock);
+		if (!q->tasks.empty())
+		{
+			task = q->tasks.back();
+			q->tasks.pop_back();
+			return true;
+		}
+	}
+	return false;
+}
+
+void WorkStealingPool::work(unsigned int worker, const function<void(unsigned int, unsigned int)>& fn,
+		const function<void(unsigned int)>& idle)
+{
+	unsigned int task;
+	//tasks are never added while running, so an unsuccessful steal means we're done
+	while(!failed && (popLocal(worker, task) || steal(worker, task)))
+	{
+		try
+		{
+			fn(worker, task);
+		}
+		catch(...)
+		{
+			lock_guard<mutex> guard(failureLock);
+			if (!failed)
+				failure = current_exception();
+			failed = true;
+		}
+	}
+	if (idle)
+		idle(worker);
+}
+
+void WorkStealingPool::run(const function<void(unsigned int, unsigned int)>& fn,
+		const function<void(unsigned int)>& idle)
+{
+	vector<thread> threads;
+
+	for(unsigned int w = 1; w < workerCount; w++)
+		threads.push_back(thread(&WorkStealingPool::work, this, w, std::cref(fn), std::cref(idle)));
+
+	//the calling thread is worker 0
+	this->work(0, fn, idle);
+
+	for(auto& t : threads)
+		t.join();
+
+	if (failed)
+		rethrow_exception(failure);
+}
+
+} /* namespace EBC */
@@ -0,0 +1,88 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+
+#ifndef CORE_WORKSTEALINGPOOL_HPP_
+#define CORE_WORKSTEALINGPOOL_HPP_
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <functional>
+#include <exception>
+#include <atomic>
+
+using namespace std;
+
+namespace EBC
+{
+
+//Runs a fixed set of independent tasks (identified by their index) on a number
+//of worker threads. Every worker owns a queue and takes tasks from its front,
+//idle workers steal from the back of the other queues.
+class WorkStealingPool
+{
+protected:
+
+	struct WorkerQueue
+	{
+		mutex lock;
+		deque<unsigned int> tasks;
+	};
+
+	unsigned int workerCount;
+
+	vector<WorkerQueue*> queues;
+
+	//first exception thrown by a task, rethrown by run()
+	exception_ptr failure;
+	mutex failureLock;
+	atomic<bool> failed;
+
+	bool popLocal(unsigned int worker, unsigned int& task);
+
+	bool steal(unsigned int thief, unsigned int& task);
+
+	void work(unsigned int worker, const function<void(unsigned int, unsigned int)>& fn,
+			const function<void(unsigned int)>& idle);
+
+public:
+	WorkStealingPool(unsigned int workers);
+
+	virtual ~WorkStealingPool();
+
+	//Deal the tasks round-robin; the order within each worker queue is preserved
+	//so passing the most expensive tasks first gives a longest-first schedule
+	void submit(const vector<unsigned int>& orderedTasks);
+
+	//Run fn(workerId, taskId) for all the submitted tasks, returns when done.
+	//If a task throws, the remaining tasks are dropped and the exception is rethrown here.
+	//idle(workerId) is called once a worker finds no more tasks, its core is free from then on
+	void run(const function<void(unsigned int, unsigned int)>& fn,
+			const function<void(unsigned int)>& idle = function<void(unsigned int)>());
+
+	unsigned int getWorkerCount() const
+	{
+		return workerCount;
+	}
+};
+
+} /* namespace EBC */
+
+#endif /* CORE_WORKSTEALINGPOOL_HPP_ */
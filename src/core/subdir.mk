@@ -9,7 +9,9 @@ CPP_SRCS += \
 ../src/core/DistanceMatrix.cpp \
 ../src/core/FileLogger.cpp \
 ../src/core/FileParser.cpp \
+../src/core/LogSumExp.cpp \
 ../src/core/Maths.cpp \
+../src/core/NewtonOptimizer.cpp \
 ../src/core/OptimizedModelParameters.cpp \
 ../src/core/Optimizer.cpp \
 ../src/core/PMatrix.cpp \
@@ -20,7 +22,9 @@ CPP_SRCS += \
 ../src/core/HmmException.cpp \
 ../src/core/SequenceElement.cpp \
 ../src/core/Sequences.cpp \
-../src/core/TransitionProbabilities.cpp 
+../src/core/TransitionProbabilities.cpp \
+../src/core/WavefrontScheduler.cpp \
+../src/core/WorkStealingPool.cpp 
 
 OBJS += \
 ./src/core/BandingEstimator.o \
@@ -32,7 +36,9 @@ OBJS += \
 ./src/core/DistanceMatrix.o \
 ./src/core/FileLogger.o \
 ./src/core/FileParser.o \
+./src/core/LogSumExp.o \
 ./src/core/Maths.o \
+./src/core/NewtonOptimizer.o \
 ./src/core/OptimizedModelParameters.o \
 ./src/core/Optimizer.o \
 ./src/core/PMatrix.o \
@@ -43,7 +49,9 @@ OBJS += \
 ./src/core/HmmException.o \
 ./src/core/SequenceElement.o \
 ./src/core/Sequences.o \
-./src/core/TransitionProbabilities.o 
+./src/core/TransitionProbabilities.o \
+./src/core/WavefrontScheduler.o \
+./src/core/WorkStealingPool.o 
 
 CPP_DEPS += \
 ./src/core/BandingEstimator.d \
@@ -55,7 +63,9 @@ CPP_DEPS += \
 ./src/core/DistanceMatrix.d \
 ./src/core/FileLogger.d \
 ./src/core/FileParser.d \
+./src/core/LogSumExp.d \
 ./src/core/Maths.d \
+./src/core/NewtonOptimizer.d \
 ./src/core/OptimizedModelParameters.d \
 ./src/core/Optimizer.d \
 ./src/core/PMatrix.d \
@@ -66,7 +76,9 @@ CPP_DEPS += \
 ./src/core/HmmException.d \
 ./src/core/SequenceElement.d \
 ./src/core/Sequences.d \
-./src/core/TransitionProbabilities.d 
+./src/core/TransitionProbabilities.d \
+./src/core/WavefrontScheduler.d \
+./src/core/WorkStealingPool.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
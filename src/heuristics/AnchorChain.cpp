@@ -0,0 +1,194 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+
+
+#include "heuristics/AnchorChain.hpp"
+
+#include <algorithm>
+#include <climits>
+
+namespace EBC
+{
+
+AnchorChain::AnchorChain(vector<SequenceElement*>* s1, vector<SequenceElement*>* s2, unsigned int alphabetSize) :
+		len1(s1->size()), len2(s2->size())
+{
+	kmerSize = alphabetSize == Definitions::nucleotideCount ? Definitions::anchorKmerSizeNuc : Definitions::anchorKmerSizeAa;
+
+	vector<pair<uint64_t, unsigned int> > kmers1, kmers2;
+	extractKmers(s1, alphabetSize, kmers1);
+	extractKmers(s2, alphabetSize, kmers2);
+	keepUnique(kmers1);
+	keepUnique(kmers2);
+
+	//shared k-mers, both lists are sorted by code
+	vector<pair<unsigned int, unsigned int> > matches;
+	auto it1 = kmers1.begin();
+	auto it2 = kmers2.begin();
+	while(it1 != kmers1.end() && it2 != kmers2.end())
+	{
+		if (it1->first < it2->first)
+			it1++;
+		else if (it2->first < it1->first)
+			it2++;
+		else
+		{
+			matches.push_back(std::make_pair(it1->second, it2->second));
+			it1++;
+			it2++;
+		}
+	}
+	std::sort(matches.begin(), matches.end(), [](const pair<unsigned int, unsigned int>& a, const pair<unsigned int, unsigned int>& b)
+	{
+		return a.second < b.second;
+	});
+
+	//longest chain increasing in the first sequence as well, the second one is sorted and unique already
+	vector<int> tails;
+	vector<int> previous(matches.size(), -1);
+	for(unsigned int m = 0; m < matches.size(); m++)
+	{
+		auto pos = std::lower_bound(tails.begin(), tails.end(), matches[m].first, [&matches](int t, unsigned int row)
+		{
+			return matches[t].first < row;
+		});
+		if (pos != tails.begin())
+			previous[m] = *(pos-1);
+		if (pos == tails.end())
+			tails.push_back(m);
+		else
+			*pos = m;
+	}
+
+	for(int m = tails.empty() ? -1 : tails.back(); m >= 0; m = previous[m])
+		anchors.push_back(matches[m]);
+	std::reverse(anchors.begin(), anchors.end());
+
+	DEBUG("Anchor chain of " << anchors.size() << " out of " << matches.size() << " shared unique k-mers");
+}
+
+AnchorChain::~AnchorChain()
+{
+}
+
+void AnchorChain::extractKmers(vector<SequenceElement*>* seq, unsigned int alphabetSize, vector<pair<uint64_t, unsigned int> >& kmers)
+{
+	uint64_t topDigit = 1;
+	for(unsigned int i = 1; i < kmerSize; i++)
+		topDigit *= alphabetSize;
+
+	uint64_t code = 0;
+	unsigned int run = 0;
+	kmers.reserve(seq->size());
+	for(unsigned int i = 0; i < seq->size(); i++)
+	{
+		SequenceElement* el = (*seq)[i];
+		if (el->isFastaClass() || el->isIsGap() || el->getMatrixIndex() >= alphabetSize)
+		{
+			code = run = 0;
+			continue;
+		}
+		code = (code % topDigit) * alphabetSize + el->getMatrixIndex();
+		if (++run >= kmerSize)
+			kmers.push_back(std::make_pair(code, i+1-kmerSize));
+	}
+}
+
+void AnchorChain::keepUnique(vector<pair<uint64_t, unsigned int> >& kmers)
+{
+	std::sort(kmers.begin(), kmers.end());
+
+	unsigned int kept = 0;
+	for(unsigned int i = 0; i < kmers.size(); )
+	{
+		unsigned int j = i+1;
+		while(j < kmers.size() && kmers[j].first == kmers[i].first)
+			j++;
+		if (j == i+1)
+			kmers[kept++] = kmers[i];
+		i = j;
+	}
+	kmers.resize(kept);
+}
+
+double AnchorChain::getCoverage()
+{
+	if (anchors.empty())
+		return 0;
+
+	//overlapping k-mers count their shared positions once
+	unsigned int covered1 = kmerSize;
+	unsigned int covered2 = kmerSize;
+	for(unsigned int a = 1; a < anchors.size(); a++)
+	{
+		covered1 += std::min(kmerSize, anchors[a].first - anchors[a-1].first);
+		covered2 += std::min(kmerSize, anchors[a].second - anchors[a-1].second);
+	}
+	return static_cast<double>(std::min(covered1, covered2)) / std::max(len1, len2);
+}
+
+Band* AnchorChain::createBand(int delta)
+{
+	//dp cells the alignment passes through - the corners, the anchor starts and the end of the last anchor
+	vector<pair<int, int> > points;
+	points.push_back(std::make_pair(0, 0));
+	for(auto anchor : anchors)
+		points.push_back(std::make_pair(anchor.first, anchor.second));
+	if (!anchors.empty())
+		points.push_back(std::make_pair(anchors.back().first + kmerSize, anchors.back().second + kmerSize));
+	points.push_back(std::make_pair(len1, len2));
+
+	vector<int> lo(len2+1, INT_MAX);
+	vector<int> hi(len2+1, -1);
+	for(unsigned int p = 1; p < points.size(); p++)
+	{
+		auto a = points[p-1];
+		auto b = points[p];
+		for(int col = a.second; col <= b.second; col++)
+		{
+			//the diagonals leaving the previous point and reaching the next one
+			int fromA = std::min(b.first, a.first + (col - a.second));
+			int toB = std::max(a.first, b.first - (b.second - col));
+			lo[col] = std::min(lo[col], std::min(fromA, toB));
+			hi[col] = std::max(hi[col], std::max(fromA, toB));
+		}
+	}
+
+	Band* band = new Band(len2+1);
+	int lastRow = len1;
+	for(unsigned int col = 0; col <= len2; col++)
+	{
+		int min = std::max(0, lo[col] - delta);
+		int max = std::min(lastRow, hi[col] + delta);
+		if (col == 0)
+		{
+			band->setMatchRangeAt(0,-1,-1);
+			band->setInsertRangeAt(0,0,max);
+			band->setDeleteRangeAt(0,-1,-1);
+			continue;
+		}
+		band->setMatchRangeAt(col,min+1,max);
+		band->setInsertRangeAt(col,min+1,max);
+		band->setDeleteRangeAt(col,min,max);
+	}
+	return band;
+}
+
+} /* namespace EBC */
@@ -0,0 +1,77 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+
+
+#ifndef HEURISTICS_ANCHORCHAIN_HPP_
+#define HEURISTICS_ANCHORCHAIN_HPP_
+
+#include "core/Definitions.hpp"
+#include "core/SequenceElement.hpp"
+#include "heuristics/Band.hpp"
+
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+namespace EBC
+{
+
+//Colinear chain of the k-mers found exactly once in both sequences of a pair.
+//For near-identical pairs it spans most of both sequences and pins the alignment
+//down to a few cells around it.
+class AnchorChain
+{
+protected:
+
+	unsigned int len1;
+	unsigned int len2;
+	unsigned int kmerSize;
+
+	//start of each chained k-mer in the first and the second sequence, increasing in both
+	vector<pair<unsigned int, unsigned int> > anchors;
+
+	//k-mer codes by start position, positions with ambiguity classes or gaps in the k-mer are skipped
+	void extractKmers(vector<SequenceElement*>* seq, unsigned int alphabetSize, vector<pair<uint64_t, unsigned int> >& kmers);
+
+	//k-mers found once only
+	void keepUnique(vector<pair<uint64_t, unsigned int> >& kmers);
+
+public:
+	AnchorChain(vector<SequenceElement*>* s1, vector<SequenceElement*>* s2, unsigned int alphabetSize);
+
+	virtual ~AnchorChain();
+
+	//fraction of the longer sequence covered by the chained k-mers in both sequences
+	double getCoverage();
+
+	//band through the anchors and the matrix corners, delta rows on both sides.
+	//Between two anchors it spans both diagonals so that an indel in between stays inside
+	Band* createBand(int delta);
+
+	inline unsigned int getAnchorCount()
+	{
+		return anchors.size();
+	}
+};
+
+} /* namespace EBC */
+
+#endif /* HEURISTICS_ANCHORCHAIN_HPP_ */
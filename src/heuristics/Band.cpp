@@ -20,6 +20,8 @@
 
 #include <heuristics/Band.hpp>
 
+#include <algorithm>
+
 namespace EBC
 {
 
@@ -54,6 +56,23 @@ Band::Band(unsigned int len1, unsigned int len2, double coverage) :  matchBand(l
 	}
 }
 
+void Band::widenAt(unsigned int pos, int delta, int lastRow)
+{
+	auto widen = [&](pair<int,int>& range, int firstRow)
+	{
+		if (range.first < 0)
+			return;
+		int hi = std::max(range.first, range.second);
+		range.first = std::max(firstRow, range.first - delta);
+		range.second = std::min(lastRow, hi + delta);
+	};
+
+	widen(matchBand[pos], 1);
+	//insert band of column 0 starts in the corner
+	widen(insertBand[pos], pos == 0 ? 0 : 1);
+	widen(deleteBand[pos], 0);
+}
+
 Band::~Band()
 {
 }
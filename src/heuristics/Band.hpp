@@ -73,6 +73,9 @@ public:
 		return deleteBand[pos];
 	}
 
+	//extends the non-empty ranges of a column by delta rows on both sides, up to lastRow
+	void widenAt(unsigned int pos, int delta, int lastRow);
+
 	inline void output()
 	{
 		for(unsigned int i =0; i< matchBand.size(); i++)
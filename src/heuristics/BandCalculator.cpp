@@ -20,11 +20,16 @@
 
 #include <heuristics/BandCalculator.hpp>
 
+#include <algorithm>
+#include <cmath>
+
 namespace EBC
 {
 
-BandCalculator::BandCalculator(vector<SequenceElement*>* s1, vector<SequenceElement*>* s2, SubstitutionModelBase* sm, IndelModel* im, double divergenceTime) :
-		fwd(4,nullptr), seq1(s1), seq2(s2), substModel(sm), indelModel(im), time(divergenceTime)
+BandCalculator::BandCalculator(vector<SequenceElement*>* s1, vector<SequenceElement*>* s2, SubstitutionModelBase* sm, IndelModel* im, double divergenceTime,
+		bool posteriorBand, DpWorkspace* ws) :
+		fwd(nullptr), fwdBwd(nullptr), seq1(s1), seq2(s2), substModel(sm), indelModel(im), time(divergenceTime),
+		searchBand(nullptr)
 {
 	DEBUG("Band estimator running...");
 
@@ -45,15 +50,17 @@ BandCalculator::BandCalculator(vector<SequenceElement*>* s1, vector<SequenceElem
 
 	accuracy = Definitions::highDivergenceAccuracyDelta;
 
+	double coverage = getBandCoverage(time);
+
 	if(time < Definitions::kmerLowDivergence){
-		band = new Band(s1->size(),s2->size(),0.075);
+		band = new Band(s1->size(),s2->size(),coverage);
 		INFO("LOW divergence");
 		leftBound = Definitions::almostZero;
 		rightBound = 2.0;
 	}
 	else if (time < Definitions::kmerHighDivergence){
 		//multipliers = normalMultipliers;
-		band = new Band(s1->size(),s2->size(),0.1);
+		band = new Band(s1->size(),s2->size(),coverage);
 		INFO("MEDIUM divergence");
 		leftBound = Definitions::almostZero;
 		rightBound = 5.0;
@@ -61,7 +68,7 @@ BandCalculator::BandCalculator(vector<SequenceElement*>* s1, vector<SequenceElem
 	}
 	else{//very high divergence
 		//multipliers = highMultipliers;
-		band = new Band(s1->size(),s2->size(),0.25);
+		band = new Band(s1->size(),s2->size(),coverage);
 		INFO("HIGH divergence");
 		leftBound = 0.5;
 		//use value from
@@ -75,137 +82,218 @@ BandCalculator::BandCalculator(vector<SequenceElement*>* s1, vector<SequenceElem
 
 	//band = new Band(s1->size(),s2->size());
 
+	bestTime = time;
+	if (!posteriorBand)
+		return;
+
+	if (nearIdenticalMode == Definitions::NearIdenticalMode::Anchored && time < Definitions::anchoredKmerDistance &&
+			calculateAnchoredBand(multipliers, ws))
+		return;
+
+	bestTime = findBestTime(multipliers, ws);
+
+	//forward-backward with checkpoints, posterior columns come in from the last one
+	fwdBwd = new CheckpointedPairHMM(seq1,seq2, substModel,indelModel, band);
+	fwdBwd->setWorkspace(ws);
+	fwdBwd->setDivergenceTimeAndCalculateModels(bestTime);
+
+	//too much mass on the edges means the band cuts off alignments - widen there and run again
+	searchBand = new Band(*band);
+	int delta = std::max(static_cast<int>(Definitions::minBandDelta), static_cast<int>(coverage * (s1->size()+1) / 2));
+	for(unsigned int round = 0; ; round++)
+	{
+		edgeMass.assign(s2->size()+1, 0.0);
+		DUMP("Checkpointed forward-backward calculation runs...");
+		fwdBwd->calculatePosteriors([this](unsigned int col, const double* m, const double* x, const double* y)
+		{
+			this->processPosteriorColumn(col, m, x, y);
+		});
+
+		if (round == Definitions::bandWideningRounds || !widenSearchBand(delta))
+			break;
+		*band = *searchBand;
+		delta *= 2;
+	}
+}
+
+double BandCalculator::findBestTime(const array<double,4>& multipliers, DpWorkspace* ws)
+{
 	unsigned int best = 0;
 	double tmpRes = std::numeric_limits<double>::max();
-	double lnl;
+	vector<double> lnls;
+	vector<double> times;
+
+	for(auto mult : multipliers)
+		times.push_back(time*mult);
 
 	DUMP("Trying several forward calculations to assess the band...");
-	for(unsigned int i = 0; i < fwd.size(); i++)
+	//likelihood only, all candidate times in one sweep - posteriors come from the checkpointed pass
+	fwd = new ForwardPairHMM(seq1,seq2, substModel,indelModel, Definitions::DpMatrixType::Rolling,band);
+	fwd->setWorkspace(ws);
+	lnls = fwd->runAlgorithmBatch(times);
+	for(unsigned int i = 0; i < lnls.size(); i++)
 	{
-
-		fwd[i] = new ForwardPairHMM(seq1,seq2, substModel,indelModel, Definitions::DpMatrixType::Full,band);
-		fwd[i]->setDivergenceTimeAndCalculateModels(time*multipliers[i]);
-		lnl = fwd[i]->runAlgorithm();
-		DUMP("Calculation "<< i << " with divergence time " << time*multipliers[i] << " and lnL " << lnl);
-		if(lnl < tmpRes)
+		DUMP("Calculation "<< i << " with divergence time " << times[i] << " and lnL " << lnls[i]);
+		if(lnls[i] < tmpRes)
 		{
 			best = i;
-			tmpRes = lnl;
+			tmpRes = lnls[i];
 		}
-		//bwd[i] = new BackwardPairHMM(seq1,seq2, false, substModel,indelModel, 0, Definitions::DpMatrixType::Full);
-		//bwd[i]->setDivergenceTimeAndCalculateModels(time*multipliers[i]);
-		//bwd[i]->runAlgorithm();
 	}
 
-	//TODO - perhaps band it as well ???
-	bwd =  new BackwardPairHMM(seq1,seq2, substModel,indelModel, Definitions::DpMatrixType::Full,band);
-	bwd->setDivergenceTimeAndCalculateModels(time*multipliers[best]);
-	DUMP("Backward calculation runs...");
-	bwd->runAlgorithm();
+	return times[best];
+}
+
+Definitions::NearIdenticalMode BandCalculator::nearIdenticalMode = Definitions::NearIdenticalMode::General;
+
+bool BandCalculator::calculateAnchoredBand(const array<double,4>& multipliers, DpWorkspace* ws)
+{
+	AnchorChain chain(seq1, seq2, substModel->getMatrixSize());
+	if (chain.getCoverage() < Definitions::anchoredMinCoverage)
+		return false;
 
-	//combine fwd and bwd metrics into one!
+	//the diagonal band is kept for the general path
+	Band* diagonal = band;
+	searchBand = chain.createBand(Definitions::anchoredBandDelta);
+	band = new Band(*searchBand);
 
-	bwd->calculatePosteriors(fwd[best]);
-	this->processPosteriorProbabilities(bwd, band);
+	//same starting time as the general path, from the multipliers on the anchored band
+	bestTime = findBestTime(multipliers, ws);
 
-	bestTime = time*multipliers[best];
+	fwdBwd = new CheckpointedPairHMM(seq1,seq2, substModel,indelModel, band);
+	fwdBwd->setWorkspace(ws);
+	fwdBwd->setDivergenceTimeAndCalculateModels(bestTime);
 
+	edgeMass.assign(seq2->size()+1, 0.0);
+	DUMP("Checkpointed forward-backward calculation on the anchored band runs...");
+	fwdBwd->calculatePosteriors([this](unsigned int col, const double* m, const double* x, const double* y)
+	{
+		this->processPosteriorColumn(col, m, x, y);
+	});
+
+	if (std::any_of(edgeMass.begin(), edgeMass.end(), [](double mass) { return mass > Definitions::bandEdgeMassLimit; }))
+	{
+		DEBUG("Posterior mass on the anchored band edges, falling back to the diagonal band");
+		delete fwd;
+		delete fwdBwd;
+		delete band;
+		delete searchBand;
+		fwd = nullptr;
+		fwdBwd = nullptr;
+		searchBand = nullptr;
+		band = diagonal;
+		bestTime = time;
+		return false;
+	}
 
+	DEBUG("Near-identical pair, anchored band along " << chain.getAnchorCount() << " anchors");
+	delete diagonal;
+	return true;
 }
 
 BandCalculator::~BandCalculator()
 {
-	delete bwd;
+	delete fwdBwd;
 
-	for(int i=0; i< fwd.size(); i++)
-	{
-		delete fwd[i];
-	}
+	delete fwd;
+
+	delete searchBand;
 
 	delete trProbs;
 	delete ptMatrix;
 
 }
 
-void BandCalculator::processPosteriorProbabilities(BackwardPairHMM* hmm, Band* band)
+void BandCalculator::processPosteriorColumn(unsigned int col, const double* m, const double* x, const double* y)
 {
-	//Match state
-	PairwiseHmmStateBase* M;
-	//Insert state
-	PairwiseHmmStateBase* X;
-	//Delete state
-	PairwiseHmmStateBase* Y;
-
-	M = hmm->getM();
-	X = hmm->getX();
-	Y = hmm->getY();
-
 	//cumulative posterior likelihood
 	double cpl = posteriorLikelihoodLimit + posteriorLikelihoodDelta;
 
-	int xHi, xLo, yHi, yLo, mHi,mLo, rowCount;
-
-	int tmpRow;
+	int rowCount = seq1->size()+1;
 
-	double tmpX, tmpY, tmpM;
-
-	rowCount = M->getRows();
-
-	for(unsigned int col = 0; col < M->getCols(); col++)
+	//posterior mass of the first and last cell of a search band range, unless that is the matrix edge
+	auto edgeMassOf = [&](std::pair<int,int> range, int firstRow, const double* post) -> double
 	{
-		xHi=mHi=yHi=xLo=mLo=yLo=-1;
-		tmpRow = 0;
-		while(tmpRow < rowCount && X->getValueAt(tmpRow, col) < cpl )
-			tmpRow++;
-		if (tmpRow != rowCount)
-		{
-			//found a value
-			xLo = tmpRow;
-			tmpRow = rowCount-1;
-			while(tmpRow >= 0 && X->getValueAt(tmpRow, col) < cpl)
-				tmpRow--;
-			if (tmpRow > 0)
-				xHi = tmpRow;
-		}
-
-		tmpRow = 0;
-		while(tmpRow < rowCount && Y->getValueAt(tmpRow, col) < cpl)
+		double mass = 0;
+		if (range.first < 0)
+			return mass;
+		if (range.first > firstRow)
+			mass += exp(post[range.first]);
+		if (range.second > range.first && range.second < rowCount-1)
+			mass += exp(post[range.second]);
+		return mass;
+	};
+
+	//column 0 holds backward values only
+	if (col > 0)
+		edgeMass[col] = edgeMassOf(searchBand->getMatchRangeAt(col), 1, m) + edgeMassOf(searchBand->getInsertRangeAt(col), 1, x)
+				+ edgeMassOf(searchBand->getDeleteRangeAt(col), 0, y);
+
+	//first and last row at or above the limit, hi stays -1 if that's the first row
+	auto bracket = [&](const double* post) -> std::pair<int,int>
+	{
+		int lo = -1, hi = -1;
+		int tmpRow = 0;
+		while(tmpRow < rowCount && post[tmpRow] < cpl)
 			tmpRow++;
 		if (tmpRow != rowCount)
 		{
 			//found a value
-			yLo = tmpRow;
+			lo = tmpRow;
 			tmpRow = rowCount-1;
-			while(tmpRow >= 0 && Y->getValueAt(tmpRow, col) < cpl)
+			while(tmpRow >= 0 && post[tmpRow] < cpl)
 				tmpRow--;
 			if (tmpRow > 0)
-				yHi = tmpRow;
+				hi = tmpRow;
 		}
+		return std::make_pair(lo,hi);
+	};
 
-		tmpRow = 0;
-		while(tmpRow < rowCount && M->getValueAt(tmpRow, col) < cpl)
-			tmpRow++;
-		if (tmpRow != rowCount)
-		{
-			//found a value
-			mLo = tmpRow;
-			tmpRow = rowCount-1;
-			while(tmpRow >= 0 && M->getValueAt(tmpRow, col) < cpl)
-				tmpRow--;
-			if (tmpRow > 0)
-				mHi = tmpRow;
-		}
+	auto xr = bracket(x);
+	auto yr = bracket(y);
+	auto mr = bracket(m);
 
+	band->setInsertRangeAt(col, xr.first, xr.second);
+	band->setDeleteRangeAt(col, yr.first, yr.second);
+	band->setMatchRangeAt(col, mr.first, mr.second);
 
+	DUMP("Match/Ins/Del bands for column " << col << "\t" << band->getMatchRangeAt(col).first <<"\t" << band->getMatchRangeAt(col).second
+			<< "\t" << band->getInsertRangeAt(col).first <<"\t" << band->getInsertRangeAt(col).second
+			<< "\t" << band->getDeleteRangeAt(col).first <<"\t" << band->getDeleteRangeAt(col).second);
+}
 
-		band->setInsertRangeAt(col, xLo,xHi);
-		band->setDeleteRangeAt(col, yLo,yHi);
-		band->setMatchRangeAt(col, mLo,mHi);
+bool BandCalculator::widenSearchBand(int delta)
+{
+	int lastCol = seq2->size();
+	int lastWidened = -1;
+	unsigned int flagged = 0;
 
-		DUMP("Match/Ins/Del bands for column " << col << "\t" << band->getMatchRangeAt(col).first <<"\t" << band->getMatchRangeAt(col).second
-				<< "\t" << band->getInsertRangeAt(col).first <<"\t" << band->getInsertRangeAt(col).second
-				<< "\t" << band->getDeleteRangeAt(col).first <<"\t" << band->getDeleteRangeAt(col).second);
+	for(int col = 1; col <= lastCol; col++)
+	{
+		if (edgeMass[col] <= Definitions::bandEdgeMassLimit)
+			continue;
+		flagged++;
+		//paths leaving the band drift along it, widen the neighbouring columns as well
+		for(int c = std::max(lastWidened+1, col-delta); c <= std::min(lastCol, col+delta); c++)
+			searchBand->widenAt(c, delta, seq1->size());
+		lastWidened = std::min(lastCol, col+delta);
 	}
+
+	if (flagged == 0)
+		return false;
+
+	DEBUG("Band edge mass above the limit in " << flagged << " columns, widening the band by " << delta);
+	return true;
+}
+
+double BandCalculator::getBandCoverage(double kmerDistance)
+{
+	if(kmerDistance < Definitions::kmerLowDivergence)
+		return 0.075;
+	else if (kmerDistance < Definitions::kmerHighDivergence)
+		return 0.1;
+	else
+		return 0.25;
 }
 
 double BandCalculator::getClosestDistance() {
@@ -35,10 +35,13 @@
 
 #include "hmm/ForwardPairHMM.hpp"
 #include "hmm/BackwardPairHMM.hpp"
+#include "hmm/CheckpointedPairHMM.hpp"
 
 #include "heuristics/Band.hpp"
+#include "heuristics/AnchorChain.hpp"
 
 #include<vector>
+#include<array>
 
 namespace EBC
 {
@@ -47,8 +50,8 @@ class BandCalculator
 {
 protected:
 
-	vector<ForwardPairHMM*> fwd;
-	BackwardPairHMM* bwd;
+	ForwardPairHMM* fwd;
+	CheckpointedPairHMM* fwdBwd;
 
 	vector<SequenceElement*>* seq1;
 	vector<SequenceElement*>* seq2;
@@ -64,6 +67,12 @@ protected:
 
 	Band* band;
 
+	//the band the posterior pass runs on - band gets the posterior ranges
+	Band* searchBand;
+
+	//posterior mass on the search band edges, per column
+	vector<double> edgeMass;
+
 	double posteriorLikelihoodLimit;
 	double posteriorLikelihoodDelta;
 
@@ -73,10 +82,26 @@ protected:
 	double leftBound;
 	double rightBound;
 
-	void processPosteriorProbabilities(BackwardPairHMM* hmm, Band* band);
+	//sets the band ranges of a column from its M/X/Y posteriors
+	void processPosteriorColumn(unsigned int col, const double* m, const double* x, const double* y);
+
+	//widens the search band around the columns with too much edge mass, false if there are none
+	bool widenSearchBand(int delta);
+
+	//near-identical pairs - one posterior pass on the band along the anchor chain.
+	//False, with the diagonal band left in place, if the chain is too short or the posteriors reach its edges
+	bool calculateAnchoredBand(const array<double,4>& multipliers, DpWorkspace* ws);
+
+	//the k-mer distance times each multiplier in one forward sweep on the current band, returns the most likely
+	double findBestTime(const array<double,4>& multipliers, DpWorkspace* ws);
 
 public:
-	BandCalculator(vector<SequenceElement*>* s1, vector<SequenceElement*>* s2, SubstitutionModelBase* sm, IndelModel* im, double divergenceTime);
+	static Definitions::NearIdenticalMode nearIdenticalMode;
+
+	//posteriorBand false keeps the k-mer based diagonal band and skips the forward-backward refinement
+	//ws is the scratch memory of the calling worker thread
+	BandCalculator(vector<SequenceElement*>* s1, vector<SequenceElement*>* s2, SubstitutionModelBase* sm, IndelModel* im, double divergenceTime,
+			bool posteriorBand = true, DpWorkspace* ws = nullptr);
 	virtual ~BandCalculator();
 
 	inline Band* getBand()
@@ -86,6 +111,9 @@ public:
 
 	double getClosestDistance();
 
+	//fraction of the column covered by the initial band for a given k-mer distance
+	static double getBandCoverage(double kmerDistance);
+
 	double getBrentAccuracy();
 
 	double getLeftBound() {
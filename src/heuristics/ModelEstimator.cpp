@@ -20,6 +20,7 @@
 
 #include "core/Dictionary.hpp"
 #include "heuristics/ModelEstimator.hpp"
+#include "core/WavefrontScheduler.hpp"
 #include <chrono>
 #include <array>
 #include <map>
@@ -126,43 +127,24 @@ void ModelEstimator::recalculateHMMs()
 		f1->setDivergenceTimeAndCalculateModels(tb1+tb2);
 		f2->setDivergenceTimeAndCalculateModels(tb2+tb3);
 
-		f1->runAlgorithm();
-		f2->runAlgorithm();
-
+		//same bands as the forward pass
 		BackwardPairHMM b1(inputSequences->getSequencesAt(tripletIdxs[i][0]),inputSequences->getSequencesAt(tripletIdxs[i][1]),
-				substModel, indelModel, Definitions::DpMatrixType::Full, nullptr);
+				substModel, indelModel, Definitions::DpMatrixType::Banded, f1->getBand());
 		BackwardPairHMM b2(inputSequences->getSequencesAt(tripletIdxs[i][1]),inputSequences->getSequencesAt(tripletIdxs[i][2]),
-				substModel, indelModel, Definitions::DpMatrixType::Full, nullptr);
+				substModel, indelModel, Definitions::DpMatrixType::Banded, f2->getBand());
 
 		b1.setDivergenceTimeAndCalculateModels(tb1+tb2);
 		b2.setDivergenceTimeAndCalculateModels(tb2+tb3);
 
-		b1.runAlgorithm();
-		b2.runAlgorithm();
-
-		b1.calculatePosteriors(f1);
-		b2.calculatePosteriors(f2);
-
-		b1.calculateMaximumPosteriorMatrix();
-		b2.calculateMaximumPosteriorMatrix();
-
-		auto mp1 = b1.getMPAlignment();
-		auto mp2 = b2.getMPAlignment();
-
-		DUMP("Pair 1 MPD alignment recalc");
-		DUMP(mp1.first);
-		DUMP(mp1.second);
-		DUMP("Pair 2 MPD alignment recalc");
-		DUMP(mp2.first);
-		DUMP(mp2.second);
-
+		runPosteriorPasses(f1, f2, &b1, &b2);
 
 		//delete f1;
 		//delete f2;
 
 		//store pairs, align triplets
-		pair<vector<double>*, pair<vector<unsigned char>*, vector<unsigned char>*> > alP1 = b1.getMPDWithPosteriors();
-		pair<vector<double>*, pair<vector<unsigned char>*, vector<unsigned char>*> > alP2 = b2.getMPDWithPosteriors();
+		//posteriors and the MPD traceback are computed in one fused pass
+		pair<vector<double>*, pair<vector<unsigned char>*, vector<unsigned char>*> > alP1 = b1.getMPDWithPosteriors(f1);
+		pair<vector<double>*, pair<vector<unsigned char>*, vector<unsigned char>*> > alP2 = b2.getMPDWithPosteriors(f2);
 
 		pairAlignments[i][0] = alP1.second.first;
 		pairAlignments[i][1] = alP1.second.second;
@@ -180,6 +162,32 @@ void ModelEstimator::recalculateHMMs()
 	ste->clean();
 }
 
+void ModelEstimator::runPosteriorPasses(ForwardPairHMM* f1, ForwardPairHMM* f2, BackwardPairHMM* b1, BackwardPairHMM* b2)
+{
+	auto forwards = [&]()
+	{
+		f1->runAlgorithm();
+		f2->runAlgorithm();
+	};
+	auto backwards = [&]()
+	{
+		b1->runAlgorithm();
+		b2->runAlgorithm();
+	};
+
+	//the passes are independent until the posteriors are combined
+	if (EvolutionaryPairHMM::defaultPosteriorMode == Definitions::PosteriorMode::Concurrent &&
+			f1->getDpCells() + f2->getDpCells() >= Definitions::concurrentPosteriorMinCells)
+	{
+		WavefrontScheduler::runConcurrently(forwards, backwards);
+	}
+	else
+	{
+		forwards();
+		backwards();
+	}
+}
+
 void ModelEstimator::doSME()
 {
 	double d1,d2,d3;
@@ -401,36 +409,54 @@ void ModelEstimator::calculateInitialHMMs(Definitions::ModelType model)
 				new Band(len2,len3,tripletDistances[i][1] < Definitions::kmerHighDivergence ? Definitions::narrowBandFactor : Definitions::initialBandFactor ));
 		//bandPairs[i] = make_pair(nullptr,nullptr);
 
-		fwdHMMs[i][0] = new ForwardPairHMM(seqsA[i][0],seqsA[i][1], substModel, indelModel, Definitions::DpMatrixType::Full, bandPairs[i].first,true);
-		fwdHMMs[i][1] = new ForwardPairHMM(seqsA[i][1],seqsA[i][2], substModel, indelModel, Definitions::DpMatrixType::Full, bandPairs[i].second,true);
+		fwdHMMs[i][0] = new ForwardPairHMM(seqsA[i][0],seqsA[i][1], substModel, indelModel, Definitions::DpMatrixType::Banded, bandPairs[i].first,true);
+		fwdHMMs[i][1] = new ForwardPairHMM(seqsA[i][1],seqsA[i][2], substModel, indelModel, Definitions::DpMatrixType::Banded, bandPairs[i].second,true);
 	}
 	double bestLnl = Definitions::minMatrixLikelihood;
 	double currentLnl;
 	double bestA, bestL, bestTm;
 
 
-	for (auto tm : timeModifiers){
-		for(auto l : lambdas){
-			indelModel->setParameters({l,initEpsilon});
-			for(auto a : alphas){
-				substModel->setAlpha(a);
-				substModel->calculateModel();
-				currentLnl = 0;
-				for (int i = 0; i < tripletIdxsSize; i++){
-					f1 = fwdHMMs[i][0];
-					f2 = fwdHMMs[i][1];
-
-					f1->setDivergenceTimeAndCalculateModels(tripletDistances[i][0]*tm);
-					f2->setDivergenceTimeAndCalculateModels(tripletDistances[i][1]*tm);
+	//all time modifiers of a lambda/alpha combination share one forward sweep per pair
+	vector<double> lnlTable(timeModifiers.size()*lambdas.size()*alphas.size(), 0.0);
+	auto lnlAt = [&](unsigned int t, unsigned int li, unsigned int ai) -> double&
+	{
+		return lnlTable[(t*lambdas.size() + li)*alphas.size() + ai];
+	};
+	vector<double> times1(timeModifiers.size());
+	vector<double> times2(timeModifiers.size());
+
+	for(unsigned int li = 0; li < lambdas.size(); li++){
+		indelModel->setParameters({lambdas[li],initEpsilon});
+		for(unsigned int ai = 0; ai < alphas.size(); ai++){
+			substModel->setAlpha(alphas[ai]);
+			substModel->calculateModel();
+			for (int i = 0; i < tripletIdxsSize; i++){
+				f1 = fwdHMMs[i][0];
+				f2 = fwdHMMs[i][1];
+
+				for(unsigned int t = 0; t < timeModifiers.size(); t++){
+					times1[t] = tripletDistances[i][0]*timeModifiers[t];
+					times2[t] = tripletDistances[i][1]*timeModifiers[t];
+				}
+				auto lnl1 = f1->runAlgorithmBatch(times1);
+				auto lnl2 = f2->runAlgorithmBatch(times2);
 
-					currentLnl += (f1->runAlgorithm() + f2->runAlgorithm()) * -1.0;
+				for(unsigned int t = 0; t < timeModifiers.size(); t++)
+					lnlAt(t,li,ai) += (lnl1[t] + lnl2[t]) * -1.0;
+			}
+		}
+	}
 
-				}
+	for(unsigned int t = 0; t < timeModifiers.size(); t++){
+		for(unsigned int li = 0; li < lambdas.size(); li++){
+			for(unsigned int ai = 0; ai < alphas.size(); ai++){
+				currentLnl = lnlAt(t,li,ai);
 				if (currentLnl > bestLnl){
 					bestLnl = currentLnl;
-					this->bestFwdAlpha = bestA = a;
-					bestL = l;
-					this->bestFwdTm = bestTm = tm;
+					this->bestFwdAlpha = bestA = alphas[ai];
+					bestL = lambdas[li];
+					this->bestFwdTm = bestTm = timeModifiers[t];
 
 				}
 			}
@@ -455,41 +481,21 @@ void ModelEstimator::calculateInitialHMMs(Definitions::ModelType model)
 		f1->setDivergenceTimeAndCalculateModels(tripletDistances[i][0]*bestTm);
 		f2->setDivergenceTimeAndCalculateModels(tripletDistances[i][1]*bestTm);
 
-		f1->runAlgorithm();
-		f2->runAlgorithm();
-
-		BackwardPairHMM b1(seqsA[i][0],seqsA[i][1], substModel, indelModel, Definitions::DpMatrixType::Full, bandPairs[i].first);
-		BackwardPairHMM b2(seqsA[i][1],seqsA[i][2], substModel, indelModel, Definitions::DpMatrixType::Full, bandPairs[i].second);
+		BackwardPairHMM b1(seqsA[i][0],seqsA[i][1], substModel, indelModel, Definitions::DpMatrixType::Banded, bandPairs[i].first);
+		BackwardPairHMM b2(seqsA[i][1],seqsA[i][2], substModel, indelModel, Definitions::DpMatrixType::Banded, bandPairs[i].second);
 
 		b1.setDivergenceTimeAndCalculateModels(tripletDistances[i][0]*bestTm);
 		b2.setDivergenceTimeAndCalculateModels(tripletDistances[i][1]*bestTm);
 
-		b1.runAlgorithm();
-		b2.runAlgorithm();
-
-		b1.calculatePosteriors(f1);
-		b2.calculatePosteriors(f2);
-
-		b1.calculateMaximumPosteriorMatrix();
-		b2.calculateMaximumPosteriorMatrix();
-
-		//auto mp1 = b1.getMPAlignment();
-		//auto mp2 = b2.getMPAlignment();
-
-		//DUMP("Pair 1 MPD alignment");
-		//DUMP(mp1.first);
-		//DUMP(mp1.second);
-		//DUMP("Pair 2 MPD alignment");
-		//DUMP(mp2.first);
-		//DUMP(mp2.second);
-
+		runPosteriorPasses(f1, f2, &b1, &b2);
 
 		//delete f1;
 		//delete f2;
 
 		//store pairs, align triplets
-		pair<vector<double>*, pair<vector<unsigned char>*, vector<unsigned char>*> > alP1 = b1.getMPDWithPosteriors();
-		pair<vector<double>*, pair<vector<unsigned char>*, vector<unsigned char>*> > alP2 = b2.getMPDWithPosteriors();
+		//posteriors and the MPD traceback are computed in one fused pass
+		pair<vector<double>*, pair<vector<unsigned char>*, vector<unsigned char>*> > alP1 = b1.getMPDWithPosteriors(f1);
+		pair<vector<double>*, pair<vector<unsigned char>*, vector<unsigned char>*> > alP2 = b2.getMPDWithPosteriors(f2);
 
 		pairAlignments[i][0] = alP1.second.first;
 		pairAlignments[i][1] = alP1.second.second;
@@ -118,6 +118,9 @@ protected:
 
 	void doSME();
 
+	//forward passes of a triplet on one thread, backward passes on another if one is spare
+	void runPosteriorPasses(ForwardPairHMM* f1, ForwardPairHMM* f2, BackwardPairHMM* b1, BackwardPairHMM* b2);
+
 public:
 	ModelEstimator(Sequences* inputSeqs, Definitions::ModelType model,
 			Definitions::OptimizationType ot,
@@ -1,5 +1,6 @@
 # Add inputs and outputs from these tool invocations to the build variables 
 CPP_SRCS += \
+../src/heuristics/AnchorChain.cpp \
 ../src/heuristics/Band.cpp \
 ../src/heuristics/BandCalculator.cpp \
 ../src/heuristics/GuideTree.cpp \
@@ -12,6 +13,7 @@ CPP_SRCS += \
 ../src/heuristics/TripletSamplingTree.cpp 
 
 OBJS += \
+./src/heuristics/AnchorChain.o \
 ./src/heuristics/Band.o \
 ./src/heuristics/BandCalculator.o \
 ./src/heuristics/GuideTree.o \
@@ -24,6 +26,7 @@ OBJS += \
 ./src/heuristics/TripletSamplingTree.o 
 
 CPP_DEPS += \
+./src/heuristics/AnchorChain.d \
 ./src/heuristics/Band.d \
 ./src/heuristics/BandCalculator.d \
 ./src/heuristics/GuideTree.d \
@@ -0,0 +1,230 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+
+#include "hmm/AmbiguousRunTransfer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace EBC
+{
+
+AmbiguousRunTransfer::AmbiguousRunTransfer(Definitions::StateId stayState) : stay(stayState)
+{
+	advance = stay == Definitions::Insert ? Definitions::Delete : Definitions::Insert;
+
+	for(unsigned int from = 0; from < Definitions::stateCount; from++)
+		for(unsigned int to = 0; to < Definitions::stateCount; to++)
+			trans[from][to] = 0;
+
+	unit.lo = unit.hi = 0;
+	unit.exponent = 0;
+	unit.values.assign(Definitions::stateCount * Definitions::stateCount, 0.0);
+	for(unsigned int s = 0; s < Definitions::stateCount; s++)
+		unit.values[s*Definitions::stateCount + s] = 1.0;
+
+	result.lo = 0;
+	result.hi = -1;
+	result.exponent = 0;
+}
+
+void AmbiguousRunTransfer::setTransitions(const double tr[Definitions::stateCount][Definitions::stateCount])
+{
+	for(unsigned int from = 0; from < Definitions::stateCount; from++)
+		for(unsigned int to = 0; to < Definitions::stateCount; to++)
+			trans[from][to] = tr[from][to];
+}
+
+void AmbiguousRunTransfer::setBand(const vector<int>& lo, const vector<int>& hi)
+{
+	bandLo = lo;
+	bandHi = hi;
+}
+
+void AmbiguousRunTransfer::getWindow(unsigned int length, int& lo, int& hi)
+{
+	//from anywhere in the band at one boundary to anywhere in it length symbols later
+	lo = std::numeric_limits<int>::max();
+	hi = -1;
+	for(unsigned int o = 0; o + length < bandLo.size(); o++)
+	{
+		if (bandLo[o] > bandHi[o] || bandLo[o+length] > bandHi[o+length])
+			continue;
+		lo = std::min(lo, bandLo[o+length] - bandHi[o]);
+		hi = std::max(hi, bandHi[o+length] - bandLo[o]);
+	}
+	lo = std::max(lo, 0);
+}
+
+void AmbiguousRunTransfer::setStep()
+{
+	const unsigned int S = Definitions::stateCount;
+
+	getWindow(1, step.lo, step.hi);
+	step.lo = 0;
+	step.hi = std::max(step.hi, 1);
+	step.exponent = 0;
+	const int width = step.hi + 1;
+	step.values.assign(S * S * width, 0.0);
+
+	const double stayStay = trans[stay][stay];
+	for(unsigned int from = 0; from < S; from++)
+	{
+		double* toMatch = step.values.data() + (from*S + Definitions::Match)*width;
+		double* toAdvance = step.values.data() + (from*S + advance)*width;
+		double* toStay = step.values.data() + (from*S + stay)*width;
+
+		toMatch[1] = trans[from][Definitions::Match];
+		toAdvance[0] = trans[from][advance];
+
+		//stays after the match move start at displacement 2, after the gap move at 1
+		double afterMatch = trans[from][Definitions::Match] * trans[Definitions::Match][stay];
+		double afterAdvance = trans[from][advance] * trans[advance][stay];
+		toStay[1] = afterAdvance;
+		for(int d = 2; d < width; d++)
+		{
+			afterAdvance *= stayStay;
+			toStay[d] = afterMatch + afterAdvance;
+			afterMatch *= stayStay;
+		}
+	}
+}
+
+void AmbiguousRunTransfer::convolve(const Kernel& a, const Kernel& b, int lo, int hi, Kernel& out)
+{
+	const unsigned int S = Definitions::stateCount;
+	const int widthA = a.hi - a.lo + 1;
+	const int widthB = b.hi - b.lo + 1;
+
+	out.lo = std::max(lo, a.lo + b.lo);
+	out.hi = std::min(hi, a.hi + b.hi);
+	out.exponent = a.exponent + b.exponent;
+	if (widthA <= 0 || widthB <= 0 || out.lo > out.hi)
+	{
+		out.lo = 0;
+		out.hi = -1;
+		out.values.clear();
+		return;
+	}
+
+	const int width = out.hi - out.lo + 1;
+	out.values.assign(S * S * width, 0.0);
+
+	for(unsigned int from = 0; from < S; from++)
+		for(unsigned int mid = 0; mid < S; mid++)
+			for(unsigned int to = 0; to < S; to++)
+			{
+				const double* valA = a.values.data() + (from*S + mid)*widthA;
+				const double* valB = b.values.data() + (mid*S + to)*widthB;
+				double* valOut = out.values.data() + (from*S + to)*width;
+				for(int k = 0; k < widthA; k++)
+				{
+					const double x = valA[k];
+					if (x == 0)
+						continue;
+					//entry m of b lands on displacement a.lo+k + b.lo+m
+					const int shift = a.lo + k + b.lo - out.lo;
+					const int first = std::max(0, -shift);
+					const int last = std::min(widthB, width - shift);
+					for(int m = first; m < last; m++)
+						valOut[shift + m] += x * valB[m];
+				}
+			}
+
+	double maxVal = *std::max_element(out.values.begin(), out.values.end());
+	if (maxVal == 0)
+		return;
+	int exponent;
+	frexp(maxVal, &exponent);
+	const double factor = ldexp(1.0, -exponent);
+	for(auto& val : out.values)
+		val *= factor;
+	out.exponent += exponent;
+}
+
+void AmbiguousRunTransfer::calculate()
+{
+	const unsigned int length = bandLo.size() - 1;
+	int lo, hi;
+
+	setStep();
+
+	//binary powers from the top bit down, each doubling followed by one more symbol if the bit is set
+	unsigned int bit = 1;
+	while (2*bit <= length)
+		bit *= 2;
+
+	unsigned int done = 1;
+	getWindow(done, lo, hi);
+	convolve(unit, step, lo, hi, result);
+
+	for(bit /= 2; bit > 0; bit /= 2)
+	{
+		done *= 2;
+		getWindow(done, lo, hi);
+		convolve(result, result, lo, hi, scratch);
+		std::swap(result, scratch);
+
+		if (length & bit)
+		{
+			done++;
+			getWindow(done, lo, hi);
+			convolve(result, step, lo, hi, scratch);
+			std::swap(result, scratch);
+		}
+	}
+}
+
+double AmbiguousRunTransfer::getCost(double applyPairs)
+{
+	const double S3 = Definitions::stateCount * Definitions::stateCount * Definitions::stateCount;
+	const unsigned int length = bandLo.size() - 1;
+	int lo, hi;
+
+	getWindow(1, lo, hi);
+	const double stepWidth = std::max(hi, 1) + 1;
+
+	//a convolution takes the first operand times the part of the second that lands in the output window
+	double cost = applyPairs * Definitions::stateCount * Definitions::stateCount;
+	unsigned int bit = 1;
+	while (2*bit <= length)
+		bit *= 2;
+	unsigned int done = 1;
+	getWindow(done, lo, hi);
+	double width = std::max(hi - lo + 1, 0);
+	for(bit /= 2; bit > 0; bit /= 2)
+	{
+		done *= 2;
+		getWindow(done, lo, hi);
+		cost += S3 * width * std::min(width, static_cast<double>(hi - lo + 1));
+		width = std::max(hi - lo + 1, 0);
+		if (length & bit)
+		{
+			done++;
+			getWindow(done, lo, hi);
+			cost += S3 * width * std::min(stepWidth, static_cast<double>(hi - lo + 1));
+			width = std::max(hi - lo + 1, 0);
+		}
+	}
+	return cost;
+}
+
+} /* namespace EBC */
@@ -0,0 +1,118 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+
+#ifndef AMBIGUOUSRUNTRANSFER_HPP_
+#define AMBIGUOUSRUNTRANSFER_HPP_
+
+#include "core/Definitions.hpp"
+
+#include <vector>
+
+using namespace std;
+
+namespace EBC
+{
+
+//Forward transfer across a run of fully ambiguous symbols (N, X) of one sequence.
+//Inside the run every path emits the background frequencies of the symbols it takes from
+//the other sequence, whatever states it goes through. What is left of the run is a kernel over
+//the states before and after it and the displacement along the other sequence - the sum of the
+//transition products of all paths that cross the run. The kernel is built by doubling,
+//in log2 of the run length convolutions, on the displacements the band allows.
+class AmbiguousRunTransfer
+{
+protected:
+
+	//linear space kernel scaled by 2^exponent, entry (from, to, d) at ((from*stateCount + to)*(hi-lo+1) + d-lo)
+	struct Kernel
+	{
+		vector<double> values;
+		int lo, hi;
+		long exponent;
+	};
+
+	//the state that stays on the run symbol - Insert for a run of seq2, Delete for a run of seq1
+	unsigned int stay;
+	//the gap state that takes a run symbol alone
+	unsigned int advance;
+
+	//trans[from][to]
+	double trans[Definitions::stateCount][Definitions::stateCount];
+
+	//band of the other sequence along the run, entry o after the first o run symbols
+	vector<int> bandLo;
+	vector<int> bandHi;
+
+	Kernel unit;
+	Kernel step;
+	Kernel result;
+	Kernel scratch;
+
+	//the displacements the band allows over any length consecutive run symbols
+	void getWindow(unsigned int length, int& lo, int& hi);
+
+	//out = a * b restricted to [lo, hi], normalized
+	void convolve(const Kernel& a, const Kernel& b, int lo, int hi, Kernel& out);
+
+	//paths over one run symbol, the first move takes the run symbol, then any number of stays
+	void setStep();
+
+public:
+
+	AmbiguousRunTransfer(Definitions::StateId stayState);
+
+	//linear transition probabilities, tr[from][to]
+	void setTransitions(const double tr[Definitions::stateCount][Definitions::stateCount]);
+
+	//band of the other sequence at the run boundaries, lo.size() is the run length + 1
+	void setBand(const vector<int>& lo, const vector<int>& hi);
+
+	//kernel of the whole run
+	void calculate();
+
+	//multiply-adds of calculate and of applyPairs kernel lookups, to compare with the dp over the run
+	double getCost(double applyPairs);
+
+	inline double get(unsigned int from, unsigned int to, int d) const
+	{
+		if (d < result.lo || d > result.hi)
+			return 0.0;
+		return result.values[(from*Definitions::stateCount + to)*(result.hi-result.lo+1) + d-result.lo];
+	}
+
+	inline int getLo() const
+	{
+		return result.lo;
+	}
+
+	inline int getHi() const
+	{
+		return result.hi;
+	}
+
+	//the kernel is the stored values times 2^exponent
+	inline long getExponent() const
+	{
+		return result.exponent;
+	}
+};
+
+} /* namespace EBC */
+#endif /* AMBIGUOUSRUNTRANSFER_HPP_ */
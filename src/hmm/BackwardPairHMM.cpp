@@ -23,6 +23,10 @@
 #include "models/HKY85Model.hpp"
 #include "models/AminoacidSubstitutionModel.hpp"
 #include "hmm/DpMatrixFull.hpp"
+#include "hmm/DpMatrixFloat.hpp"
+#include "hmm/DpMatrixBanded.hpp"
+#include "hmm/TracebackMatrix.hpp"
+#include "core/WavefrontScheduler.hpp"
 
 
 namespace EBC
@@ -33,25 +37,54 @@ BackwardPairHMM::BackwardPairHMM(vector<SequenceElement*>* s1, vector<SequenceEl
 		IndelModel* imdl,  Definitions::DpMatrixType mt ,Band* bandObj) :
 		EvolutionaryPairHMM(s1,s2, smdl, imdl, mt, bandObj, true)
 {
-	this->MPstate = NULL;
+	this->mpTrace = NULL;
 }
 
 BackwardPairHMM::~BackwardPairHMM()
 {
-	if (MPstate != NULL)
-		delete MPstate;
+	if (mpTrace != NULL)
+		delete mpTrace;
 }
 
 
+template<class MatrixType, class FwdMatrixType>
+void BackwardPairHMM::posteriorsKernel(ForwardPairHMM* fwd, double fwdT)
+{
+	unsigned int j, s;
+	int i;
+
+	PairwiseHmmStateBase* states[Definitions::stateCount];
+	PairwiseHmmStateBase* fwdStates[Definitions::stateCount];
+	states[Definitions::Match] = M;
+	states[Definitions::Insert] = X;
+	states[Definitions::Delete] = Y;
+	fwdStates[Definitions::Match] = fwd->M;
+	fwdStates[Definitions::Insert] = fwd->X;
+	fwdStates[Definitions::Delete] = fwd->Y;
+
+	vector<int> colLo[Definitions::stateCount];
+	vector<int> colHi[Definitions::stateCount];
+	getColumnRanges(colLo, colHi);
+
+	//in-band cells of every state only, the rest keeps the minimum likelihood
+	for (j = 1; j<=ySize-1; j++)
+		for(s = 0; s < Definitions::stateCount; s++)
+			for (i = std::max(colLo[s][j], 1); i <= colHi[s][j]; i++)
+				states[s]->setValueAt<MatrixType>(i,j, states[s]->getValueAt<MatrixType>(i,j)
+						+ fwdStates[s]->getValueAt<FwdMatrixType>(i,j) - fwdT);
+}
+
 void BackwardPairHMM::calculatePosteriors(ForwardPairHMM* fwd)
 {
 	DEBUG("Calculating posterior probabilities");
 
-	unsigned int i,j;
-	double xval, yval, mval;
 	//totalForward
 	double fwdT;
 
+	if (matrixType == Definitions::DpMatrixType::Limited || fwd->matrixType == Definitions::DpMatrixType::Limited ||
+			matrixType == Definitions::DpMatrixType::Rolling || fwd->matrixType == Definitions::DpMatrixType::Rolling)
+		throw HmmException("Posterior probabilities require full or banded dp matrices\n");
+
 	fwdT = fwd->getTotalLikelihood();
 
 /*
@@ -82,19 +115,12 @@ void BackwardPairHMM::calculatePosteriors(ForwardPairHMM* fwd)
 
 	DUMP("POSTERIORS MATRICES");
 */
-	for (i = 1; i<=xSize-1; i++)
-	{
-		for (j = 1; j<=ySize-1; j++)
-		{
-			xval = X->getValueAt(i,j) + fwd->X->getValueAt(i,j) - fwdT;
-			yval = Y->getValueAt(i,j) + fwd->Y->getValueAt(i,j) - fwdT;
-			mval = M->getValueAt(i,j) + fwd->M->getValueAt(i,j) - fwdT;
-
-			X->setValueAt(i,j,xval);
-			Y->setValueAt(i,j,yval);
-			M->setValueAt(i,j,mval);
-		}
-	}
+	if (matrixType == Definitions::DpMatrixType::Banded)
+		posteriorsForward<DpMatrixBanded>(fwd, fwdT);
+	else if (matrixType == Definitions::DpMatrixType::FullFloat)
+		posteriorsForward<DpMatrixFloat>(fwd, fwdT);
+	else
+		posteriorsForward<DpMatrixFull>(fwd, fwdT);
 /*
 	DUMP("#####Match posteriors########");
 	dynamic_cast<DpMatrixFull*>(M->getDpMatrix())->outputValues(0);
@@ -107,19 +133,43 @@ void BackwardPairHMM::calculatePosteriors(ForwardPairHMM* fwd)
 
 
 
+template<class MatrixType>
+void BackwardPairHMM::posteriorsForward(ForwardPairHMM* fwd, double fwdT)
+{
+	if (fwd->matrixType == Definitions::DpMatrixType::Banded)
+		posteriorsKernel<MatrixType, DpMatrixBanded>(fwd, fwdT);
+	else if (fwd->matrixType == Definitions::DpMatrixType::FullFloat)
+		posteriorsKernel<MatrixType, DpMatrixFloat>(fwd, fwdT);
+	else
+		posteriorsKernel<MatrixType, DpMatrixFull>(fwd, fwdT);
+}
+
 double BackwardPairHMM::runAlgorithm()
 {
+	if (matrixType == Definitions::DpMatrixType::Rolling)
+		throw HmmException("Backward pass does not support rolling dp matrices\n");
+	if (matrixType == Definitions::DpMatrixType::Limited)
+		return ambiguousSequences ? runKernel<DpMatrixLoMem, true>() : runKernel<DpMatrixLoMem, false>();
+	if (matrixType == Definitions::DpMatrixType::Banded)
+		return ambiguousSequences ? runKernel<DpMatrixBanded, true>() : runKernel<DpMatrixBanded, false>();
+	if (matrixType == Definitions::DpMatrixType::FullFloat)
+		return ambiguousSequences ? runKernel<DpMatrixFloat, true>() : runKernel<DpMatrixFloat, false>();
+	return ambiguousSequences ? runKernel<DpMatrixFull, true>() : runKernel<DpMatrixFull, false>();
+}
+
+template<class MatrixType, bool Ambiguous>
+double BackwardPairHMM::runKernel()
+{
+	const int n1 = xSize-1;
+	const int n2 = ySize-1;
+	const double minL = Definitions::minMatrixLikelihood;
+	const int T = Definitions::wavefrontTileSize;
+
 	int i;
 	int j;
+	int lo, hi;
 
-	//initial
-	double mL = Definitions::minMatrixLikelihood;
-	//initial insert likelihood
-	double xL = Definitions::minMatrixLikelihood;
-	//initial delete likelihood
-	double yL = Definitions::minMatrixLikelihood;
-
-	double sX,sY,sM, sS;
+	double sS;
 
 	double bm, bx, by;
 
@@ -127,221 +177,109 @@ double BackwardPairHMM::runAlgorithm()
 
 	double initProb = log(xi);
 
-	M->initializeData(true);
-	X->initializeData(true);
-	Y->initializeData(true);
-
-	//Last ROW
-	for (j = ySize-1, i=xSize-1; j > 0; j--)
-	{
-		bxp = (i==xSize-1) ? xL : X->getValueAt(i+1,j) + ptmatrix->getLogEquilibriumFreqClass((*seq1)[i]);
-		byp = (j==ySize-1) ? yL : Y->getValueAt(i,j+1) + ptmatrix->getLogEquilibriumFreqClass((*seq2)[j]);
-		bmp = (i==xSize-1 ||j==ySize-1) ? mL : M->getValueAt(i+1,j+1) + ptmatrix->getLogPairTransitionClass((*seq1)[i], (*seq2)[j]);
-
-		bx = maths->logSum(M->getTransitionProbabilityFromInsert() +  bmp,
-				X->getTransitionProbabilityFromInsert() + bxp,
-				Y->getTransitionProbabilityFromInsert() + byp);
+	typedef EmissionPolicy<Ambiguous> Emission;
 
-		by = maths->logSum(M->getTransitionProbabilityFromDelete() + bmp,
-				X->getTransitionProbabilityFromDelete() + bxp,
-				Y->getTransitionProbabilityFromDelete() + byp);
+	//same per state ranges as the forward pass - out of band cells keep the minimum likelihood
+	vector<int> colLo[Definitions::stateCount];
+	vector<int> colHi[Definitions::stateCount];
+	getColumnRanges(colLo, colHi);
 
-		bm = maths->logSum(M->getTransitionProbabilityFromMatch() + bmp,
-				X->getTransitionProbabilityFromMatch() + bxp,
-				Y->getTransitionProbabilityFromMatch() + byp);
+	auto inBand = [&](Definitions::StateId st, int row, int col)
+	{
+		return row >= colLo[st][col] && row <= colHi[st][col];
+	};
 
-		if (i==xSize-1  && j==ySize-1)
+	//rows of column col holding any state, the last column has the end cell on top
+	auto columnRows = [&](int col, int& rowLo, int& rowHi)
+	{
+		rowLo = col == n2 ? n1 : n1+1;
+		rowHi = col == n2 ? n1 : -1;
+		for(unsigned int s = 0; s < Definitions::stateCount; s++)
 		{
-			X->setValueAt(i, j, initProb);
-			Y->setValueAt(i, j, initProb);
-			M->setValueAt(i, j, initProb);
-
-/*
-			X->setValueAt(i, j, 0);
-			Y->setValueAt(i, j, 0);
-			M->setValueAt(i, j, 0);
-*/
+			if (colLo[s][col] > colHi[s][col])
+				continue;
+			rowLo = std::min(rowLo, colLo[s][col]);
+			rowHi = std::max(rowHi, colHi[s][col]);
 		}
-		else
+	};
+
+	auto cell = [&](int row, int col)
+	{
+		if (row == n1 && col == n2)
 		{
-			X->setValueAt(i, j, bx);
-			Y->setValueAt(i, j, by);
-			M->setValueAt(i, j, bm);
+			X->setValueAt<MatrixType>(row, col, initProb);
+			Y->setValueAt<MatrixType>(row, col, initProb);
+			M->setValueAt<MatrixType>(row, col, initProb);
+			return;
 		}
-	}
-	//LAST COLUMN
-	for (i = xSize-1, j=ySize-1; i > 0; i--)
-	{
-		bxp = (i==xSize-1) ? xL : X->getValueAt(i+1,j) + ptmatrix->getLogEquilibriumFreqClass((*seq1)[i]);
-		byp = (j==ySize-1) ? yL : Y->getValueAt(i,j+1) + ptmatrix->getLogEquilibriumFreqClass((*seq2)[j]);
-		bmp = (i==xSize-1 ||j==ySize-1) ? mL : M->getValueAt(i+1,j+1) + ptmatrix->getLogPairTransitionClass((*seq1)[i], (*seq2)[j]);
-
-		bx = maths->logSum(M->getTransitionProbabilityFromInsert() + bmp,
-				X->getTransitionProbabilityFromInsert() + bxp,
-				Y->getTransitionProbabilityFromInsert() + byp);
 
-		by = maths->logSum(M->getTransitionProbabilityFromDelete() + bmp,
-				X->getTransitionProbabilityFromDelete() + bxp,
-				Y->getTransitionProbabilityFromDelete() + byp);
+		double nxp = row == n1 ? minL : X->getValueAt<MatrixType>(row+1,col) + Emission::single(ptmatrix, (*seq1)[row]);
+		double nyp = col == n2 ? minL : Y->getValueAt<MatrixType>(row,col+1) + Emission::single(ptmatrix, (*seq2)[col]);
+		double nmp = (row == n1 || col == n2) ? minL : M->getValueAt<MatrixType>(row+1,col+1) + Emission::pair(ptmatrix, (*seq1)[row], (*seq2)[col]);
+
+		if (inBand(Definitions::Insert, row, col))
+			X->setValueAt<MatrixType>(row, col, LogSumExp::logSum(M->getTransitionProbabilityFromInsert() + nmp,
+					X->getTransitionProbabilityFromInsert() + nxp,
+					Y->getTransitionProbabilityFromInsert() + nyp));
+		if (inBand(Definitions::Delete, row, col))
+			Y->setValueAt<MatrixType>(row, col, LogSumExp::logSum(M->getTransitionProbabilityFromDelete() + nmp,
+					X->getTransitionProbabilityFromDelete() + nxp,
+					Y->getTransitionProbabilityFromDelete() + nyp));
+		if (inBand(Definitions::Match, row, col))
+			M->setValueAt<MatrixType>(row, col, LogSumExp::logSum(M->getTransitionProbabilityFromMatch() + nmp,
+					X->getTransitionProbabilityFromMatch() + nxp,
+					Y->getTransitionProbabilityFromMatch() + nyp));
+	};
 
-		bm = maths->logSum(M->getTransitionProbabilityFromMatch() + bmp,
-				X->getTransitionProbabilityFromMatch() + bxp,
-				Y->getTransitionProbabilityFromMatch() + byp);
-
-		if (i==xSize-1  && j==ySize-1)
-		{
-
-			X->setValueAt(i, j, initProb);
-			Y->setValueAt(i, j, initProb);
-			M->setValueAt(i, j, initProb);
+	M->initializeData(true);
+	X->initializeData(true);
+	Y->initializeData(true);
 
-/*
-			X->setValueAt(i, j, 0);
-			Y->setValueAt(i, j, 0);
-			M->setValueAt(i, j, 0);
-*/
-		}
-		else
+	if (matrixType != Definitions::DpMatrixType::Limited && splitIntoTiles())
+	{
+		//tiles from the bottom right corner, each reads the cells its lower and right neighbours wrote
+		WavefrontScheduler scheduler(xSize, ySize, T, true);
+		for (j = n2; j >= 0; j--)
 		{
-			X->setValueAt(i, j, bx);
-			Y->setValueAt(i, j, by);
-			M->setValueAt(i, j, bm);
+			columnRows(j, lo, hi);
+			scheduler.addColumn(j, lo, hi);
 		}
-	}
 
-	//FIRST INSERTION boundary
-	X->setValueAt(xSize-1,0,ptmatrix->getLogEquilibriumFreqClass((*seq2)[0])+
-			Y->getTransitionProbabilityFromInsert()+Y->getValueAt(xSize-1,1));
-
-	//FIRST DELETION boundary
-	Y->setValueAt(0,ySize-1,ptmatrix->getLogEquilibriumFreqClass((*seq1)[0])+
-				X->getTransitionProbabilityFromDelete()+X->getValueAt(1,ySize-1));
-
-
-	//EVERTYHING ELSE excl first X col and 1st Y row
-	if(this->band == NULL){
-		for (i = xSize-2; i > 0; i--)
+		scheduler.run(scheduler.getMaxParallelism()-1, [&](unsigned int w, unsigned int r, unsigned int c)
 		{
-			for (j = ySize-2; j > 0; j--)
-			{
-
-				bxp = X->getValueAt(i+1,j) + ptmatrix->getLogEquilibriumFreqClass((*seq1)[i]);
-				byp = Y->getValueAt(i,j+1) + ptmatrix->getLogEquilibriumFreqClass((*seq2)[j]);
-				bmp = M->getValueAt(i+1,j+1) + ptmatrix->getLogPairTransitionClass((*seq1)[i], (*seq2)[j]);
-
-				bx = maths->logSum(M->getTransitionProbabilityFromInsert() + bmp,
-						X->getTransitionProbabilityFromInsert() + bxp,
-						Y->getTransitionProbabilityFromInsert() + byp);
-
-				by = maths->logSum(M->getTransitionProbabilityFromDelete() + bmp,
-									X->getTransitionProbabilityFromDelete() + bxp,
-									Y->getTransitionProbabilityFromDelete() + byp);
-
-				bm = maths->logSum(M->getTransitionProbabilityFromMatch() + bmp,
-												X->getTransitionProbabilityFromMatch() + bxp,
-												Y->getTransitionProbabilityFromMatch() + byp);
-
-					X->setValueAt(i, j, bx);
-					Y->setValueAt(i, j, by);
-					M->setValueAt(i, j, bm);
+			const int i0 = r*T;
+			const int i1 = std::min(n1, i0+T-1);
+			const int j0 = c*T;
+			const int j1 = std::min(n2, j0+T-1);
+			int rowLo, rowHi;
 
+			for (int col = j1; col >= j0; col--)
+			{
+				columnRows(col, rowLo, rowHi);
+				for (int row = std::min(rowHi, i1); row >= std::max(rowLo, i0); row--)
+					cell(row, col);
 			}
-		}
-
-		//set final inserts and deletes!
-
-		//first X col
-		for (j=0,i=xSize-2; i > 0; i--){
-
-			bxp = X->getValueAt(i+1,j) + ptmatrix->getLogEquilibriumFreqClass((*seq1)[i]);
-			byp = Y->getValueAt(i,j+1) + ptmatrix->getLogEquilibriumFreqClass((*seq2)[j]);
-			bmp = M->getValueAt(i+1,j+1) + ptmatrix->getLogPairTransitionClass((*seq1)[i], (*seq2)[j]);
-
-			bx = maths->logSum(M->getTransitionProbabilityFromInsert() + bmp,
-					X->getTransitionProbabilityFromInsert() + bxp,
-					Y->getTransitionProbabilityFromInsert() + byp);
-			X->setValueAt(i, j, bx);
-		}
-		//first Y row
-		for (i=0,j=ySize-2; j > 0; j--){
-			bxp = X->getValueAt(i+1,j) + ptmatrix->getLogEquilibriumFreqClass((*seq1)[i]);
-			byp = Y->getValueAt(i,j+1) + ptmatrix->getLogEquilibriumFreqClass((*seq2)[j]);
-			bmp = M->getValueAt(i+1,j+1) + ptmatrix->getLogPairTransitionClass((*seq1)[i], (*seq2)[j]);
-
-			by = maths->logSum(M->getTransitionProbabilityFromDelete() + bmp,
-								X->getTransitionProbabilityFromDelete() + bxp,
-								Y->getTransitionProbabilityFromDelete() + byp);
-
-			Y->setValueAt(i, j, by);
-		}
+		});
 	}
-	else{
-		int loD, hiD;
-		int iMin = xSize-2;
-		int iMax = 0;
-
-		//We make a simplifying assumption that the band is the same for all 3 matrices!
-		//Use bracket D bracket to calculate, but the first row for M and I needs to be zeroed!
-
-		for (j = ySize-2; j >= 0; j--){
-			auto bracketD = band->getDeleteRangeAt(j);
-
-			loD = max((bracketD.first), iMax);
-			hiD = min(bracketD.second, iMin);
-
-
-			for (int i = hiD; i >= loD; i--){
-				bxp = X->getValueAt(i+1,j) + ptmatrix->getLogEquilibriumFreqClass((*seq1)[i]);
-				byp = Y->getValueAt(i,j+1) + ptmatrix->getLogEquilibriumFreqClass((*seq2)[j]);
-				bmp = M->getValueAt(i+1,j+1) + ptmatrix->getLogPairTransitionClass((*seq1)[i], (*seq2)[j]);
-
-				bx = maths->logSum(M->getTransitionProbabilityFromInsert() + bmp,
-						X->getTransitionProbabilityFromInsert() + bxp,
-						Y->getTransitionProbabilityFromInsert() + byp);
-
-				by = maths->logSum(M->getTransitionProbabilityFromDelete() + bmp,
-									X->getTransitionProbabilityFromDelete() + bxp,
-									Y->getTransitionProbabilityFromDelete() + byp);
-
-				bm = maths->logSum(M->getTransitionProbabilityFromMatch() + bmp,
-												X->getTransitionProbabilityFromMatch() + bxp,
-												Y->getTransitionProbabilityFromMatch() + byp);
-
-					X->setValueAt(i, j, bx);
-					Y->setValueAt(i, j, by);
-					M->setValueAt(i, j, bm);
-			}
-		}
-		//do the first column
-		auto bracketI = band->getInsertRangeAt(0);
-		int loI = max((bracketI.first), iMax);
-		int hiI = min(bracketI.second, iMin);
-
-
-		for (j=0,i=hiI; i >= loI; i--){
-			bxp = X->getValueAt(i+1,j) + ptmatrix->getLogEquilibriumFreqClass((*seq1)[i]);
-			byp = Y->getValueAt(i,j+1) + ptmatrix->getLogEquilibriumFreqClass((*seq2)[j]);
-			bmp = M->getValueAt(i+1,j+1) + ptmatrix->getLogPairTransitionClass((*seq1)[i], (*seq2)[j]);
-
-			bx = maths->logSum(M->getTransitionProbabilityFromInsert() + bmp,
-					X->getTransitionProbabilityFromInsert() + bxp,
-					Y->getTransitionProbabilityFromInsert() + byp);
-			X->setValueAt(i, j, bx);
+	else
+	{
+		//right to left, bottom up - the last row and column have no M successors
+		for (j = n2; j >= 0; j--)
+		{
+			columnRows(j, lo, hi);
+			for (i = hi; i >= lo; i--)
+				cell(i, j);
 		}
-
-		//zero the first col
-		M->getDpMatrix()->setWholeRow(0, Definitions::minMatrixLikelihood);
-		X->getDpMatrix()->setWholeRow(0, Definitions::minMatrixLikelihood);
 	}
 
-	bmp  = M->getValueAt(1,1) + ptmatrix->getLogPairTransitionClass((*seq1)[0], (*seq2)[0]);
-	bxp  = X->getValueAt(1,0) + ptmatrix->getLogEquilibriumFreqClass((*seq1)[0]);
-	byp  = Y->getValueAt(0,1) + ptmatrix->getLogEquilibriumFreqClass((*seq2)[0]);
+	bmp  = M->getValueAt<MatrixType>(1,1) + Emission::pair(ptmatrix, (*seq1)[0], (*seq2)[0]);
+	bxp  = X->getValueAt<MatrixType>(1,0) + Emission::single(ptmatrix, (*seq1)[0]);
+	byp  = Y->getValueAt<MatrixType>(0,1) + Emission::single(ptmatrix, (*seq2)[0]);
 	bm = bmp + initTransM;
 	bx = bxp + initTransX;
 	by = byp + initTransY;
-	M->setValueAt(0, 0, maths->logSum(bm,bx,by));
-	sS = maths->logSum(bm,bx,by);
+	M->setValueAt<MatrixType>(0, 0, LogSumExp::logSum(bm,bx,by));
+	sS = LogSumExp::logSum(bm,bx,by);
 
 	//DUMP("Backward results:");
 	//DUMP(" sX, sY, sM, sS " << sX << "\t" << sY << "\t" << sM << "\t" << sS);
@@ -349,103 +287,123 @@ double BackwardPairHMM::runAlgorithm()
 	return sS* -1.0;
 }
 
-void BackwardPairHMM::calculateMaximumPosteriorMatrix() {
-	//any state type will do
-	this->MPstate = new PairwiseHmmMatchState(xSize,ySize);
-
-	double tmpMax;
-	unsigned int k,l;
-	//no need to initialize data
-	//set the P00 to 1 (ln(1) = 0)
-	MPstate->setValueAt(0,0,0);
-
-	//TODO - we can band it as well
-
-	for (unsigned int i = 1 ; i < xSize; i++)
-		for (unsigned int j = 1; j < ySize; j++){
-			k = i-1;
-			l = j-1;
-			tmpMax = std::max(MPstate->getValueAt(k,l)+M->getValueAt(i,j), std::max(MPstate->getValueAt(k,j)+X->getValueAt(i,j), MPstate->getValueAt(i,l)+Y->getValueAt(i,j)));
-			MPstate->setValueAt(i,j,tmpMax);
+template<class Posterior>
+TracebackMatrix* BackwardPairHMM::maximumPosteriorTrace(vector<int>* colLo, vector<int>* colHi, Posterior posterior)
+{
+	const double minL = Definitions::minMatrixLikelihood;
+
+	unsigned int j, s;
+	double tm, ti, td;
+
+	//rows of the MP recursion - union of the state ranges below row 0
+	vector<int> lo(ySize, 1);
+	vector<int> hi(ySize, 0);
+	for (j = 1; j < ySize; j++)
+	{
+		lo[j] = xSize;
+		for(s = 0; s < Definitions::stateCount; s++)
+		{
+			if (colLo[s][j] > colHi[s][j])
+				continue;
+			lo[j] = std::min(lo[j], std::max(colLo[s][j], 1));
+			hi[j] = std::max(hi[j], colHi[s][j]);
 		}
+	}
 
-	//DUMP("MPSTATE matrix ");
-	//dynamic_cast<DpMatrixFull*>(MPstate->getDpMatrix())->outputValues(0);
+	TracebackMatrix* trace = new TracebackMatrix(xSize, ySize, lo, hi);
 
+	//two MP columns, P00 = 1 (ln(1) = 0)
+	vector<double> mpColumns(2 * xSize, minL);
+	double* prev = mpColumns.data();
+	double* cur = prev + xSize;
+	int prevLo = 0, prevHi = 0;
+	int curLo = 1, curHi = 0;
+	prev[0] = 0;
+
+	for (j = 1; j < ySize; j++)
+	{
+		//drop what column j-2 left behind
+		std::fill(cur + curLo, cur + curHi + 1, minL);
 
+		for (int r = lo[j]; r <= hi[j]; r++)
+		{
+			//the predecessors the MPD traceback compares
+			tm = prev[r-1];
+			ti = cur[r-1];
+			td = prev[r];
+
+			cur[r] = std::max(tm + posterior(Definitions::Match,r,j), std::max(ti + posterior(Definitions::Insert,r,j), td + posterior(Definitions::Delete,r,j)));
+
+			if (tm >= ti && tm >= td)
+				trace->setCode(r, j, Definitions::Match);
+			else if (ti >= td)
+				trace->setCode(r, j, Definitions::Insert);
+			else
+				trace->setCode(r, j, Definitions::Delete);
+		}
+		curLo = lo[j];
+		curHi = hi[j];
+
+		std::swap(prev, cur);
+		std::swap(prevLo, curLo);
+		std::swap(prevHi, curHi);
+	}
+
+	return trace;
 }
+
+template<class Posterior>
 pair<vector<double>*, pair<vector<unsigned char>*, vector<unsigned char>*> >
-BackwardPairHMM::getMPDWithPosteriors(){
-	DUMP("Backward HMM get MPD alignment with posteriors");
+BackwardPairHMM::mpdTraceback(TracebackMatrix& trace, Posterior posterior)
+{
+	const unsigned char gapElem = this->substModel->getMatrixSize(); // last matrix element is the gap ID!
+
 	pair<vector<double>*, pair<vector<unsigned char>*, vector<unsigned char>*> >
 	ret = make_pair(new vector<double>(),make_pair(new vector<unsigned char>(), new vector<unsigned char>()));
 
-	unsigned char gapElem = this->substModel->getMatrixSize(); // last matrix element is the gap ID!
-
-	double tm, ti, td;
-
 	unsigned int i = xSize-1;
 	unsigned int j = ySize-1;
 
 	while(i > 0 && j > 0)
 	{
-		tm = MPstate->getValueAt(i-1,j-1);
-		ti = MPstate->getValueAt(i-1,j);
-		td = MPstate->getValueAt(i,j-1);
-
-		//DUMP(tm << "\t" << ti << "\t" << td);
-
-		if (tm >= ti && tm >= td){
-			//MATCH
-			//DUMP("M");
+		switch(trace.getCode(i,j))
+		{
+		case Definitions::Match :
 			ret.second.first->push_back((*seq1)[i-1]->getMatrixIndex());
 			ret.second.second->push_back((*seq2)[j-1]->getMatrixIndex());
-			ret.first->push_back(M->getValueAt(i,j));
+			ret.first->push_back(posterior(Definitions::Match,i,j));
 			i--;
 			j--;
-
-		}
-		else if (ti >= td){
-			//INSERT
-			//DUMP("I");
+			break;
+		case Definitions::Insert :
 			ret.second.first->push_back((*seq1)[i-1]->getMatrixIndex());
-			ret.second.second->push_back(gapElem);//gapElem;
-			ret.first->push_back(X->getValueAt(i,j));
+			ret.second.second->push_back(gapElem);
+			ret.first->push_back(posterior(Definitions::Insert,i,j));
 			i--;
-
-		}
-		else{
-			//DELETE
-			//DUMP("D");
-			ret.second.first->push_back(gapElem);//gapElem;
+			break;
+		default :
+			ret.second.first->push_back(gapElem);
 			ret.second.second->push_back((*seq2)[j-1]->getMatrixIndex());
-			ret.first->push_back(Y->getValueAt(i,j));
+			ret.first->push_back(posterior(Definitions::Delete,i,j));
 			j--;
-
 		}
 	}
 
-
-	if (j==0)
+	//deal with the last row or column
+	while(i > 0)
 	{
-		while(i > 0){
-			ret.second.first->push_back((*seq1)[i-1]->getMatrixIndex());
-			ret.second.second->push_back(gapElem);
-			ret.first->push_back(X->getValueAt(i,j));
-			i--;
-
-		}
+		ret.second.first->push_back((*seq1)[i-1]->getMatrixIndex());
+		ret.second.second->push_back(gapElem);
+		ret.first->push_back(posterior(Definitions::Insert,i,j));
+		i--;
 	}
-	else if (i==0)
+	while(j > 0)
 	{
-		while(j > 0){
-			ret.second.second->push_back((*seq2)[j-1]->getMatrixIndex());
-			ret.second.first->push_back(gapElem);
-			ret.first->push_back(Y->getValueAt(i,j));
-			j--;
-		}
+		ret.second.second->push_back((*seq2)[j-1]->getMatrixIndex());
+		ret.second.first->push_back(gapElem);
+		ret.first->push_back(posterior(Definitions::Delete,i,j));
+		j--;
 	}
-	//deal with the last row or column
 
 	reverse(ret.second.first->begin(), ret.second.first->end());
 	reverse(ret.second.second->begin(), ret.second.second->end());
@@ -453,74 +411,161 @@ BackwardPairHMM::getMPDWithPosteriors(){
 	return ret;
 }
 
+template<class MatrixType>
+void BackwardPairHMM::maximumPosteriorKernel()
+{
+	PairwiseHmmStateBase* states[Definitions::stateCount];
+	states[Definitions::Match] = M;
+	states[Definitions::Insert] = X;
+	states[Definitions::Delete] = Y;
+
+	vector<int> colLo[Definitions::stateCount];
+	vector<int> colHi[Definitions::stateCount];
+	getColumnRanges(colLo, colHi);
+
+	//calculatePosteriors already turned the state matrices into posteriors
+	mpTrace = maximumPosteriorTrace(colLo, colHi, [&](unsigned int st, unsigned int row, unsigned int col)
+	{
+		return states[st]->getValueAt<MatrixType>(row,col);
+	});
+}
+
+void BackwardPairHMM::calculateMaximumPosteriorMatrix() {
+	if (mpTrace != NULL)
+		delete mpTrace;
+
+	if (matrixType == Definitions::DpMatrixType::Banded)
+		maximumPosteriorKernel<DpMatrixBanded>();
+	else if (matrixType == Definitions::DpMatrixType::FullFloat)
+		maximumPosteriorKernel<DpMatrixFloat>();
+	else
+		maximumPosteriorKernel<DpMatrixFull>();
+}
+
+pair<vector<double>*, pair<vector<unsigned char>*, vector<unsigned char>*> >
+BackwardPairHMM::getMPDWithPosteriors(){
+	DUMP("Backward HMM get MPD alignment with posteriors");
+
+	PairwiseHmmStateBase* states[Definitions::stateCount];
+	states[Definitions::Match] = M;
+	states[Definitions::Insert] = X;
+	states[Definitions::Delete] = Y;
+
+	return mpdTraceback(*mpTrace, [&](unsigned int st, unsigned int row, unsigned int col)
+	{
+		return states[st]->getValueAt(row,col);
+	});
+}
+
+pair<vector<double>*, pair<vector<unsigned char>*, vector<unsigned char>*> >
+BackwardPairHMM::getMPDWithPosteriors(ForwardPairHMM* fwd)
+{
+	DUMP("Backward HMM fused posteriors and MPD alignment");
+
+	if (matrixType == Definitions::DpMatrixType::Limited || fwd->matrixType == Definitions::DpMatrixType::Limited ||
+			matrixType == Definitions::DpMatrixType::Rolling || fwd->matrixType == Definitions::DpMatrixType::Rolling)
+		throw HmmException("Posterior probabilities require full or banded dp matrices\n");
+
+	double fwdT = fwd->getTotalLikelihood();
+
+	if (matrixType == Definitions::DpMatrixType::Banded)
+		return mpdForward<DpMatrixBanded>(fwd, fwdT);
+	else if (matrixType == Definitions::DpMatrixType::FullFloat)
+		return mpdForward<DpMatrixFloat>(fwd, fwdT);
+	return mpdForward<DpMatrixFull>(fwd, fwdT);
+}
+
+template<class MatrixType>
+pair<vector<double>*, pair<vector<unsigned char>*, vector<unsigned char>*> >
+BackwardPairHMM::mpdForward(ForwardPairHMM* fwd, double fwdT)
+{
+	if (fwd->matrixType == Definitions::DpMatrixType::Banded)
+		return mpdKernel<MatrixType, DpMatrixBanded>(fwd, fwdT);
+	else if (fwd->matrixType == Definitions::DpMatrixType::FullFloat)
+		return mpdKernel<MatrixType, DpMatrixFloat>(fwd, fwdT);
+	return mpdKernel<MatrixType, DpMatrixFull>(fwd, fwdT);
+}
+
+template<class MatrixType, class FwdMatrixType>
+pair<vector<double>*, pair<vector<unsigned char>*, vector<unsigned char>*> >
+BackwardPairHMM::mpdKernel(ForwardPairHMM* fwd, double fwdT)
+{
+	PairwiseHmmStateBase* states[Definitions::stateCount];
+	PairwiseHmmStateBase* fwdStates[Definitions::stateCount];
+	states[Definitions::Match] = M;
+	states[Definitions::Insert] = X;
+	states[Definitions::Delete] = Y;
+	fwdStates[Definitions::Match] = fwd->M;
+	fwdStates[Definitions::Insert] = fwd->X;
+	fwdStates[Definitions::Delete] = fwd->Y;
+
+	vector<int> colLo[Definitions::stateCount];
+	vector<int> colHi[Definitions::stateCount];
+	getColumnRanges(colLo, colHi);
+
+	//the cells calculatePosteriors converts, anything else is read as the backward value
+	auto posterior = [&](unsigned int st, unsigned int row, unsigned int col)
+	{
+		double val = states[st]->getValueAt<MatrixType>(row,col);
+		if (row > 0 && col > 0 && static_cast<int>(row) >= colLo[st][col] && static_cast<int>(row) <= colHi[st][col])
+			val = val + fwdStates[st]->getValueAt<FwdMatrixType>(row,col) - fwdT;
+		return val;
+	};
+
+	TracebackMatrix* trace = maximumPosteriorTrace(colLo, colHi, posterior);
+	auto ret = mpdTraceback(*trace, posterior);
+	delete trace;
+	return ret;
+}
+
 pair<string, string> BackwardPairHMM::getMPAlignment() {
-	//tarceback through MPstate matrix
+	//traceback through the maximum posterior codes
 	//similar to viterbi traceback !
 	DUMP("Backward HMM get MP alignment");
 	pair<string, string> alignment;
 
-	//unsigned char gapElem = this->substModel->getMatrixSize();
-
 	//reserve memory for out strings (20% of gaps should be ok)
 	alignment.first.reserve(max(xSize,ySize)*1.2);
 	alignment.second.reserve(max(xSize,ySize)*1.2);
 
-
-	double tm, ti, td;
-
 	unsigned int i = xSize-1;
 	unsigned int j = ySize-1;
 
 	while(i > 0 && j > 0)
 	{
-		tm = MPstate->getValueAt(i-1,j-1);
-		ti = MPstate->getValueAt(i-1,j);
-		td = MPstate->getValueAt(i,j-1);
-
-		//DUMP(tm << "\t" << ti << "\t" << td);
-
-		if (tm >= ti && tm >= td){
-			//MATCH
-			//DUMP("M");
+		switch(mpTrace->getCode(i,j))
+		{
+		case Definitions::Match :
 			alignment.first += (*seq1)[i-1]->getSymbol();
 			alignment.second += (*seq2)[j-1]->getSymbol();
 			i--;
 			j--;
-		}
-		else if (ti >= td){
-			//INSERT
-			//DUMP("I");
+			break;
+		case Definitions::Insert :
 			alignment.first += (*seq1)[i-1]->getSymbol();
-			alignment.second += '-';//gapElem;
+			alignment.second += '-';
 			i--;
-		}
-		else{
-			//DELETE
-			//DUMP("D");
-			alignment.first += '-';//gapElem;
+			break;
+		default :
+			alignment.first += '-';
 			alignment.second += (*seq2)[j-1]->getSymbol();
 			j--;
 		}
 	}
 
-
-	if (j==0)
+	//deal with the last row or column
+	while(i > 0)
 	{
-		while(i > 0){
-			alignment.first += (*seq1)[i-1]->getSymbol();
-			alignment.second += '-';
-			i--;
-		}
+		alignment.first += (*seq1)[i-1]->getSymbol();
+		alignment.second += '-';
+		i--;
 	}
-	else if (i==0)
+	while(j > 0)
 	{
-		while(j > 0){
-			alignment.second += (*seq2)[j-1]->getSymbol();
-			alignment.first += '-';
-			j--;
-		}
+		alignment.second += (*seq2)[j-1]->getSymbol();
+		alignment.first += '-';
+		j--;
 	}
-	//deal with the last row or column
 
 	reverse(alignment.first.begin(), alignment.first.end());
 	reverse(alignment.second.begin(), alignment.second.end());
@@ -23,6 +23,7 @@
 
 #include "hmm/EvolutionaryPairHMM.hpp"
 #include "hmm/ForwardPairHMM.hpp"
+#include "hmm/TracebackMatrix.hpp"
 
 
 namespace EBC
@@ -33,8 +34,41 @@ class BackwardPairHMM: public EBC::EvolutionaryPairHMM
 
 protected:
 
-	//maximum posterior state;
-	PairwiseHmmStateBase* MPstate;
+	//maximum posterior traceback codes left by calculateMaximumPosteriorMatrix
+	TracebackMatrix* mpTrace;
+
+	template<class MatrixType, bool Ambiguous>
+	double runKernel();
+
+	template<class MatrixType, class FwdMatrixType>
+	void posteriorsKernel(ForwardPairHMM* fwd, double fwdT);
+
+	//picks the forward matrix type for posteriorsKernel
+	template<class MatrixType>
+	void posteriorsForward(ForwardPairHMM* fwd, double fwdT);
+
+	template<class MatrixType>
+	void maximumPosteriorKernel();
+
+	//maximum posterior recursion over two rolling columns, posterior(state,row,col) supplies the state posteriors.
+	//Returns the traceback codes of the in-band cells, owned by the caller
+	template<class Posterior>
+	TracebackMatrix* maximumPosteriorTrace(vector<int>* colLo, vector<int>* colHi, Posterior posterior);
+
+	//MPD alignment and its posteriors read back along trace
+	template<class Posterior>
+	pair<vector<double>*, pair<vector<unsigned char>*, vector<unsigned char>*> >
+	mpdTraceback(TracebackMatrix& trace, Posterior posterior);
+
+	//fused posteriors, maximum posterior recursion and traceback
+	template<class MatrixType, class FwdMatrixType>
+	pair<vector<double>*, pair<vector<unsigned char>*, vector<unsigned char>*> >
+	mpdKernel(ForwardPairHMM* fwd, double fwdT);
+
+	//picks the forward matrix type for mpdKernel
+	template<class MatrixType>
+	pair<vector<double>*, pair<vector<unsigned char>*, vector<unsigned char>*> >
+	mpdForward(ForwardPairHMM* fwd, double fwdT);
 
 	inline bool withinBand(unsigned int line, int position, unsigned int width)
 	{
@@ -55,6 +89,7 @@ public:
 
 	void calculatePosteriors(ForwardPairHMM* fwd);
 
+	//maximum posterior recursion over the posteriors, keeps only the 2 bit traceback codes
 	void calculateMaximumPosteriorMatrix();
 
 	//maximum posteriori alignment
@@ -63,6 +98,12 @@ public:
 	pair<vector<double>*, pair<vector<unsigned char>*, vector<unsigned char>*> >
 	getMPDWithPosteriors();
 
+	//calculatePosteriors, calculateMaximumPosteriorMatrix and getMPDWithPosteriors in one banded sweep.
+	//The maximum posterior scores roll over two columns, the traceback keeps 2 bits per cell.
+	//Backward matrices keep the backward values, no MP matrix is built
+	pair<vector<double>*, pair<vector<unsigned char>*, vector<unsigned char>*> >
+	getMPDWithPosteriors(ForwardPairHMM* fwd);
+
 };
 
 } /* namespace EBC */
@@ -0,0 +1,318 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+#include "core/HmmException.hpp"
+#include "core/LogSumExp.hpp"
+#include "hmm/BatchedForwardPairHMM.hpp"
+#include "hmm/EvolutionaryPairHMM.hpp"
+#include "hmm/ForwardPairHMM.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace EBC
+{
+
+BatchedForwardPairHMM::BatchedForwardPairHMM(SubstitutionModelBase* smdl, IndelModel* imdl) :
+		substModel(smdl), indelModel(imdl), ptmatrices(lanes), tpbs(lanes), pairCount(0), xSize(0), ySize(0)
+{
+	//length distribution fixed
+	xi = 0.001;
+
+	for(unsigned int l = 0; l < lanes; l++)
+	{
+		ptmatrices[l] = new PMatrixDouble(substModel);
+		tpbs[l] = new TransitionProbabilities(indelModel);
+	}
+}
+
+BatchedForwardPairHMM::~BatchedForwardPairHMM()
+{
+	for(unsigned int l = 0; l < lanes; l++)
+	{
+		delete tpbs[l];
+		delete ptmatrices[l];
+	}
+}
+
+void BatchedForwardPairHMM::setPairs(const vector<SequencePair>& batch, const vector<Band*>& laneBands)
+{
+	if (batch.empty() || batch.size() > lanes)
+		throw HmmException("BatchedForwardPairHMM : the batch has to hold between 1 and SIMD lanes pairs");
+	if (laneBands.size() != batch.size())
+		throw HmmException("BatchedForwardPairHMM : one band per pair expected");
+
+	pairCount = batch.size();
+	pairs = batch;
+	pairs.resize(lanes, batch.back());
+	bands = laneBands;
+	bands.resize(lanes, laneBands.back());
+
+	xSize = ySize = 0;
+	for(auto& pr : pairs)
+	{
+		xSize = std::max<unsigned int>(xSize, pr.first->size()+1);
+		ySize = std::max<unsigned int>(ySize, pr.second->size()+1);
+	}
+	columns.resize(2 * Definitions::stateCount * xSize * lanes);
+	for(auto& mask : bandMasks)
+		mask.resize(xSize * lanes);
+}
+
+void BatchedForwardPairHMM::setBandMasks(unsigned int col)
+{
+	int lo[Definitions::stateCount];
+	int hi[Definitions::stateCount];
+
+	for(unsigned int l = 0; l < lanes; l++)
+	{
+		const int n1 = pairs[l].first->size();
+		for(unsigned int s = 0; s < Definitions::stateCount; s++)
+		{
+			lo[s] = 1;
+			hi[s] = 0;
+		}
+
+		//nothing in band once the pair ended in an earlier column
+		if (col <= pairs[l].second->size() && bands[l] == nullptr)
+		{
+			lo[Definitions::Insert] = 1;
+			hi[Definitions::Insert] = n1;
+			if (col > 0)
+			{
+				lo[Definitions::Match] = 1;
+				hi[Definitions::Match] = n1;
+				lo[Definitions::Delete] = 0;
+				hi[Definitions::Delete] = n1;
+			}
+		}
+		else if (col <= pairs[l].second->size())
+		{
+			auto setRange = [&](Definitions::StateId st, std::pair<int, int> bracket, int firstRow)
+			{
+				if (bracket.first < firstRow)
+					return;
+				lo[st] = bracket.first;
+				hi[st] = std::min(bracket.second, n1);
+			};
+			setRange(Definitions::Insert, bands[l]->getInsertRangeAt(col), 1);
+			if (col > 0)
+			{
+				setRange(Definitions::Delete, bands[l]->getDeleteRangeAt(col), 0);
+				setRange(Definitions::Match, bands[l]->getMatchRangeAt(col), 1);
+			}
+		}
+
+		for(unsigned int s = 0; s < Definitions::stateCount; s++)
+			for(unsigned int i = 0; i < xSize; i++)
+				bandMasks[s][i*lanes + l] = ((int)i >= lo[s] && (int)i <= hi[s]) ? 1.0 : 0.0;
+	}
+}
+
+vector<double> BatchedForwardPairHMM::runAlgorithm(const vector<double>& times)
+{
+	using VectorMaths::vdouble;
+	using VectorMaths::load;
+	using VectorMaths::store;
+	using VectorMaths::broadcast;
+
+	const unsigned int W = lanes;
+	const int n1 = xSize-1;
+	const int n2 = ySize-1;
+	const double minVal = Definitions::minMatrixLikelihood;
+	const double minPi = exp(Definitions::minMatrixLikelihood);
+	const double ln2 = 0.693147180559945309417;
+
+	int i,j,s;
+	unsigned int l;
+	int exponent;
+
+	vector<double> result(pairCount);
+
+	if (times.size() != pairCount)
+		throw HmmException("BatchedForwardPairHMM : one divergence time per pair expected");
+
+	//per lane linear transitions and start probabilities
+	enum {MM, MX, MY, XM, XX, XY, YM, YX, YY, PM, PI, PD, parameterCount};
+	double laneParams[parameterCount][VectorMaths::lanes];
+	vdouble params[parameterCount];
+
+	double trans[Definitions::stateCount][Definitions::stateCount];
+	double md[Definitions::stateCount][Definitions::stateCount];
+	double pi[Definitions::stateCount];
+
+	vector<double> laneEmisX, laneEmisY;
+
+	//padding rows and columns never emit, the padded cells stay at 0
+	emisX.assign(xSize * W, 0.0);
+	emisY.assign(ySize * W, 0.0);
+
+	for(l = 0; l < W; l++)
+	{
+		const double time = times[std::min(l, pairCount-1)];
+		ptmatrices[l]->setTime(time);
+		ptmatrices[l]->calculate();
+		tpbs[l]->setTime(time);
+		tpbs[l]->calculate();
+
+		ForwardPairHMM::getEmissionProfiles(pairs[l].first, pairs[l].second, ptmatrices[l], laneEmisX, laneEmisY,
+				pairTables[l], symX[l], symY[l]);
+		for(i = 1; i < (int)laneEmisX.size(); i++)
+			emisX[i*W + l] = exp(laneEmisX[i]);
+		for(j = 1; j < (int)laneEmisY.size(); j++)
+			emisY[j*W + l] = exp(laneEmisY[j]);
+		for(auto& val : pairTables[l])
+			val = exp(val);
+
+		const double g = tpbs[l]->getGapOpening();
+		const double e = tpbs[l]->getGapExtension();
+
+		EvolutionaryPairHMM::calculateTransitionProbabilities(g, e, xi, trans);
+		laneParams[MM][l] = exp(trans[Definitions::Match][Definitions::Match]);
+		laneParams[MX][l] = exp(trans[Definitions::Match][Definitions::Insert]);
+		laneParams[MY][l] = exp(trans[Definitions::Match][Definitions::Delete]);
+		laneParams[XM][l] = exp(trans[Definitions::Insert][Definitions::Match]);
+		laneParams[XX][l] = exp(trans[Definitions::Insert][Definitions::Insert]);
+		laneParams[XY][l] = exp(trans[Definitions::Insert][Definitions::Delete]);
+		laneParams[YM][l] = exp(trans[Definitions::Delete][Definitions::Match]);
+		laneParams[YX][l] = exp(trans[Definitions::Delete][Definitions::Insert]);
+		laneParams[YY][l] = exp(trans[Definitions::Delete][Definitions::Delete]);
+
+		//substract xi/3 prob
+		EvolutionaryPairHMM::calculateStateEquilibriums(g, e, md, pi[Definitions::Match], pi[Definitions::Insert], pi[Definitions::Delete]);
+		for(s = 0; s < Definitions::stateCount; s++)
+			laneParams[PM+s][l] = (pi[s] - (xi/3.0)) < minPi ? 0.0 : pi[s] - (xi/3.0);
+	}
+	for(s = 0; s < parameterCount; s++)
+		params[s] = load(laneParams[s]);
+
+	auto cell = [&](int col, int st, int row) -> double*
+	{
+		return columns.data() + (((col & 1) * Definitions::stateCount + st) * xSize + row) * W;
+	};
+
+	//pair emissions of the current column, gathered from the lane tables
+	vector<double> emisM(xSize * W, 0.0);
+	auto gatherMatchColumn = [&](int col)
+	{
+		for(l = 0; l < W; l++)
+		{
+			//lanes whose pair ended in an earlier column have no symbol there
+			int rows = 0;
+			const double* table = nullptr;
+			if (col <= (int)pairs[l].second->size())
+			{
+				rows = pairs[l].first->size();
+				table = pairTables[l].data() + symY[l][col];
+			}
+			for(i = 1; i <= rows; i++)
+				emisM[i*W + l] = table[symX[l][i]];
+			for(; i <= n1; i++)
+				emisM[i*W + l] = 0.0;
+		}
+	};
+
+	//true probability = stored value * 2^columnScale, every lane rescaled on its own
+	long columnScale[VectorMaths::lanes] = {0};
+	double laneMax[VectorMaths::lanes];
+	double laneFactor[VectorMaths::lanes];
+	auto rescaleColumn = [&](int col)
+	{
+		vdouble maxVal = broadcast(0.0);
+		for(s = 0; s < Definitions::stateCount; s++)
+			for(i = 0; i <= n1; i++)
+				maxVal = VectorMaths::max(maxVal, load(cell(col,s,i)));
+		store(laneMax, maxVal);
+		for(l = 0; l < W; l++)
+		{
+			laneFactor[l] = 1.0;
+			if (laneMax[l] == 0)
+				continue;
+			frexp(laneMax[l], &exponent);
+			laneFactor[l] = ldexp(1.0, -exponent);
+			columnScale[l] += exponent;
+		}
+		const vdouble factor = load(laneFactor);
+		for(s = 0; s < Definitions::stateCount; s++)
+			for(i = 0; i <= n1; i++)
+				store(cell(col,s,i), load(cell(col,s,i)) * factor);
+	};
+
+	const vdouble zero = broadcast(0.0);
+
+	std::fill(columns.begin(), columns.end(), 0.0);
+
+	for(j = 0; j <= n2; j++)
+	{
+		//the buffer held column j-2 - only its start cells are not rewritten
+		if (j == 2)
+			for(s = 0; s < Definitions::stateCount; s++)
+				store(cell(j,s,0), zero);
+
+		setBandMasks(j);
+
+		if (j == 0)
+		{
+			store(cell(0,Definitions::Match,0), params[PM]);
+			store(cell(0,Definitions::Insert,0), params[PI]);
+			store(cell(0,Definitions::Delete,0), params[PD]);
+		}
+		else
+		{
+			const vdouble emissionY = load(&emisY[j*W]);
+			for(i = 0; i <= n1; i++)
+			{
+				store(cell(j,Definitions::Delete,i), load(&bandMasks[Definitions::Delete][i*W]) * emissionY * (params[YM] * load(cell(j-1,Definitions::Match,i))
+						+ params[YX] * load(cell(j-1,Definitions::Insert,i)) + params[YY] * load(cell(j-1,Definitions::Delete,i))));
+			}
+			gatherMatchColumn(j);
+			for(i = 1; i <= n1; i++)
+			{
+				store(cell(j,Definitions::Match,i), load(&bandMasks[Definitions::Match][i*W]) * load(&emisM[i*W]) * (params[MM] * load(cell(j-1,Definitions::Match,i-1))
+						+ params[MX] * load(cell(j-1,Definitions::Insert,i-1)) + params[MY] * load(cell(j-1,Definitions::Delete,i-1))));
+			}
+		}
+		for(i = 1; i <= n1; i++)
+		{
+			store(cell(j,Definitions::Insert,i), load(&bandMasks[Definitions::Insert][i*W]) * load(&emisX[i*W]) * (params[XM] * load(cell(j,Definitions::Match,i-1))
+					+ params[XX] * load(cell(j,Definitions::Insert,i-1)) + params[XY] * load(cell(j,Definitions::Delete,i-1))));
+		}
+
+		rescaleColumn(j);
+
+		//lanes whose pair ends in this column
+		for(l = 0; l < pairCount; l++)
+		{
+			if (pairs[l].second->size() != (unsigned int)j)
+				continue;
+			auto toLog = [&](double val)
+			{
+				return val < 2.2250738585072014e-308 ? minVal : log(val) + columnScale[l] * ln2;
+			};
+			const int row = pairs[l].first->size();
+			result[l] = (LogSumExp::logSum(toLog(cell(j,Definitions::Match,row)[l]), toLog(cell(j,Definitions::Insert,row)[l]),
+					toLog(cell(j,Definitions::Delete,row)[l])) + log(xi)) * -1.0;
+			DUMP("Forward lane " << l << " time " << times[l] << " lnL " << -result[l]);
+		}
+	}
+
+	return result;
+}
+
+} /* namespace EBC */
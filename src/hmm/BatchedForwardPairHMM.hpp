@@ -0,0 +1,104 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+#ifndef BATCHEDFORWARDPAIRHMM_HPP_
+#define BATCHEDFORWARDPAIRHMM_HPP_
+
+#include "core/Definitions.hpp"
+#include "core/VectorMaths.hpp"
+#include "core/PMatrixDouble.hpp"
+#include "core/TransitionProbabilities.hpp"
+#include "core/SequenceElement.hpp"
+
+#include "heuristics/Band.hpp"
+
+#include "models/SubstitutionModelBase.hpp"
+#include "models/IndelModel.hpp"
+
+#include <vector>
+
+namespace EBC
+{
+
+//Forward recursion for several sequence pairs at once, one pair per SIMD lane.
+//Every lane has its own emissions, divergence time and band, the matrices are padded to the
+//largest pair and each lane reads its likelihood off its own corner cell. Cells outside
+//a lane's band are masked to zero, as a banded ForwardPairHMM leaves them out.
+//Meant for short sequences where setting up a ForwardPairHMM and a band per pair costs
+//more than the recursion itself - the models are allocated once and reused for every batch.
+class BatchedForwardPairHMM
+{
+public:
+
+	typedef std::pair<vector<SequenceElement*>*, vector<SequenceElement*>*> SequencePair;
+
+	//pairs per batch
+	constexpr static const unsigned int lanes = VectorMaths::lanes;
+
+protected:
+
+	SubstitutionModelBase* substModel;
+	IndelModel* indelModel;
+
+	//end transition probability, as in EvolutionaryPairHMM
+	double xi;
+
+	//P(t) and indel transitions of every lane
+	vector<PMatrixDouble*> ptmatrices;
+	vector<TransitionProbabilities*> tpbs;
+
+	//lane pairs and their bands (nullptr - unbanded), spare lanes repeat the last pair
+	vector<SequencePair> pairs;
+	vector<Band*> bands;
+	unsigned int pairCount;
+
+	//padded matrix dimensions
+	unsigned int xSize, ySize;
+
+	//per lane emissions, lanes of one row (column) are adjacent
+	vector<double> emisX, emisY;
+
+	//per lane symbol pair tables and symbol offsets into them
+	vector<double> pairTables[lanes];
+	vector<unsigned int> symX[lanes], symY[lanes];
+
+	//two columns per state, lanes cells per row
+	vector<double> columns;
+
+	//1 for the in-band cells of the current column, 0 elsewhere, indexed by StateId
+	vector<double> bandMasks[Definitions::stateCount];
+
+	//band masks of column col, the same ranges as EvolutionaryPairHMM::getColumnRanges
+	void setBandMasks(unsigned int col);
+
+public:
+
+	BatchedForwardPairHMM(SubstitutionModelBase* smdl, IndelModel* imdl);
+
+	virtual ~BatchedForwardPairHMM();
+
+	//up to lanes pairs, one band per pair - the bands are not owned
+	void setPairs(const vector<SequencePair>& batch, const vector<Band*>& laneBands);
+
+	//-lnL of every pair at its own divergence time
+	vector<double> runAlgorithm(const vector<double>& times);
+};
+
+} /* namespace EBC */
+#endif /* BATCHEDFORWARDPAIRHMM_HPP_ */
@@ -0,0 +1,488 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+#include "core/Definitions.hpp"
+#include "core/HmmException.hpp"
+#include "core/WavefrontScheduler.hpp"
+#include "hmm/CheckpointedPairHMM.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+namespace EBC
+{
+
+CheckpointedPairHMM::CheckpointedPairHMM(vector<SequenceElement*>* s1, vector<SequenceElement*>* s2,
+		SubstitutionModelBase* smdl, IndelModel* imdl, Band* bandObj) :
+		EvolutionaryPairHMM(s1,s2, smdl, imdl, Definitions::DpMatrixType::Rolling, bandObj, true),
+		checkpoints(nullptr), segment(nullptr), backwardColumns(nullptr), backwardCheckpoints(nullptr),
+		backwardSegment(nullptr), posteriorMode(defaultPosteriorMode)
+{
+	if (band == NULL)
+		throw HmmException("Checkpointed forward-backward requires a band\n");
+
+	checkpointInterval = std::max(1u, static_cast<unsigned int>(std::ceil(std::sqrt(static_cast<double>(ySize)))));
+	DUMP("Checkpointed forward-backward " << xSize << "x" << ySize << " with a checkpoint every " << checkpointInterval << " columns");
+}
+
+CheckpointedPairHMM::~CheckpointedPairHMM()
+{
+}
+
+void CheckpointedPairHMM::captureBand()
+{
+	for(unsigned int s = 0; s < Definitions::stateCount; s++)
+		ranges[s].resize(ySize);
+
+	for(unsigned int j = 0; j < ySize; j++)
+	{
+		ranges[Definitions::Match][j] = band->getMatchRangeAt(j);
+		ranges[Definitions::Insert][j] = band->getInsertRangeAt(j);
+		ranges[Definitions::Delete][j] = band->getDeleteRangeAt(j);
+	}
+}
+
+template<bool Ambiguous>
+void CheckpointedPairHMM::forwardColumn(unsigned int j, const double* prev, double* cur)
+{
+	typedef EmissionPolicy<Ambiguous> Emission;
+
+	const double minL = Definitions::minMatrixLikelihood;
+
+	int i;
+	double emission, vm, vx, vy;
+
+	double* curM = cur + Definitions::Match * xSize;
+	double* curX = cur + Definitions::Insert * xSize;
+	double* curY = cur + Definitions::Delete * xSize;
+
+	std::fill(cur, cur + Definitions::stateCount * xSize, minL);
+
+	auto bracketI = ranges[Definitions::Insert][j];
+	auto bracketD = ranges[Definitions::Delete][j];
+	auto bracketM = ranges[Definitions::Match][j];
+
+	if (j == 0)
+	{
+		curM[0] = this->piM;
+		curX[0] = this->piI;
+		curY[0] = this->piD;
+	}
+	else
+	{
+		const double* prevM = prev + Definitions::Match * xSize;
+		const double* prevX = prev + Definitions::Insert * xSize;
+		const double* prevY = prev + Definitions::Delete * xSize;
+
+		if (bracketD.first > -1)
+		{
+			emission = Emission::single(ptmatrix, (*seq2)[j-1]);
+			for(i = bracketD.first; i <= bracketD.second; i++)
+			{
+				vm = prevM[i] + Y->getTransitionProbabilityFromMatch();
+				vx = prevX[i] + Y->getTransitionProbabilityFromInsert();
+				vy = prevY[i] + Y->getTransitionProbabilityFromDelete();
+				curY[i] = emission + LogSumExp::logSum(vm,vx,vy);
+			}
+		}
+		if (bracketM.first > 0)
+		{
+			for(i = bracketM.first; i <= bracketM.second; i++)
+			{
+				emission = Emission::pair(ptmatrix, (*seq1)[i-1], (*seq2)[j-1]);
+				vm = prevM[i-1] + M->getTransitionProbabilityFromMatch();
+				vx = prevX[i-1] + M->getTransitionProbabilityFromInsert();
+				vy = prevY[i-1] + M->getTransitionProbabilityFromDelete();
+				curM[i] = emission + LogSumExp::logSum(vm,vx,vy);
+			}
+		}
+	}
+
+	if (bracketI.first > 0)
+	{
+		for(i = bracketI.first; i <= bracketI.second; i++)
+		{
+			emission = Emission::single(ptmatrix, (*seq1)[i-1]);
+			vm = curM[i-1] + X->getTransitionProbabilityFromMatch();
+			vx = curX[i-1] + X->getTransitionProbabilityFromInsert();
+			vy = curY[i-1] + X->getTransitionProbabilityFromDelete();
+			curX[i] = emission + LogSumExp::logSum(vm,vx,vy);
+		}
+	}
+}
+
+template<bool Ambiguous>
+void CheckpointedPairHMM::backwardColumn(unsigned int j, const double* next, double* cur)
+{
+	typedef EmissionPolicy<Ambiguous> Emission;
+
+	const int lastRow = xSize-1;
+	const double minL = Definitions::minMatrixLikelihood;
+
+	int i, lo, hi;
+	double bmp, bxp, byp;
+
+	double* curM = cur + Definitions::Match * xSize;
+	double* curX = cur + Definitions::Insert * xSize;
+	double* curY = cur + Definitions::Delete * xSize;
+
+	const double* nextM = next + Definitions::Match * xSize;
+	const double* nextY = next + Definitions::Delete * xSize;
+
+	std::fill(cur, cur + Definitions::stateCount * xSize, minL);
+
+	//in-band rows of a state in this column, empty if lo > hi
+	auto rowsOf = [&](Definitions::StateId st, int minRow) -> std::pair<int,int>
+	{
+		auto bracket = ranges[st][j];
+		if (bracket.first < minRow)
+			return std::make_pair(1, 0);
+		return std::make_pair(bracket.first, std::min(bracket.second, lastRow));
+	};
+
+	std::pair<int,int> rowsM = j > 0 ? rowsOf(Definitions::Match, 1) : std::make_pair(1, 0);
+	std::pair<int,int> rowsX = rowsOf(Definitions::Insert, 1);
+	std::pair<int,int> rowsY = j > 0 ? rowsOf(Definitions::Delete, 0) : std::make_pair(1, 0);
+
+	lo = std::min(rowsM.first, std::min(rowsX.first, rowsY.first));
+	hi = std::max(rowsM.second, std::max(rowsX.second, rowsY.second));
+	if (j == ySize-1)
+	{
+		//end cell
+		curM[lastRow] = curX[lastRow] = curY[lastRow] = log(xi);
+		lo = std::min(lo, lastRow);
+		hi = lastRow;
+	}
+
+	//same per state ranges as the forward columns, the rest keeps the minimum likelihood
+	for (i = hi; i >= lo; i--)
+	{
+		if (i == lastRow && j == ySize-1)
+			continue;
+
+		bxp = i == lastRow ? minL : curX[i+1] + Emission::single(ptmatrix, (*seq1)[i]);
+		byp = j == ySize-1 ? minL : nextY[i] + Emission::single(ptmatrix, (*seq2)[j]);
+		bmp = (i == lastRow || j == ySize-1) ? minL : nextM[i+1] + Emission::pair(ptmatrix, (*seq1)[i], (*seq2)[j]);
+
+		if (i >= rowsX.first && i <= rowsX.second)
+			curX[i] = LogSumExp::logSum(M->getTransitionProbabilityFromInsert() + bmp,
+					X->getTransitionProbabilityFromInsert() + bxp,
+					Y->getTransitionProbabilityFromInsert() + byp);
+
+		if (i >= rowsY.first && i <= rowsY.second)
+			curY[i] = LogSumExp::logSum(M->getTransitionProbabilityFromDelete() + bmp,
+					X->getTransitionProbabilityFromDelete() + bxp,
+					Y->getTransitionProbabilityFromDelete() + byp);
+
+		if (i >= rowsM.first && i <= rowsM.second)
+			curM[i] = LogSumExp::logSum(M->getTransitionProbabilityFromMatch() + bmp,
+					X->getTransitionProbabilityFromMatch() + bxp,
+					Y->getTransitionProbabilityFromMatch() + byp);
+	}
+}
+
+void CheckpointedPairHMM::prepareBuffers()
+{
+	const unsigned int columnSize = Definitions::stateCount * xSize;
+	const unsigned int k = checkpointInterval;
+
+	captureBand();
+	DpWorkspace& ws = getWorkspace();
+	checkpoints = &ws.getBuffer<double>(DpWorkspace::Checkpoints);
+	segment = &ws.getBuffer<double>(DpWorkspace::Segment);
+	backwardColumns = &ws.getBuffer<double>(DpWorkspace::BackwardColumns);
+	checkpoints->resize(((ySize + k - 1) / k) * columnSize);
+	segment->resize((k - 1) * columnSize);
+	//two rolling backward columns and the posterior column
+	backwardColumns->resize(3 * columnSize);
+}
+
+template<bool Ambiguous>
+double CheckpointedPairHMM::forwardPass(double* rolling)
+{
+	const unsigned int columnSize = Definitions::stateCount * xSize;
+	const unsigned int k = checkpointInterval;
+
+	double* prev = nullptr;
+	double* cur;
+
+	for(unsigned int j = 0; j < ySize; j++)
+	{
+		cur = j % k == 0 ? column(*checkpoints, j / k) : rolling + (j & 1) * columnSize;
+		forwardColumn<Ambiguous>(j, prev, cur);
+		prev = cur;
+	}
+
+	double sS = LogSumExp::logSum(prev[Definitions::Match * xSize + xSize-1],
+			prev[Definitions::Insert * xSize + xSize-1],
+			prev[Definitions::Delete * xSize + xSize-1]) + log(xi);
+
+	this->setTotalLikelihood(sS);
+
+	DUMP("Checkpointed forward lnL " << sS);
+
+	return sS * -1.0;
+}
+
+template<bool Ambiguous>
+double CheckpointedPairHMM::runForward()
+{
+	prepareBuffers();
+	//columns between the checkpoints roll over the backward buffers
+	return forwardPass<Ambiguous>(column(*backwardColumns, 0));
+}
+
+template<bool Ambiguous>
+double CheckpointedPairHMM::runBackward(ColumnHandler& handler)
+{
+	typedef EmissionPolicy<Ambiguous> Emission;
+
+	const unsigned int k = checkpointInterval;
+
+	double fwdT = runForward<Ambiguous>() * -1.0;
+	double sS = Definitions::minMatrixLikelihood;
+
+	int segStart = ySize;
+	double* next = nullptr;
+	double* cur;
+	double* fwdCol;
+	double* post = column(*backwardColumns, 2);
+
+	auto forwardAt = [&](unsigned int col) -> double*
+	{
+		return col == static_cast<unsigned int>(segStart) ? column(*checkpoints, col / k) : column(*segment, col - segStart - 1);
+	};
+
+	for(int j = ySize-1; j >= 0; j--)
+	{
+		if (j < segStart)
+		{
+			//recompute the forward segment from its checkpoint
+			segStart = (j / k) * k;
+			for(int c = segStart+1; c <= j; c++)
+				forwardColumn<Ambiguous>(c, forwardAt(c-1), forwardAt(c));
+		}
+
+		cur = column(*backwardColumns, j & 1);
+		backwardColumn<Ambiguous>(j, next, cur);
+
+		if (j == 0)
+		{
+			double bm = next[Definitions::Match * xSize + 1] + Emission::pair(ptmatrix, (*seq1)[0], (*seq2)[0]) + initTransM;
+			double bx = cur[Definitions::Insert * xSize + 1] + Emission::single(ptmatrix, (*seq1)[0]) + initTransX;
+			double by = next[Definitions::Delete * xSize] + Emission::single(ptmatrix, (*seq2)[0]) + initTransY;
+			sS = LogSumExp::logSum(bm,bx,by);
+			cur[Definitions::Match * xSize] = sS;
+		}
+
+		std::copy(cur, cur + Definitions::stateCount * xSize, post);
+		if (j > 0)
+		{
+			fwdCol = forwardAt(j);
+			for(unsigned int s = 0; s < Definitions::stateCount; s++)
+				for(unsigned int i = 1; i < xSize; i++)
+					post[s*xSize + i] += fwdCol[s*xSize + i] - fwdT;
+		}
+
+		handler(j, post + Definitions::Match * xSize, post + Definitions::Insert * xSize, post + Definitions::Delete * xSize);
+		next = cur;
+	}
+
+	return sS * -1.0;
+}
+
+template<bool Ambiguous>
+double CheckpointedPairHMM::runConcurrent(ColumnHandler& handler)
+{
+	typedef EmissionPolicy<Ambiguous> Emission;
+
+	const unsigned int columnSize = Definitions::stateCount * xSize;
+	const unsigned int k = checkpointInterval;
+	const int segments = (ySize + k - 1) / k;
+
+	prepareBuffers();
+	DpWorkspace& ws = getWorkspace();
+	backwardCheckpoints = &ws.getBuffer<double>(DpWorkspace::BackwardCheckpoints);
+	backwardSegment = &ws.getBuffer<double>(DpWorkspace::BackwardSegment);
+	backwardCheckpoints->resize(segments * columnSize);
+	backwardSegment->resize(k * columnSize);
+	//two forward segments in flight, the first two columns roll the forward pass
+	segment->resize(2 * (k - 1) * columnSize);
+
+	double fwdT = 0;
+	double sS = Definitions::minMatrixLikelihood;
+
+	//backward pass, column 0 gets the backward likelihood in its M start cell
+	auto backwardPass = [&]()
+	{
+		double* next = nullptr;
+		double* cur;
+		for(int j = ySize-1; j >= 0; j--)
+		{
+			cur = j % k == 0 ? column(*backwardCheckpoints, j / k) : column(*backwardColumns, j & 1);
+			backwardColumn<Ambiguous>(j, next, cur);
+			if (j == 0)
+			{
+				double bm = next[Definitions::Match * xSize + 1] + Emission::pair(ptmatrix, (*seq1)[0], (*seq2)[0]) + initTransM;
+				double bx = cur[Definitions::Insert * xSize + 1] + Emission::single(ptmatrix, (*seq1)[0]) + initTransX;
+				double by = next[Definitions::Delete * xSize] + Emission::single(ptmatrix, (*seq2)[0]) + initTransY;
+				sS = LogSumExp::logSum(bm,bx,by);
+				cur[Definitions::Match * xSize] = sS;
+			}
+			next = cur;
+		}
+	};
+
+	//forward segment t goes to slot t&1, the helper stays at most two segments ahead
+	mutex lock;
+	condition_variable changed;
+	bool forwardDone = false;
+	int produced = segments;
+	int consumed = segments;
+	bool aborted = false;
+
+	auto forwardSlot = [&](int t) -> double*
+	{
+		return segment->data() + (t & 1) * (k - 1) * columnSize;
+	};
+
+	//the whole forward pass, then its segments again from the last one
+	thread helper([&]()
+	{
+		double lnl = forwardPass<Ambiguous>(segment->data()) * -1.0;
+		{
+			lock_guard<mutex> guard(lock);
+			fwdT = lnl;
+			forwardDone = true;
+			changed.notify_all();
+		}
+		for(int t = segments-1; t >= 0; t--)
+		{
+			{
+				unique_lock<mutex> guard(lock);
+				changed.wait(guard, [&]{ return consumed - t <= 2 || aborted; });
+				if (aborted)
+					return;
+			}
+			const unsigned int s = t*k;
+			const unsigned int e = std::min(s+k, ySize) - 1;
+			double* prev = column(*checkpoints, t);
+			for(unsigned int c = s+1; c <= e; c++)
+			{
+				double* cur = forwardSlot(t) + (c - s - 1) * columnSize;
+				forwardColumn<Ambiguous>(c, prev, cur);
+				prev = cur;
+			}
+			lock_guard<mutex> guard(lock);
+			produced = t;
+			changed.notify_all();
+		}
+	});
+
+	double* post = column(*backwardColumns, 2);
+	try
+	{
+		backwardPass();
+
+		for(int t = segments-1; t >= 0; t--)
+		{
+			const unsigned int s = t*k;
+			const unsigned int e = std::min(s+k, ySize) - 1;
+
+			//backward columns s+1..e again from the checkpoint to the right, column s is a checkpoint itself
+			double* next = e+1 < ySize ? column(*backwardCheckpoints, t+1) : nullptr;
+			for(unsigned int c = e; c > s; c--)
+			{
+				backwardColumn<Ambiguous>(c, next, column(*backwardSegment, c - s));
+				next = column(*backwardSegment, c - s);
+			}
+			std::copy(column(*backwardCheckpoints, t), column(*backwardCheckpoints, t) + columnSize, column(*backwardSegment, 0));
+
+			{
+				unique_lock<mutex> guard(lock);
+				changed.wait(guard, [&]{ return forwardDone && produced <= t; });
+			}
+
+			for(int j = e; j >= static_cast<int>(s); j--)
+			{
+				double* bwdCol = column(*backwardSegment, j - s);
+				std::copy(bwdCol, bwdCol + columnSize, post);
+				if (j > 0)
+				{
+					double* fwdCol = j == static_cast<int>(s) ? column(*checkpoints, t) : forwardSlot(t) + (j - s - 1) * columnSize;
+					for(unsigned int st = 0; st < Definitions::stateCount; st++)
+						for(unsigned int i = 1; i < xSize; i++)
+							post[st*xSize + i] += fwdCol[st*xSize + i] - fwdT;
+				}
+				handler(j, post + Definitions::Match * xSize, post + Definitions::Insert * xSize, post + Definitions::Delete * xSize);
+			}
+
+			lock_guard<mutex> guard(lock);
+			consumed = t;
+			changed.notify_all();
+		}
+	}
+	catch(...)
+	{
+		{
+			lock_guard<mutex> guard(lock);
+			aborted = true;
+			changed.notify_all();
+		}
+		helper.join();
+		throw;
+	}
+	helper.join();
+
+	DUMP("Concurrent checkpointed forward-backward lnLs " << fwdT << "\t" << sS);
+
+	return sS * -1.0;
+}
+
+double CheckpointedPairHMM::runAlgorithm()
+{
+	return ambiguousSequences ? runForward<true>() : runForward<false>();
+}
+
+double CheckpointedPairHMM::calculatePosteriors(ColumnHandler handler)
+{
+	//the forward slots need at least one column per segment
+	if (posteriorMode == Definitions::PosteriorMode::Concurrent && checkpointInterval > 1 &&
+			getDpCells() >= Definitions::concurrentPosteriorMinCells && WavefrontScheduler::claimThreads(1) == 1)
+	{
+		double result;
+		try
+		{
+			result = ambiguousSequences ? runConcurrent<true>(handler) : runConcurrent<false>(handler);
+		}
+		catch(...)
+		{
+			WavefrontScheduler::releaseThreads(1);
+			throw;
+		}
+		WavefrontScheduler::releaseThreads(1);
+		return result;
+	}
+	return ambiguousSequences ? runBackward<true>(handler) : runBackward<false>(handler);
+}
+
+} /* namespace EBC */
@@ -0,0 +1,128 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+
+#ifndef CHECKPOINTEDPAIRHMM_HPP_
+#define CHECKPOINTEDPAIRHMM_HPP_
+
+#include "hmm/EvolutionaryPairHMM.hpp"
+
+#include <functional>
+#include <vector>
+
+namespace EBC
+{
+
+//Banded forward-backward with checkpointing.
+//The forward pass keeps every k-th column (k ~ sqrt of the column count), the backward
+//pass runs right to left over two columns and recomputes one forward segment at a time
+//from its checkpoint. Posterior columns are handed out as soon as they are known,
+//so memory is O(n * sqrt(m)) at the cost of one extra forward pass.
+//Recursions and boundary cells follow ForwardPairHMM/BackwardPairHMM on banded matrices.
+class CheckpointedPairHMM: public EBC::EvolutionaryPairHMM
+{
+public:
+
+	//receives the M/X/Y posterior column col (xSize rows each), in the form
+	//BackwardPairHMM::calculatePosteriors leaves the backward matrices
+	typedef std::function<void(unsigned int col, const double* m, const double* x, const double* y)> ColumnHandler;
+
+protected:
+
+	//band ranges captured at the start of a run, indexed by StateId
+	vector<std::pair<int,int> > ranges[Definitions::stateCount];
+
+	unsigned int checkpointInterval;
+
+	//the buffers below live in the workspace and are set up by every forward run
+
+	//forward columns 0, k, 2k, ... - every column holds M, X and Y one after another
+	vector<double>* checkpoints;
+
+	//forward columns of the segment being consumed by the backward pass
+	vector<double>* segment;
+
+	//current and previous backward columns
+	vector<double>* backwardColumns;
+
+	//concurrent runs only: backward columns 0, k, 2k, ... and the backward columns of the segment being combined
+	vector<double>* backwardCheckpoints;
+	vector<double>* backwardSegment;
+
+	Definitions::PosteriorMode posteriorMode;
+
+	inline double* column(vector<double>& buffer, unsigned int idx)
+	{
+		return buffer.data() + idx * Definitions::stateCount * xSize;
+	}
+
+	void captureBand();
+
+	//captures the band and sizes the workspace buffers of a forward run
+	void prepareBuffers();
+
+	template<bool Ambiguous>
+	void forwardColumn(unsigned int j, const double* prev, double* cur);
+
+	template<bool Ambiguous>
+	void backwardColumn(unsigned int j, const double* next, double* cur);
+
+	//forward pass storing the checkpoints, the columns in between roll over the two columns at rolling
+	template<bool Ambiguous>
+	double forwardPass(double* rolling);
+
+	template<bool Ambiguous>
+	double runForward();
+
+	template<bool Ambiguous>
+	double runBackward(ColumnHandler& handler);
+
+	//Forward pass on a spare thread while the backward pass stores its own checkpoints. Then
+	//segment by segment from the last one, the helper recomputes the forward columns one segment
+	//ahead while this thread recomputes the backward ones and hands out the posteriors
+	template<bool Ambiguous>
+	double runConcurrent(ColumnHandler& handler);
+
+public:
+
+	CheckpointedPairHMM(vector<SequenceElement*>* s1, vector<SequenceElement*>* s2,
+			SubstitutionModelBase* smdl, IndelModel* imdl, Band* bandObj);
+
+	virtual ~CheckpointedPairHMM();
+
+	//forward pass storing the checkpoints, returns -lnL
+	double runAlgorithm();
+
+	//forward and backward pass, posterior columns are passed to handler from the last column
+	//down to 0. Returns the backward -lnL
+	double calculatePosteriors(ColumnHandler handler);
+
+	inline void setPosteriorMode(Definitions::PosteriorMode mode)
+	{
+		this->posteriorMode = mode;
+	}
+
+	inline unsigned int getCheckpointInterval() const
+	{
+		return checkpointInterval;
+	}
+};
+
+} /* namespace EBC */
+#endif /* CHECKPOINTEDPAIRHMM_HPP_ */
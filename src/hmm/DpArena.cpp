@@ -0,0 +1,112 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+#include "hmm/DpArena.hpp"
+#include "core/HmmException.hpp"
+
+#include <cstdlib>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace EBC
+{
+
+DpArena::DpArena() : memory(nullptr), bytes(0), mapped(false)
+{
+}
+
+DpArena::DpArena(size_t size, Definitions::DpPageMode mode) : memory(nullptr), bytes(0), mapped(false)
+{
+	allocate(size, mode);
+}
+
+DpArena::~DpArena()
+{
+	release();
+}
+
+void DpArena::reset(size_t size, Definitions::DpPageMode mode)
+{
+	release();
+	allocate(size, mode);
+}
+
+void DpArena::allocate(size_t size, Definitions::DpPageMode mode)
+{
+	size_t alignment = Definitions::dpArenaAlignment;
+
+	if (size == 0)
+		return;
+
+#ifdef __linux__
+	if (mode != Definitions::DpPageMode::Standard && size >= Definitions::hugePageMinArena)
+	{
+		size = ((size + Definitions::hugePageSize - 1) / Definitions::hugePageSize) * Definitions::hugePageSize;
+
+		if (mode == Definitions::DpPageMode::Huge)
+		{
+			//fails unless the administrator reserved a huge page pool
+			void* block = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			if (block != MAP_FAILED)
+			{
+				memory = block;
+				bytes = size;
+				mapped = true;
+				return;
+			}
+		}
+		alignment = Definitions::hugePageSize;
+	}
+#endif
+
+	void* block = nullptr;
+	if (posix_memalign(&block, alignment, size) != 0)
+		throw HmmException("DpArena : unable to allocate the dp matrix memory");
+
+	memory = block;
+	bytes = size;
+	mapped = false;
+
+#ifdef __linux__
+	//only a hint, older kernels or THP set to never simply ignore it
+	if (alignment == Definitions::hugePageSize)
+		madvise(memory, bytes, MADV_HUGEPAGE);
+#endif
+}
+
+void DpArena::release()
+{
+	if (memory == nullptr)
+		return;
+
+#ifdef __linux__
+	if (mapped)
+		munmap(memory, bytes);
+	else
+#endif
+		free(memory);
+
+	memory = nullptr;
+	bytes = 0;
+	mapped = false;
+}
+
+} /* namespace EBC */
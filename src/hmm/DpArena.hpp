@@ -0,0 +1,84 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+#ifndef DPARENA_HPP_
+#define DPARENA_HPP_
+
+#include "core/Definitions.hpp"
+
+#include <cstddef>
+
+namespace EBC
+{
+
+//One contiguous, cache line aligned block backing a dp matrix. Rows are padded to whole
+//cache lines so every row starts aligned, which is what the vectorised kernels assume.
+//On Linux large arenas can be backed by huge pages to cut TLB misses on long pairs.
+class DpArena
+{
+protected:
+
+	void* memory;
+
+	size_t bytes;
+
+	//true if memory came from mmap rather than the heap
+	bool mapped;
+
+	void allocate(size_t size, Definitions::DpPageMode mode);
+
+	void release();
+
+public:
+
+	DpArena();
+
+	DpArena(size_t size, Definitions::DpPageMode mode);
+
+	DpArena(const DpArena&) = delete;
+
+	DpArena& operator=(const DpArena&) = delete;
+
+	~DpArena();
+
+	//drops the old block, the new one is uninitialized
+	void reset(size_t size, Definitions::DpPageMode mode);
+
+	template<typename T>
+	inline T* get() const
+	{
+		return static_cast<T*>(memory);
+	}
+
+	inline size_t size() const
+	{
+		return bytes;
+	}
+
+	//row length in elements rounded up to whole cache lines
+	template<typename T>
+	static inline size_t paddedStride(size_t count)
+	{
+		const size_t perLine = Definitions::dpArenaAlignment / sizeof(T);
+		return ((count + perLine - 1) / perLine) * perLine;
+	}
+};
+
+} /* namespace EBC */
+#endif /* DPARENA_HPP_ */
@@ -0,0 +1,111 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+#include "hmm/DpMatrixBanded.hpp"
+#include <algorithm>
+
+using namespace std;
+
+namespace EBC
+{
+
+DpMatrixBanded::DpMatrixBanded(unsigned int xS, unsigned int yS, Band* bandObj, Definitions::DpPageMode pages) : DpMatrixBase(xS,yS), band(bandObj), pageMode(pages)
+{
+	this->allocateData();
+}
+
+DpMatrixBanded::~DpMatrixBanded()
+{
+}
+
+void DpMatrixBanded::allocateData()
+{
+	const int maxRow = xSize-2;
+	cells = 0;
+	int lo, hi;
+
+	columnLo.resize(ySize);
+	columnHi.resize(ySize);
+	columnOffset.resize(ySize);
+
+	auto extend = [&](std::pair<int, int> range)
+	{
+		if (range.first < 0 || range.second < range.first)
+			return;
+		lo = std::min(lo, range.first);
+		hi = std::max(hi, range.second);
+	};
+
+	for(unsigned int j = 0; j < ySize; j++)
+	{
+		lo = maxRow+1;
+		hi = -1;
+
+		if (j == 0 || j == ySize-1)
+		{
+			//start cell and the fully initialized last column
+			lo = 0;
+			hi = j == 0 ? 0 : maxRow;
+		}
+
+		extend(band->getMatchRangeAt(j));
+		extend(band->getInsertRangeAt(j));
+		extend(band->getDeleteRangeAt(j));
+
+		hi = std::min(hi, maxRow);
+		if (lo > hi)
+		{
+			lo = 1;
+			hi = 0;
+		}
+
+		columnLo[j] = lo;
+		columnHi[j] = hi;
+		columnOffset[j] = static_cast<long>(cells) - lo;
+		cells += hi - lo + 1;
+	}
+
+	arena.reset(cells*sizeof(double), pageMode);
+	data = arena.get<double>();
+	std::fill(data, data + cells, minVal);
+	lastRow.assign(ySize, minVal);
+
+	DUMP("Banded dp matrix " << xSize << "x" << ySize << " stores " << cells + ySize << " cells");
+}
+
+void DpMatrixBanded::setWholeRow(unsigned int row, double value)
+{
+	if (row == xSize-1)
+	{
+		std::fill(lastRow.begin(), lastRow.end(), value);
+		return;
+	}
+	for(unsigned int j = 0; j < ySize; j++)
+		if (static_cast<int>(row) >= columnLo[j] && static_cast<int>(row) <= columnHi[j])
+			data[columnOffset[j] + row] = value;
+}
+
+void DpMatrixBanded::setWholeCol(unsigned int col, double value)
+{
+	for(int i = columnLo[col]; i <= columnHi[col]; i++)
+		data[columnOffset[col] + i] = value;
+	lastRow[col] = value;
+}
+
+} /* namespace EBC */
@@ -0,0 +1,119 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+#ifndef DPMATRIXBANDED_H_
+#define DPMATRIXBANDED_H_
+
+#include "hmm/DpMatrixBase.hpp"
+#include "hmm/DpArena.hpp"
+#include "heuristics/Band.hpp"
+#include "core/Definitions.hpp"
+
+#include <vector>
+
+using namespace std;
+
+namespace EBC
+{
+
+//Stores only the rows of every column that the band covers (union of the M/X/Y ranges)
+//Reads outside the band return the minimum likelihood sentinel, writes outside are ignored.
+//The ranges are taken from the band at construction time.
+//The last row and the last column are kept in full - the backward pass initializes them entirely
+class DpMatrixBanded : public DpMatrixBase
+{
+
+protected:
+
+	//stored rows of every column, the last row excluded
+	vector<int> columnLo;
+	vector<int> columnHi;
+
+	//position of row 0 of every column in data (may point before the column start)
+	vector<long> columnOffset;
+
+	//band cells of all columns packed into one aligned block
+	DpArena arena;
+
+	double* data;
+
+	size_t cells;
+
+	vector<double> lastRow;
+
+	Band* band;
+
+	//backing memory of the arena
+	Definitions::DpPageMode pageMode;
+
+	void allocateData();
+
+public:
+
+	DpMatrixBanded(unsigned int xSize, unsigned int ySize, Band* bandObj, Definitions::DpPageMode pages = Definitions::DpPageMode::Standard);
+
+	virtual ~DpMatrixBanded();
+
+	inline void setValue(unsigned int i,unsigned int j, double value)
+	{
+		if (i == xSize-1)
+			lastRow[j] = value;
+		else if (static_cast<int>(i) >= columnLo[j] && static_cast<int>(i) <= columnHi[j])
+			data[columnOffset[j] + i] = value;
+	}
+
+	inline double valueAt(unsigned int i, unsigned int j)
+	{
+		if (i == xSize-1)
+			return lastRow[j];
+		if (static_cast<int>(i) < columnLo[j] || static_cast<int>(i) > columnHi[j])
+			return minVal;
+		return data[columnOffset[j] + i];
+	}
+
+	//band part of column j, the last row is always stored on top of it
+	inline std::pair<int, int> getColumnRange(unsigned int j)
+	{
+		return std::make_pair(columnLo[j], columnHi[j]);
+	}
+
+	inline size_t getStoredCells()
+	{
+		return cells + lastRow.size();
+	}
+
+	void setWholeRow(unsigned int row, double value);
+
+	void setWholeCol(unsigned int col, double value);
+
+	void setSrc(unsigned int i, unsigned int j, DpMatrixBase*) {}
+
+	void setDiagonalAt(unsigned int i, unsigned int j) {}
+
+	void setHorizontalAt(unsigned int i, unsigned int j) {}
+
+	void setVerticalAt(unsigned int i, unsigned int j) {}
+
+	void traceback(string& seq_a, string& seq_b, std::pair<string,string>* alignment) {}
+
+	void tracebackRaw(vector<SequenceElement> s1, vector<SequenceElement> s2, Dictionary* dict, vector<std::pair<unsigned int, unsigned int> >&) {}
+};
+
+} /* namespace EBC */
+#endif /* DPMATRIXBANDED_H_ */
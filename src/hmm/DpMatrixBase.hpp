@@ -59,6 +59,16 @@ public:
 
 	virtual ~DpMatrixBase() {}
 
+	inline unsigned int getXSize() const
+	{
+		return xSize;
+	}
+
+	inline unsigned int getYSize() const
+	{
+		return ySize;
+	}
+
 	virtual void setValue(unsigned int x,unsigned int y, double value)=0;
 
 	virtual double valueAt(unsigned int i, unsigned int j)=0;
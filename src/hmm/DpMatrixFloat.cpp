@@ -0,0 +1,57 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+#include "hmm/DpMatrixFloat.hpp"
+#include <algorithm>
+
+using namespace std;
+
+namespace EBC
+{
+
+DpMatrixFloat::DpMatrixFloat(unsigned int xS, unsigned int yS, Definitions::DpPageMode pages) : DpMatrixBase(xS,yS), pageMode(pages)
+{
+	this->allocateData();
+}
+
+DpMatrixFloat::~DpMatrixFloat()
+{
+}
+
+void DpMatrixFloat::allocateData()
+{
+	colStride = DpArena::paddedStride<float>(xSize);
+	arena.reset(static_cast<size_t>(ySize)*colStride*sizeof(float), pageMode);
+	data = arena.get<float>();
+	//set the value to zero prob, padding included
+	std::fill(data, data + static_cast<size_t>(ySize)*colStride, static_cast<float>(minVal));
+}
+
+void DpMatrixFloat::setWholeRow(unsigned int row, double value)
+{
+	for(unsigned int j = 0; j < ySize; j++)
+		data[static_cast<size_t>(j)*colStride + row] = static_cast<float>(value);
+}
+
+void DpMatrixFloat::setWholeCol(unsigned int col, double value)
+{
+	std::fill(data + static_cast<size_t>(col)*colStride, data + static_cast<size_t>(col)*colStride + xSize, static_cast<float>(value));
+}
+
+} /* namespace EBC */
@@ -0,0 +1,94 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+#ifndef DPMATRIXFLOAT_H_
+#define DPMATRIXFLOAT_H_
+
+#include "hmm/DpMatrixBase.hpp"
+#include "hmm/DpArena.hpp"
+#include "core/Definitions.hpp"
+
+#include <vector>
+
+using namespace std;
+
+namespace EBC
+{
+
+//Full dp matrix kept in single precision, one contiguous column-major block with cache line padded columns.
+//Values are rounded to float on write and widened to double on read, so kernels keep
+//doing their arithmetic in double - only the storage (and memory traffic) is halved
+class DpMatrixFloat : public DpMatrixBase
+{
+
+protected:
+
+	DpArena arena;
+
+	float* data;
+
+	//column j starts at j*colStride
+	size_t colStride;
+
+	//backing memory of the arena
+	Definitions::DpPageMode pageMode;
+
+	void allocateData();
+
+public:
+
+	DpMatrixFloat(unsigned int xSize, unsigned int ySize, Definitions::DpPageMode pages = Definitions::DpPageMode::Standard);
+
+	virtual ~DpMatrixFloat();
+
+	inline void setValue(unsigned int i,unsigned int j, double value)
+	{
+		data[static_cast<size_t>(j)*colStride + i] = static_cast<float>(value);
+	}
+
+	inline double valueAt(unsigned int i, unsigned int j)
+	{
+		return data[static_cast<size_t>(j)*colStride + i];
+	}
+
+	//every row but the last one, same convention as DpMatrixFull
+	inline std::pair<int, int> getColumnRange(unsigned int j)
+	{
+		return std::make_pair(0, static_cast<int>(xSize)-2);
+	}
+
+	void setWholeRow(unsigned int row, double value);
+
+	void setWholeCol(unsigned int col, double value);
+
+	void setSrc(unsigned int i, unsigned int j, DpMatrixBase*) {}
+
+	void setDiagonalAt(unsigned int i, unsigned int j) {}
+
+	void setHorizontalAt(unsigned int i, unsigned int j) {}
+
+	void setVerticalAt(unsigned int i, unsigned int j) {}
+
+	void traceback(string& seq_a, string& seq_b, std::pair<string,string>* alignment) {}
+
+	void tracebackRaw(vector<SequenceElement> s1, vector<SequenceElement> s2, Dictionary* dict, vector<std::pair<unsigned int, unsigned int> >&) {}
+};
+
+} /* namespace EBC */
+#endif /* DPMATRIXFLOAT_H_ */
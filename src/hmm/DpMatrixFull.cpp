@@ -22,50 +22,35 @@
 #include <iostream>
 #include <cmath>
 #include <sstream>
+#include <algorithm>
 
 using namespace std;
 
 void EBC::DpMatrixFull::allocateData()
 {
-	matrixData = new double*[xSize];
 	double minProb = EBC::Definitions::minMatrixLikelihood;
-	//matrixData = new TraceStep*[xSize];
-	for(unsigned int i=0; i<xSize; i++)
-	{
-		//matrixData[i] = new TraceStep[ySize];
-		matrixData[i] = new double[ySize];
-		//set the value to zero prob
-		std::fill(matrixData[i], matrixData[i]+ySize, minProb);
 
-	}
+	colStride = DpArena::paddedStride<double>(xSize);
+	arena.reset(static_cast<size_t>(ySize)*colStride*sizeof(double), pageMode);
+	matrixData = arena.get<double>();
+	//set the value to zero prob, padding included
+	std::fill(matrixData, matrixData + static_cast<size_t>(ySize)*colStride, minProb);
 }
 
 EBC::DpMatrixFull::~DpMatrixFull()
 {
-	for(unsigned int i=0; i<xSize; i++)
-	{
-		delete[] matrixData[i];
-	}
-	delete[] matrixData;
 }
 
-EBC::DpMatrixFull::DpMatrixFull(unsigned int xS, unsigned int yS) : DpMatrixBase(xS,yS)
+EBC::DpMatrixFull::DpMatrixFull(unsigned int xS, unsigned int yS, Definitions::DpPageMode pages) : DpMatrixBase(xS,yS), pageMode(pages)
 {
 	this->allocateData();
 }
 
-void EBC::DpMatrixFull::setValue(unsigned int x, unsigned int y, double value)
-{
-	//TODO - check bounds
-	//matrixData[x][y].score = value;
-	matrixData[x][y] = value;
-}
-
 void EBC::DpMatrixFull::setWholeRow(unsigned int row, double value)
 {
 	for (unsigned int i=0; i<ySize; i++)
 	{
-		matrixData[row][i] = value;
+		matrixData[i*colStride + row] = value;
 		//matrixData[row][i].score = value;
 		//matrixData[row][i].hor = true;
 		//matrixData[row][i].src = this;
@@ -76,7 +61,7 @@ void EBC::DpMatrixFull::setWholeCol(unsigned int col, double value)
 {
 	for (unsigned int i=0; i<xSize; i++)
 	{
-		matrixData[i][col] = value;
+		matrixData[col*colStride + i] = value;
 		//matrixData[i][col].score = value;
 		//matrixData[i][col].vert = true;
 		//matrixData[i][col].src = this;
@@ -84,11 +69,6 @@ void EBC::DpMatrixFull::setWholeCol(unsigned int col, double value)
 }
 
 
-double EBC::DpMatrixFull::valueAt(unsigned int i, unsigned int j)
-{
-	return matrixData[i][j];//.score;
-}
-
 void EBC::DpMatrixFull::outputTrace(unsigned int bound=0)
 {
 	/*
@@ -140,7 +120,7 @@ void EBC::DpMatrixFull::outputValues(unsigned int bound=0)
 
 
 			//if (ts.score > -5.0)
-				sstr << matrixData[i][j] *-1.0 << "\t";
+				sstr << valueAt(i,j) *-1.0 << "\t";
 			//else sstr << ".";
 
 		}
@@ -158,7 +138,7 @@ void EBC::DpMatrixFull::outputValuesWithBands(const vector<pair<int, int> >& ban
 		{
 			for(unsigned int j=0; j < ySize; j++)
 			{
-				if (matrixData[i][j] <= (Definitions::minMatrixLikelihood /2.0))
+				if (valueAt(i,j) <= (Definitions::minMatrixLikelihood /2.0))
 				{
 					if (band[j].first <= i && band[j].second >= i)
 						sstr << "*";
@@ -22,6 +22,7 @@
 
 
 #include "hmm/DpMatrixBase.hpp"
+#include "hmm/DpArena.hpp"
 #include "core/Definitions.hpp"
 
 #include <vector>
@@ -51,6 +52,14 @@ class DpMatrixFull : public DpMatrixBase
 
 protected:
 
+	//column-major like the kernel sweeps, column j starts at j*colStride in one aligned block
+	DpArena arena;
+
+	size_t colStride;
+
+	//backing memory of the arena
+	Definitions::DpPageMode pageMode;
+
 	void allocateData();
 
 public:
@@ -59,20 +68,32 @@ public:
 
 	void setWholeCol(unsigned int col, double value);
 
-	double  ** matrixData;
+	double* matrixData;
 	//TraceStep ** matrixData;
 
 	void traceback(string& seqA, string& seqB, std::pair<string,string>* alignment);
 
 	void tracebackRaw(vector<SequenceElement> s1, vector<SequenceElement> s2, Dictionary* dict, vector<std::pair<unsigned int, unsigned int> >&);
 
-	DpMatrixFull(unsigned int xSize, unsigned int ySize);
+	DpMatrixFull(unsigned int xSize, unsigned int ySize, Definitions::DpPageMode pages = Definitions::DpPageMode::Standard);
 
 	virtual ~DpMatrixFull();
 
-	void setValue(unsigned int x,unsigned int y, double value);
+	inline void setValue(unsigned int x,unsigned int y, double value)
+	{
+		matrixData[y*colStride + x] = value;
+	}
 
-	double valueAt(unsigned int i, unsigned int j);
+	inline double valueAt(unsigned int i, unsigned int j)
+	{
+		return matrixData[j*colStride + i];
+	}
+
+	//every row but the last one, same convention as DpMatrixBanded
+	inline std::pair<int, int> getColumnRange(unsigned int j)
+	{
+		return std::make_pair(0, static_cast<int>(xSize)-2);
+	}
 
 	void setDiagonalAt(unsigned int i, unsigned int j);
 
@@ -0,0 +1,107 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+#include "hmm/DpMatrixRolling.hpp"
+#include <algorithm>
+
+using namespace std;
+
+namespace EBC
+{
+
+DpMatrixRolling::DpMatrixRolling(unsigned int xS, unsigned int yS, Band* bandObj) : DpMatrixBase(xS,yS), band(bandObj)
+{
+	this->allocateData();
+}
+
+DpMatrixRolling::~DpMatrixRolling()
+{
+}
+
+void DpMatrixRolling::allocateData()
+{
+	const int maxRow = xSize-1;
+	int width = 0;
+	int lo, hi;
+
+	columnLo.resize(ySize);
+	columnHi.resize(ySize);
+
+	auto extend = [&](std::pair<int, int> range)
+	{
+		if (range.first < 0 || range.second < range.first)
+			return;
+		lo = std::min(lo, range.first);
+		hi = std::max(hi, range.second);
+	};
+
+	for(unsigned int j = 0; j < ySize; j++)
+	{
+		lo = maxRow+1;
+		hi = -1;
+
+		if (j == 0)
+		{
+			//start cell
+			lo = 0;
+			hi = 0;
+		}
+
+		extend(band->getMatchRangeAt(j));
+		extend(band->getInsertRangeAt(j));
+		extend(band->getDeleteRangeAt(j));
+
+		hi = std::min(hi, maxRow);
+		if (lo > hi)
+		{
+			lo = 1;
+			hi = 0;
+		}
+
+		columnLo[j] = lo;
+		columnHi[j] = hi;
+		width = std::max(width, hi - lo + 1);
+	}
+
+	buffer[0].assign(width, minVal);
+	buffer[1].assign(width, minVal);
+	slotColumn[0] = slotColumn[1] = -1;
+
+	DUMP("Rolling dp matrix " << xSize << "x" << ySize << " stores " << 2*width << " cells");
+}
+
+void DpMatrixRolling::setWholeRow(unsigned int row, double value)
+{
+	//only the resident columns exist
+	for(unsigned int slot = 0; slot < 2; slot++)
+	{
+		int j = slotColumn[slot];
+		if (j >= 0 && static_cast<int>(row) >= columnLo[j] && static_cast<int>(row) <= columnHi[j])
+			buffer[slot][row - columnLo[j]] = value;
+	}
+}
+
+void DpMatrixRolling::setWholeCol(unsigned int col, double value)
+{
+	unsigned int slot = col & 1;
+	claimSlot(slot, col);
+	std::fill(buffer[slot].begin(), buffer[slot].end(), value);
+}
+
+} /* namespace EBC */
@@ -0,0 +1,110 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+#ifndef DPMATRIXROLLING_H_
+#define DPMATRIXROLLING_H_
+
+#include "hmm/DpMatrixBase.hpp"
+#include "heuristics/Band.hpp"
+#include "core/Definitions.hpp"
+
+#include <vector>
+
+using namespace std;
+
+namespace EBC
+{
+
+//Keeps only the two most recent columns of the band - enough for a column by column
+//forward pass that needs the final likelihood only.
+//Memory is O(band width), cells of columns that are no longer resident read as the
+//minimum likelihood sentinel. The ranges are taken from the band at construction time.
+class DpMatrixRolling : public DpMatrixBase
+{
+
+protected:
+
+	//stored rows of every column (union of the M/X/Y band ranges)
+	vector<int> columnLo;
+	vector<int> columnHi;
+
+	//two column slots, column j lives in slot j&1
+	vector<double> buffer[2];
+
+	//column held by each slot, -1 when empty
+	int slotColumn[2];
+
+	Band* band;
+
+	void allocateData();
+
+	//hands the slot over to a new column, the whole slot goes back to the sentinel
+	inline void claimSlot(unsigned int slot, unsigned int j)
+	{
+		std::fill(buffer[slot].begin(), buffer[slot].end(), minVal);
+		slotColumn[slot] = j;
+	}
+
+public:
+
+	DpMatrixRolling(unsigned int xSize, unsigned int ySize, Band* bandObj);
+
+	virtual ~DpMatrixRolling();
+
+	inline void setValue(unsigned int i,unsigned int j, double value)
+	{
+		unsigned int slot = j & 1;
+		if (slotColumn[slot] != static_cast<int>(j))
+			claimSlot(slot, j);
+		if (static_cast<int>(i) >= columnLo[j] && static_cast<int>(i) <= columnHi[j])
+			buffer[slot][i - columnLo[j]] = value;
+	}
+
+	inline double valueAt(unsigned int i, unsigned int j)
+	{
+		unsigned int slot = j & 1;
+		if (slotColumn[slot] != static_cast<int>(j) || static_cast<int>(i) < columnLo[j] || static_cast<int>(i) > columnHi[j])
+			return minVal;
+		return buffer[slot][i - columnLo[j]];
+	}
+
+	inline size_t getStoredCells()
+	{
+		return buffer[0].size() + buffer[1].size();
+	}
+
+	void setWholeRow(unsigned int row, double value);
+
+	void setWholeCol(unsigned int col, double value);
+
+	void setSrc(unsigned int i, unsigned int j, DpMatrixBase*) {}
+
+	void setDiagonalAt(unsigned int i, unsigned int j) {}
+
+	void setHorizontalAt(unsigned int i, unsigned int j) {}
+
+	void setVerticalAt(unsigned int i, unsigned int j) {}
+
+	void traceback(string& seq_a, string& seq_b, std::pair<string,string>* alignment) {}
+
+	void tracebackRaw(vector<SequenceElement> s1, vector<SequenceElement> s2, Dictionary* dict, vector<std::pair<unsigned int, unsigned int> >&) {}
+};
+
+} /* namespace EBC */
+#endif /* DPMATRIXROLLING_H_ */
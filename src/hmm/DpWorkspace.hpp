@@ -0,0 +1,122 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+
+#ifndef DPWORKSPACE_HPP_
+#define DPWORKSPACE_HPP_
+
+#include "core/Definitions.hpp"
+
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+namespace EBC
+{
+
+//Scratch memory of the DP kernels. A worker thread hands one workspace to every HMM it runs,
+//the buffers only grow, so once the worker has seen its longest pair nothing is allocated
+//any more - neither between optimizer iterations nor between pairs.
+//Kernels of one thread never overlap, every buffer belongs to one run at a time.
+class DpWorkspace
+{
+public:
+
+	//per state buffers take stateCount consecutive entries
+	enum Buffer {ColumnLo, ColumnHi = ColumnLo + Definitions::stateCount,
+		ReversedLo = ColumnHi + Definitions::stateCount, ReversedHi = ReversedLo + Definitions::stateCount,
+		EmissionX = ReversedHi + Definitions::stateCount, EmissionY, EmissionM, EmissionMDt, EmissionMDt2,
+		SymbolsX, SymbolsY, LinearX, LinearY, LinearM, LinearMDt, LinearMDt2, RunPrefixX, RunPrefixY,
+		PaddedX, PaddedY, PaddedSymbolsX, PaddedSymbolsY, DiagonalLo, DiagonalHi,
+		Profile, PairTable, Checkpoints, Segment, BackwardColumns, BackwardCheckpoints, BackwardSegment,
+		TileRows, TileColumns = TileRows + Definitions::stateCount, TileCorners = TileColumns + Definitions::stateCount,
+		bufferCount};
+
+protected:
+
+	//rolling DP columns, clean (every cell holds value) up to the first clean cells
+	template<typename T>
+	struct ColumnBuffer
+	{
+		vector<T> data;
+		T value;
+		size_t clean;
+		size_t acquired;
+	};
+
+	vector<double> doubleBuffers[bufferCount];
+	vector<float> floatBuffers[bufferCount];
+	vector<int> intBuffers[bufferCount];
+	vector<unsigned int> uintBuffers[bufferCount];
+
+	ColumnBuffer<double> doubleColumns;
+	ColumnBuffer<float> floatColumns;
+	ColumnBuffer<int> intColumns;
+
+	inline vector<double>* buffers(double*) { return doubleBuffers; }
+	inline vector<float>* buffers(float*) { return floatBuffers; }
+	inline vector<int>* buffers(int*) { return intBuffers; }
+	inline vector<unsigned int>* buffers(unsigned int*) { return uintBuffers; }
+
+	inline ColumnBuffer<double>& columns(double*) { return doubleColumns; }
+	inline ColumnBuffer<float>& columns(float*) { return floatColumns; }
+	inline ColumnBuffer<int>& columns(int*) { return intColumns; }
+
+public:
+
+	DpWorkspace();
+
+	virtual ~DpWorkspace();
+
+	//a buffer with whatever the last run left in it, size it with assign or resize
+	template<typename T>
+	inline vector<T>& getBuffer(Buffer b)
+	{
+		return buffers(static_cast<T*>(nullptr))[b];
+	}
+
+	//count cells set to value. Only the part a previous run handed back dirty is filled
+	template<typename T>
+	T* getColumns(size_t count, T value)
+	{
+		ColumnBuffer<T>& cb = columns(static_cast<T*>(nullptr));
+		if (cb.data.size() < count)
+			cb.data.resize(count);
+		if (cb.clean > 0 && cb.value != value)
+			cb.clean = 0;
+		if (cb.clean < count)
+			std::fill(cb.data.begin() + cb.clean, cb.data.begin() + count, value);
+		cb.value = value;
+		cb.clean = 0;
+		cb.acquired = count;
+		return cb.data.data();
+	}
+
+	//the run has put every cell it wrote back to the value it got the columns with
+	template<typename T>
+	inline void releaseColumns()
+	{
+		ColumnBuffer<T>& cb = columns(static_cast<T*>(nullptr));
+		cb.clean = cb.acquired;
+	}
+};
+
+} /* namespace EBC */
+#endif /* DPWORKSPACE_HPP_ */
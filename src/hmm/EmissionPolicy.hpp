@@ -0,0 +1,62 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+
+#ifndef EMISSIONPOLICY_HPP_
+#define EMISSIONPOLICY_HPP_
+
+#include "core/PMatrixDouble.hpp"
+#include "core/SequenceElement.hpp"
+
+namespace EBC
+{
+
+//Emission lookups for the DP kernels, resolved at compile time on whether
+//any of the two sequences contains FASTA ambiguity classes
+template<bool Ambiguous>
+struct EmissionPolicy
+{
+	static inline double single(PMatrixDouble* pt, SequenceElement* se)
+	{
+		return pt->getLogEquilibriumFreqSymbol(se);
+	}
+
+	static inline double pair(PMatrixDouble* pt, SequenceElement* se1, SequenceElement* se2)
+	{
+		return pt->getLogPairTransitionSymbol(se1, se2);
+	}
+};
+
+//plain symbols only - direct table lookups
+template<>
+struct EmissionPolicy<false>
+{
+	static inline double single(PMatrixDouble* pt, SequenceElement* se)
+	{
+		return pt->getLogEquilibriumFreq(se->getMatrixIndex());
+	}
+
+	static inline double pair(PMatrixDouble* pt, SequenceElement* se1, SequenceElement* se2)
+	{
+		return pt->getLogPairTransition(se1->getMatrixIndex(), se2->getMatrixIndex());
+	}
+};
+
+} /* namespace EBC */
+#endif /* EMISSIONPOLICY_HPP_ */
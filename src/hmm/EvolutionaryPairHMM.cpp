@@ -18,7 +18,9 @@
 //==============================================================================
 
 #include "hmm/EvolutionaryPairHMM.hpp"
+#include "core/WavefrontScheduler.hpp"
 #include "hmm/DpMatrixFull.hpp"
+#include "hmm/DpMatrixFloat.hpp"
 #include "models/NegativeBinomialGapModel.hpp"
 
 namespace EBC
@@ -40,9 +42,20 @@ EvolutionaryPairHMM::EvolutionaryPairHMM(vector<SequenceElement*>* s1, vector<Se
 	this->xSize = seq1->size() +1;
 	this->ySize = seq2->size() +1;
 
+	ambiguousSequences = false;
+	for (auto el : *seq1)
+		ambiguousSequences |= el->isFastaClass();
+	for (auto el : *seq2)
+		ambiguousSequences |= el->isFastaClass();
+
 	DEBUG("#######Evolutionary Pair HMM constructor for seqence 1 with size " << xSize << " and sequence 2 with size " << ySize);
 
 	ptmatrix = new PMatrixDouble(substModel);
+	if (ambiguousSequences)
+	{
+		ptmatrix->addSymbols(seq1);
+		ptmatrix->addSymbols(seq2);
+	}
 
 	this->tpb = new TransitionProbabilities(indelModel);
 
@@ -56,9 +69,20 @@ EvolutionaryPairHMM::EvolutionaryPairHMM(vector<SequenceElement*>* s1, vector<Se
 
 	initTransX = initTransY = initTransM = 0;
 
+	precision = defaultPrecision;
+	pageMode = defaultPageMode;
+
+	workspace = ownWorkspace = nullptr;
+
 	initializeStates(mt);
 }
 
+Definitions::DpPrecision EvolutionaryPairHMM::defaultPrecision = Definitions::DpPrecision::Double;
+
+Definitions::DpPageMode EvolutionaryPairHMM::defaultPageMode = Definitions::DpPageMode::Standard;
+
+Definitions::PosteriorMode EvolutionaryPairHMM::defaultPosteriorMode = Definitions::PosteriorMode::Concurrent;
+
 void EvolutionaryPairHMM::setDivergenceTimeAndCalculateModels(double time)
 {
 	ptmatrix->setTime(time);
@@ -72,10 +96,9 @@ void EvolutionaryPairHMM::setDivergenceTimeAndCalculateModels(double time)
 
 }
 
-void EvolutionaryPairHMM::getStateEquilibriums()
+void EvolutionaryPairHMM::calculateStateEquilibriums(double g, double e, double md[][Definitions::stateCount],
+		double& pM, double& pI, double& pD)
 {
-	double minPi = exp(Definitions::minMatrixLikelihood);
-
 	//TODO - change indices to state ids from the enum!!!
 	md[0][0] = (1.0-2*g);
 	md[1][1] = e+((1.0-e)*g);
@@ -89,9 +112,16 @@ void EvolutionaryPairHMM::getStateEquilibriums()
 	md[2][1] = (1.0-e)*g;
 	md[1][2] = (1.0-e)*g;
 
-	piD = ((1.0-md[0][0])+(md[0][1]*(1.0-md[0][0]+md[1][0])/(md[1][1]-1.0-md[0][1])))/(((md[0][1]-md[2][1])*(1.0-md[0][0]+md[1][0])/(md[1][1]-1.0-md[0][1]))+md[2][0]-md[0][0]+1);
-	piI = ((piD*(md[0][1]-md[2][1]))-md[0][1])/(md[1][1]-1.0-md[0][1]);
-	piM = 1.0 -piI - piD;
+	pD = ((1.0-md[0][0])+(md[0][1]*(1.0-md[0][0]+md[1][0])/(md[1][1]-1.0-md[0][1])))/(((md[0][1]-md[2][1])*(1.0-md[0][0]+md[1][0])/(md[1][1]-1.0-md[0][1]))+md[2][0]-md[0][0]+1);
+	pI = ((pD*(md[0][1]-md[2][1]))-md[0][1])/(md[1][1]-1.0-md[0][1]);
+	pM = 1.0 -pI - pD;
+}
+
+void EvolutionaryPairHMM::getStateEquilibriums()
+{
+	double minPi = exp(Definitions::minMatrixLikelihood);
+
+	calculateStateEquilibriums(g, e, md, piM, piI, piD);
 
 	DUMP("Decimal equilibriums : PiM\t" << piM << "\tPiI\t" << piI << "\tPiD\t" << piD);
 
@@ -107,9 +137,9 @@ void EvolutionaryPairHMM::getStateEquilibriums()
 	piI = (piI- (xi/3.0)) < minPi ? Definitions::minMatrixLikelihood : log(piI- (xi/3.0));
 	piM = (piM- (xi/3.0)) < minPi ? Definitions::minMatrixLikelihood : log(piM- (xi/3.0));
 
-	initTransX = maths->logSum(X->getTransitionProbabilityFromInsert() + piI, X->getTransitionProbabilityFromDelete() + piD, X->getTransitionProbabilityFromMatch() + piM);
-	initTransY = maths->logSum(Y->getTransitionProbabilityFromInsert() + piI, Y->getTransitionProbabilityFromDelete() + piD, Y->getTransitionProbabilityFromMatch() + piM);
-	initTransM = maths->logSum(M->getTransitionProbabilityFromInsert() + piI, M->getTransitionProbabilityFromDelete() + piD, M->getTransitionProbabilityFromMatch() + piM);
+	initTransX = LogSumExp::logSum(X->getTransitionProbabilityFromInsert() + piI, X->getTransitionProbabilityFromDelete() + piD, X->getTransitionProbabilityFromMatch() + piM);
+	initTransY = LogSumExp::logSum(Y->getTransitionProbabilityFromInsert() + piI, Y->getTransitionProbabilityFromDelete() + piD, Y->getTransitionProbabilityFromMatch() + piM);
+	initTransM = LogSumExp::logSum(M->getTransitionProbabilityFromInsert() + piI, M->getTransitionProbabilityFromDelete() + piD, M->getTransitionProbabilityFromMatch() + piM);
 
 
 
@@ -128,23 +158,44 @@ void EvolutionaryPairHMM::getStateEquilibriums()
 	//DUMP("Initial transition likelihood component : M\t" << initTransM << "\tI\t" << initTransX << "\tD\t" << initTransY);
 }
 
+void EvolutionaryPairHMM::calculateTransitionProbabilities(double g, double e, double xi,
+		double trans[][Definitions::stateCount])
+{
+	trans[Definitions::Match][Definitions::Match] = log((1-2*g)*(1-xi));
+	trans[Definitions::Match][Definitions::Insert] = log((1-e-xi)*(1-2*g));
+	trans[Definitions::Match][Definitions::Delete] = log((1-e-xi)*(1-2*g));
+
+	trans[Definitions::Insert][Definitions::Insert] = log(e+((1-e-xi)*g));
+	trans[Definitions::Delete][Definitions::Delete] = log(e+((1-e-xi)*g));
+
+	trans[Definitions::Insert][Definitions::Delete] = log((1-e-xi)*g);
+	trans[Definitions::Delete][Definitions::Insert] = log((1-e-xi)*g);
+
+	trans[Definitions::Insert][Definitions::Match] = log(g*(1-xi));
+	trans[Definitions::Delete][Definitions::Match] = log(g*(1-xi));
+}
+
 void EvolutionaryPairHMM::setTransitionProbabilities()
 {
+	double trans[Definitions::stateCount][Definitions::stateCount];
+
 	e = tpb->getGapExtension();
 	g = tpb->getGapOpening();
 
-	M->setTransitionProbabilityFromMatch(log((1-2*g)*(1-xi)));
-	M->setTransitionProbabilityFromInsert(log((1-e-xi)*(1-2*g)));
-	M->setTransitionProbabilityFromDelete(log((1-e-xi)*(1-2*g)));
+	calculateTransitionProbabilities(g, e, xi, trans);
 
-	X->setTransitionProbabilityFromInsert(log(e+((1-e-xi)*g)));
-	Y->setTransitionProbabilityFromDelete(log(e+((1-e-xi)*g)));
+	M->setTransitionProbabilityFromMatch(trans[Definitions::Match][Definitions::Match]);
+	M->setTransitionProbabilityFromInsert(trans[Definitions::Match][Definitions::Insert]);
+	M->setTransitionProbabilityFromDelete(trans[Definitions::Match][Definitions::Delete]);
 
-	X->setTransitionProbabilityFromDelete(log((1-e-xi)*g));
-	Y->setTransitionProbabilityFromInsert(log((1-e-xi)*g));
+	X->setTransitionProbabilityFromInsert(trans[Definitions::Insert][Definitions::Insert]);
+	Y->setTransitionProbabilityFromDelete(trans[Definitions::Delete][Definitions::Delete]);
 
-	X->setTransitionProbabilityFromMatch(log(g*(1-xi)));
-	Y->setTransitionProbabilityFromMatch(log(g*(1-xi)));
+	X->setTransitionProbabilityFromDelete(trans[Definitions::Insert][Definitions::Delete]);
+	Y->setTransitionProbabilityFromInsert(trans[Definitions::Delete][Definitions::Insert]);
+
+	X->setTransitionProbabilityFromMatch(trans[Definitions::Insert][Definitions::Match]);
+	Y->setTransitionProbabilityFromMatch(trans[Definitions::Delete][Definitions::Match]);
 
 	/*
 	DUMP(" Transition probabilities: ");
@@ -184,22 +235,64 @@ void EvolutionaryPairHMM::initializeStates(Definitions::DpMatrixType mt)
 	if (Y != NULL)
 		delete Y;
 
+	//single precision swaps the full matrices for their float variant
+	if (mt == Definitions::DpMatrixType::Full && precision == Definitions::DpPrecision::Single)
+		mt = Definitions::DpMatrixType::FullFloat;
+	if (mt == Definitions::DpMatrixType::Banded && band == NULL && precision == Definitions::DpPrecision::Single)
+		mt = Definitions::DpMatrixType::FullFloat;
+
+	matrixType = mt;
+
 	switch (mt)
 	{
+	case Definitions::DpMatrixType::FullFloat :
+		M = new PairwiseHmmMatchState(new DpMatrixFloat(xSize,ySize,pageMode));
+		X = new PairwiseHmmInsertState(new DpMatrixFloat(xSize,ySize,pageMode));
+		Y = new PairwiseHmmDeleteState(new DpMatrixFloat(xSize,ySize,pageMode));
+		break;
 	case Definitions::DpMatrixType::Full :
-		M = new PairwiseHmmMatchState(xSize,ySize);
-		X = new PairwiseHmmInsertState(xSize,ySize);
-		Y = new PairwiseHmmDeleteState(xSize,ySize);
+		M = new PairwiseHmmMatchState(new DpMatrixFull(xSize,ySize,pageMode));
+		X = new PairwiseHmmInsertState(new DpMatrixFull(xSize,ySize,pageMode));
+		Y = new PairwiseHmmDeleteState(new DpMatrixFull(xSize,ySize,pageMode));
 		break;
 	case Definitions::DpMatrixType::Limited :
 		M = new PairwiseHmmMatchState(new DpMatrixLoMem(xSize,ySize));
 		X = new PairwiseHmmInsertState(new DpMatrixLoMem(xSize,ySize));
 		Y = new PairwiseHmmDeleteState(new DpMatrixLoMem(xSize,ySize));
 		break;
+	case Definitions::DpMatrixType::Banded :
+		if (band != NULL)
+		{
+			M = new PairwiseHmmMatchState(new DpMatrixBanded(xSize,ySize,band,pageMode));
+			X = new PairwiseHmmInsertState(new DpMatrixBanded(xSize,ySize,band,pageMode));
+			Y = new PairwiseHmmDeleteState(new DpMatrixBanded(xSize,ySize,band,pageMode));
+			break;
+		}
+		//no band - nothing to compress
+		matrixType = Definitions::DpMatrixType::Full;
+		M = new PairwiseHmmMatchState(new DpMatrixFull(xSize,ySize,pageMode));
+		X = new PairwiseHmmInsertState(new DpMatrixFull(xSize,ySize,pageMode));
+		Y = new PairwiseHmmDeleteState(new DpMatrixFull(xSize,ySize,pageMode));
+		break;
+	case Definitions::DpMatrixType::Rolling :
+		if (band != NULL)
+		{
+			M = new PairwiseHmmMatchState(new DpMatrixRolling(xSize,ySize,band));
+			X = new PairwiseHmmInsertState(new DpMatrixRolling(xSize,ySize,band));
+			Y = new PairwiseHmmDeleteState(new DpMatrixRolling(xSize,ySize,band));
+			break;
+		}
+		//unbanded recursion goes row by row - two rows suffice
+		matrixType = Definitions::DpMatrixType::Limited;
+		M = new PairwiseHmmMatchState(new DpMatrixLoMem(xSize,ySize));
+		X = new PairwiseHmmInsertState(new DpMatrixLoMem(xSize,ySize));
+		Y = new PairwiseHmmDeleteState(new DpMatrixLoMem(xSize,ySize));
+		break;
 	default :
-		M = new PairwiseHmmMatchState(xSize,ySize);
-		X = new PairwiseHmmInsertState(xSize,ySize);
-		Y = new PairwiseHmmDeleteState(xSize,ySize);
+		matrixType = Definitions::DpMatrixType::Full;
+		M = new PairwiseHmmMatchState(new DpMatrixFull(xSize,ySize,pageMode));
+		X = new PairwiseHmmInsertState(new DpMatrixFull(xSize,ySize,pageMode));
+		Y = new PairwiseHmmDeleteState(new DpMatrixFull(xSize,ySize,pageMode));
 	}
 }
 
@@ -218,6 +311,7 @@ EvolutionaryPairHMM::~EvolutionaryPairHMM()
 	delete M;
     delete ptmatrix;
     delete tpb;
+    delete ownWorkspace;
 }
 
 
@@ -231,6 +325,91 @@ double EvolutionaryPairHMM::getAlignmentLikelihood(vector<unsigned char>* s1,
 
 }
 
+void EvolutionaryPairHMM::getColumnRanges(vector<int>* colLo, vector<int>* colHi)
+{
+	const int n1 = xSize-1;
+	const int n2 = ySize-1;
+	int j;
+
+	for(unsigned int s = 0; s < Definitions::stateCount; s++)
+	{
+		colLo[s].assign(ySize, 1);
+		colHi[s].assign(ySize, 0);
+	}
+
+	if(this->band == NULL)
+	{
+		colLo[Definitions::Insert][0] = 1;
+		colHi[Definitions::Insert][0] = n1;
+		for(j = 1; j <= n2; j++)
+		{
+			colLo[Definitions::Match][j] = 1;
+			colHi[Definitions::Match][j] = n1;
+			colLo[Definitions::Insert][j] = 1;
+			colHi[Definitions::Insert][j] = n1;
+			colLo[Definitions::Delete][j] = 0;
+			colHi[Definitions::Delete][j] = n1;
+		}
+	}
+	else
+	{
+		auto setRange = [&](Definitions::StateId st, int col, std::pair<int, int> bracket)
+		{
+			colLo[st][col] = bracket.first;
+			colHi[st][col] = bracket.second > n1 ? n1 : bracket.second;
+		};
+
+		auto bracket = band->getInsertRangeAt(0);
+		if (bracket.first > 0)
+			setRange(Definitions::Insert, 0, bracket);
+
+		for(j = 1; j <= n2; j++)
+		{
+			bracket = band->getDeleteRangeAt(j);
+			if (bracket.first > -1)
+				setRange(Definitions::Delete, j, bracket);
+			bracket = band->getMatchRangeAt(j);
+			if (bracket.first > 0)
+				setRange(Definitions::Match, j, bracket);
+			bracket = band->getInsertRangeAt(j);
+			if (bracket.first > 0)
+				setRange(Definitions::Insert, j, bracket);
+		}
+	}
+}
+
+bool EvolutionaryPairHMM::splitIntoTiles()
+{
+	return WavefrontScheduler::getSpareThreads() > 0 && getDpCells() >= Definitions::wavefrontMinCells;
+}
+
+double EvolutionaryPairHMM::getDpCells()
+{
+	if (this->band == NULL)
+		return (double) xSize * ySize;
+
+	vector<int> colLo[Definitions::stateCount];
+	vector<int> colHi[Definitions::stateCount];
+	getColumnRanges(colLo, colHi);
+
+	double cells = 0;
+	for(unsigned int j = 0; j < ySize; j++)
+	{
+		int lo = xSize;
+		int hi = -1;
+		for(unsigned int s = 0; s < Definitions::stateCount; s++)
+		{
+			if (colLo[s][j] > colHi[s][j])
+				continue;
+			lo = std::min(lo, colLo[s][j]);
+			hi = std::max(hi, colHi[s][j]);
+		}
+		if (lo <= hi)
+			cells += hi - lo + 1;
+	}
+	return cells;
+}
+
 } /* namespace EBC */
 
 
@@ -23,6 +23,7 @@
 
 
 #include "core/Maths.hpp"
+#include "core/LogSumExp.hpp"
 #include "core/Dictionary.hpp"
 #include "core/PMatrixDouble.hpp"
 #include "core/TransitionProbabilities.hpp"
@@ -35,6 +36,10 @@
 #include "hmm/PairwiseHmmDeleteState.hpp"
 #include "hmm/PairwiseHmmMatchState.hpp"
 #include "hmm/DpMatrixLoMem.hpp"
+#include "hmm/DpMatrixBanded.hpp"
+#include "hmm/DpMatrixRolling.hpp"
+#include "hmm/EmissionPolicy.hpp"
+#include "hmm/DpWorkspace.hpp"
 
 #include "models/GTRModel.hpp"
 #include "models/HKY85Model.hpp"
@@ -82,6 +87,30 @@ protected:
 
 	vector<SequenceElement*>* seq1;
 	vector<SequenceElement*>* seq2;
+
+	//concrete type of the M/X/Y dp matrices, used to pick a kernel instantiation
+	Definitions::DpMatrixType matrixType;
+
+	//floating point type of the dp matrices and the linear space kernels
+	Definitions::DpPrecision precision;
+
+	//backing memory of the full and banded dp matrices
+	Definitions::DpPageMode pageMode;
+
+	//true if any of the sequences contains FASTA ambiguity classes
+	bool ambiguousSequences;
+
+	//kernel scratch memory, shared with the other HMMs of a worker thread
+	DpWorkspace* workspace;
+	//created on first use when no workspace was handed in
+	DpWorkspace* ownWorkspace;
+
+	inline DpWorkspace& getWorkspace()
+	{
+		if (workspace == nullptr)
+			workspace = ownWorkspace = new DpWorkspace();
+		return *workspace;
+	}
 	//vector<SequenceElement>::iterator itS1, itS2;
 	
 	//cumulative likelihood for all 3 matrices
@@ -108,9 +137,32 @@ protected:
 
 	void getStateEquilibriums();
 
+	//per column in-band rows of M/X/Y (indexed by StateId), empty ranges have lo > hi
+	void getColumnRanges(vector<int>* colLo, vector<int>* colHi);
+
+	//true if the pair is long enough to split its dp into tiles and spare threads could help right now
+	bool splitIntoTiles();
+
 
 public:
 
+	//precision picked by newly created HMMs
+	static Definitions::DpPrecision defaultPrecision;
+
+	//dp matrix page mode picked by newly created HMMs
+	static Definitions::DpPageMode defaultPageMode;
+
+	//how forward-backward calculations run their two passes
+	static Definitions::PosteriorMode defaultPosteriorMode;
+
+	//decimal state equilibriums of the transition matrix md built from gap opening g and extension e
+	static void calculateStateEquilibriums(double g, double e, double md[][Definitions::stateCount],
+			double& pM, double& pI, double& pD);
+
+	//log transition probabilities trans[to][from] indexed by StateId, xi is the end transition
+	static void calculateTransitionProbabilities(double g, double e, double xi,
+			double trans[][Definitions::stateCount]);
+
 	//Match state
 	PairwiseHmmStateBase* M;
 	//Insert state
@@ -126,6 +178,20 @@ public:
 		this->band = bnd;
 	}
 
+	inline Band* getBand()
+	{
+		return this->band;
+	}
+
+	//dp cells of the pair, only the band ones if banded
+	double getDpCells();
+
+	//scratch memory of a worker thread, outlives this HMM
+	inline void setWorkspace(DpWorkspace* ws)
+	{
+		this->workspace = ws;
+	}
+
 	virtual ~EvolutionaryPairHMM();
 
 	virtual double runAlgorithm()=0;
@@ -172,6 +238,23 @@ public:
 		return totalLikelihood;
 	}
 
+	Definitions::DpMatrixType getMatrixType() const {
+		return matrixType;
+	}
+
+	Definitions::DpPrecision getPrecision() const {
+		return precision;
+	}
+
+	//kernel precision only - full matrices keep the type they were created with
+	void setPrecision(Definitions::DpPrecision prec) {
+		this->precision = prec;
+	}
+
+	Definitions::DpPageMode getPageMode() const {
+		return pageMode;
+	}
+
 	void setTotalLikelihood(double totalLikelihood) {
 		this->totalLikelihood = totalLikelihood;
 	}
@@ -19,7 +19,13 @@
 
 
 #include "core/Definitions.hpp"
+#include "core/VectorMaths.hpp"
+#include "core/WavefrontScheduler.hpp"
 #include "hmm/ForwardPairHMM.hpp"
+#include "hmm/DpMatrixFull.hpp"
+#include "hmm/DpMatrixFloat.hpp"
+
+#include <limits>
 
 namespace EBC
 {
@@ -27,15 +33,145 @@ namespace EBC
 
 ForwardPairHMM::ForwardPairHMM(vector<SequenceElement*>* s1, vector<SequenceElement*>* s2, SubstitutionModelBase* smdl,
 		IndelModel* imdl, Definitions::DpMatrixType mt, Band* bandObj, bool useEquilibriumFreqs) :
-		EvolutionaryPairHMM(s1,s2, smdl, imdl, mt, bandObj, true)
+		EvolutionaryPairHMM(s1,s2, smdl, imdl, mt, bandObj, true), kernel(defaultKernel)
 {
+	if (defaultAmbiguousRunMode == Definitions::AmbiguousRunMode::Transfer && ambiguousSequences)
+	{
+		//a run of seq1 takes rows, paths stay on its symbols in delete; a run of seq2 takes columns
+		findAmbiguousRuns(s1, Definitions::Delete, rowRuns);
+		findAmbiguousRuns(s2, Definitions::Insert, columnRuns);
+	}
 }
 
+Definitions::ForwardKernelType ForwardPairHMM::defaultKernel = Definitions::ForwardKernelType::Wavefront;
+
+Definitions::AmbiguousRunMode ForwardPairHMM::defaultAmbiguousRunMode = Definitions::AmbiguousRunMode::Transfer;
+
 ForwardPairHMM::~ForwardPairHMM()
 {
 }
 
 double ForwardPairHMM::runAlgorithm()
+{
+	//single precision only pays off in linear space
+	if (precision == Definitions::DpPrecision::Single)
+		return runScaled();
+	if (splitIntoTiles())
+		return runTiled();
+	//the transfer across ambiguous runs leaves their cells empty, fine where only the likelihood is kept
+	if ((!rowRuns.empty() || !columnRuns.empty()) && (matrixType == Definitions::DpMatrixType::Rolling ||
+			matrixType == Definitions::DpMatrixType::Limited))
+		return runScaled();
+	if (kernel == Definitions::ForwardKernelType::Wavefront)
+		return runWavefront();
+#if defined(__AVX__)
+	if (kernel == Definitions::ForwardKernelType::Interleaved)
+		return runInterleaved();
+#endif
+	if (kernel == Definitions::ForwardKernelType::Scaled)
+		return runScaled();
+	return runScalar();
+}
+
+double ForwardPairHMM::runScalar()
+{
+	if (matrixType == Definitions::DpMatrixType::Limited)
+		return ambiguousSequences ? runScalarKernel<DpMatrixLoMem, true>() : runScalarKernel<DpMatrixLoMem, false>();
+	if (matrixType == Definitions::DpMatrixType::Banded)
+		return ambiguousSequences ? runScalarKernel<DpMatrixBanded, true>() : runScalarKernel<DpMatrixBanded, false>();
+	if (matrixType == Definitions::DpMatrixType::Rolling)
+		return ambiguousSequences ? runScalarKernel<DpMatrixRolling, true>() : runScalarKernel<DpMatrixRolling, false>();
+	if (matrixType == Definitions::DpMatrixType::FullFloat)
+		return ambiguousSequences ? runScalarKernel<DpMatrixFloat, true>() : runScalarKernel<DpMatrixFloat, false>();
+	return ambiguousSequences ? runScalarKernel<DpMatrixFull, true>() : runScalarKernel<DpMatrixFull, false>();
+}
+
+void ForwardPairHMM::getEmissionProfiles(vector<double>& emisX, vector<double>& emisY, vector<double>& emisM,
+		vector<unsigned int>& symX, vector<unsigned int>& symY,
+		vector<double>* emisMDt, vector<double>* emisMDt2)
+{
+	getEmissionProfiles(seq1, seq2, ptmatrix, emisX, emisY, emisM, symX, symY, emisMDt, emisMDt2);
+}
+
+void ForwardPairHMM::getEmissionProfiles(vector<SequenceElement*>* seq1, vector<SequenceElement*>* seq2, PMatrixDouble* ptmatrix,
+		vector<double>& emisX, vector<double>& emisY, vector<double>& emisM,
+		vector<unsigned int>& symX, vector<unsigned int>& symY,
+		vector<double>* emisMDt, vector<double>* emisMDt2)
+{
+	const unsigned int xSize = seq1->size()+1;
+	const unsigned int ySize = seq2->size()+1;
+	unsigned int i,j;
+
+	vector<SequenceElement*> symbols;
+	for(auto el : *seq1)
+		if (el->getMatrixIndex() >= symbols.size())
+			symbols.resize(el->getMatrixIndex()+1, nullptr);
+	for(auto el : *seq2)
+		if (el->getMatrixIndex() >= symbols.size())
+			symbols.resize(el->getMatrixIndex()+1, nullptr);
+
+	const unsigned int symbolCount = symbols.size();
+	vector<bool> inSeq1(symbolCount, false);
+	vector<bool> inSeq2(symbolCount, false);
+
+	for(auto el : *seq1)
+	{
+		symbols[el->getMatrixIndex()] = el;
+		inSeq1[el->getMatrixIndex()] = true;
+	}
+	for(auto el : *seq2)
+	{
+		symbols[el->getMatrixIndex()] = el;
+		inSeq2[el->getMatrixIndex()] = true;
+	}
+
+	//one class sum per symbol, not per position - runs of N or X repeat the same entry
+	vector<double> logFreq(symbolCount, 0.0);
+	for(unsigned int a = 0; a < symbolCount; a++)
+		if (inSeq1[a] || inSeq2[a])
+			logFreq[a] = ptmatrix->getLogEquilibriumFreqClass(symbols[a]);
+
+	emisX.assign(xSize, 0.0);
+	symX.assign(xSize, 0);
+	for(i = 1; i < xSize; i++)
+	{
+		SequenceElement* el = (*seq1)[i-1];
+		emisX[i] = logFreq[el->getMatrixIndex()];
+		symX[i] = el->getMatrixIndex() * symbolCount;
+	}
+
+	emisY.assign(ySize, 0.0);
+	symY.assign(ySize, 0);
+	for(j = 1; j < ySize; j++)
+	{
+		SequenceElement* el = (*seq2)[j-1];
+		emisY[j] = logFreq[el->getMatrixIndex()];
+		symY[j] = el->getMatrixIndex();
+	}
+
+	emisM.assign(symbolCount*symbolCount, 0.0);
+	for(unsigned int a = 0; a < symbolCount; a++)
+		for(unsigned int b = 0; b < symbolCount; b++)
+			if (inSeq1[a] && inSeq2[b])
+				emisM[a*symbolCount+b] = ptmatrix->getLogPairTransitionClass(symbols[a], symbols[b]);
+
+	if (emisMDt == nullptr || emisMDt2 == nullptr)
+		return;
+
+	ptmatrix->calculateDerivatives();
+	emisMDt->assign(symbolCount*symbolCount, 0.0);
+	emisMDt2->assign(symbolCount*symbolCount, 0.0);
+	for(unsigned int a = 0; a < symbolCount; a++)
+		for(unsigned int b = 0; b < symbolCount; b++)
+			if (inSeq1[a] && inSeq2[b])
+			{
+				(*emisMDt)[a*symbolCount+b] = ptmatrix->getPairTransitionDerivativeClass(symbols[a], symbols[b], 1);
+				(*emisMDt2)[a*symbolCount+b] = ptmatrix->getPairTransitionDerivativeClass(symbols[a], symbols[b], 2);
+			}
+}
+
+template<class MatrixType, bool Ambiguous>
+double ForwardPairHMM::runScalarKernel()
 {
 
 	int i;
@@ -51,6 +187,8 @@ double ForwardPairHMM::runAlgorithm()
 	double emissionX;
 	double emissionY;
 
+	typedef EmissionPolicy<Ambiguous> Emission;
+
 	//TODO - multiple runs using the same hmm object do not require dp matrix zeroing as long as the band stays the same!
 
 	//DUMP("Forward equilibriums : PiM\t" << piM << "\tPiI\t" << piI << "\tPiD\t" << piD);
@@ -63,53 +201,54 @@ double ForwardPairHMM::runAlgorithm()
 	{
 		//handle 0-index rows and columns separately!
 		//1st col
-		X->setValueAt(1,0, ptmatrix->getLogEquilibriumFreqClass((*seq1)[0]) + initTransX);
+		X->setValueAt<MatrixType>(1,0, Emission::single(ptmatrix, (*seq1)[0]) + initTransX);
 
 		for(i=2,j=0; i< xSize; i++)
 		{
 			k = i-1;
-			emissionX = ptmatrix->getLogEquilibriumFreqClass((*seq1)[i-1]);
-			xx = X->getValueAt(k,j) + X->getTransitionProbabilityFromInsert();
-			X->setValueAt(i,j, emissionX + xx);
+			emissionX = Emission::single(ptmatrix, (*seq1)[i-1]);
+			xx = X->getValueAt<MatrixType>(k,j) + X->getTransitionProbabilityFromInsert();
+			X->setValueAt<MatrixType>(i,j, emissionX + xx);
 		}
 		//1st row
 
-		Y->setValueAt(0,1, ptmatrix->getLogEquilibriumFreqClass((*seq2)[0]) + initTransY);
+		Y->setValueAt<MatrixType>(0,1, Emission::single(ptmatrix, (*seq2)[0]) + initTransY);
 		for(j=2,i=0; j< ySize; j++)
 		{
 			k = j-1;
-			emissionY = ptmatrix->getLogEquilibriumFreqClass((*seq2)[j-1]);
-			yy = Y->getValueAt(i,k) + Y->getTransitionProbabilityFromDelete();
-			Y->setValueAt(i,j, emissionY + yy);
+			emissionY = Emission::single(ptmatrix, (*seq2)[j-1]);
+			yy = Y->getValueAt<MatrixType>(i,k) + Y->getTransitionProbabilityFromDelete();
+			Y->setValueAt<MatrixType>(i,j, emissionY + yy);
 		}
 
 
-		for (i = 1; i<xSize; i++)
+		//column by column, the full matrices are column-major
+		for (j = 1; j<ySize; j++)
 		{
-			for (j = 1; j<ySize; j++)
+			for (i = 1; i<xSize; i++)
 			{
 
 				k = i-1;
-				emissionX = ptmatrix->getLogEquilibriumFreqClass((*seq1)[i-1]);
-				xm = M->getValueAt(k,j) + X->getTransitionProbabilityFromMatch();
-				xx = X->getValueAt(k,j) + X->getTransitionProbabilityFromInsert();
-				xy = Y->getValueAt(k,j) + X->getTransitionProbabilityFromDelete();
-				X->setValueAt(i,j, emissionX + maths->logSum(xm,xx,xy));
+				emissionX = Emission::single(ptmatrix, (*seq1)[i-1]);
+				xm = M->getValueAt<MatrixType>(k,j) + X->getTransitionProbabilityFromMatch();
+				xx = X->getValueAt<MatrixType>(k,j) + X->getTransitionProbabilityFromInsert();
+				xy = Y->getValueAt<MatrixType>(k,j) + X->getTransitionProbabilityFromDelete();
+				X->setValueAt<MatrixType>(i,j, emissionX + LogSumExp::logSum(xm,xx,xy));
 
 				k = j-1;
-				emissionY = ptmatrix->getLogEquilibriumFreqClass((*seq2)[j-1]);
-				ym = M->getValueAt(i,k) + Y->getTransitionProbabilityFromMatch();
-				yx = X->getValueAt(i,k) + Y->getTransitionProbabilityFromInsert();
-				yy = Y->getValueAt(i,k) + Y->getTransitionProbabilityFromDelete();
-				Y->setValueAt(i,j, emissionY + maths->logSum(ym,yx,yy));
+				emissionY = Emission::single(ptmatrix, (*seq2)[j-1]);
+				ym = M->getValueAt<MatrixType>(i,k) + Y->getTransitionProbabilityFromMatch();
+				yx = X->getValueAt<MatrixType>(i,k) + Y->getTransitionProbabilityFromInsert();
+				yy = Y->getValueAt<MatrixType>(i,k) + Y->getTransitionProbabilityFromDelete();
+				Y->setValueAt<MatrixType>(i,j, emissionY + LogSumExp::logSum(ym,yx,yy));
 
 				k = i-1;
 				l = j-1;
-				emissionM = ptmatrix->getLogPairTransitionClass((*seq1)[i-1], (*seq2)[j-1]);
-				mm = M->getValueAt(k,l) + M->getTransitionProbabilityFromMatch();
-				mx = X->getValueAt(k,l) + M->getTransitionProbabilityFromInsert();
-				my = Y->getValueAt(k,l) + M->getTransitionProbabilityFromDelete();
-				M->setValueAt(i,j, emissionM + maths->logSum(mm,mx,my));
+				emissionM = Emission::pair(ptmatrix, (*seq1)[i-1], (*seq2)[j-1]);
+				mm = M->getValueAt<MatrixType>(k,l) + M->getTransitionProbabilityFromMatch();
+				mx = X->getValueAt<MatrixType>(k,l) + M->getTransitionProbabilityFromInsert();
+				my = Y->getValueAt<MatrixType>(k,l) + M->getTransitionProbabilityFromDelete();
+				M->setValueAt<MatrixType>(i,j, emissionM + LogSumExp::logSum(mm,mx,my));
 			}
 		}
 	}
@@ -126,11 +265,11 @@ double ForwardPairHMM::runAlgorithm()
 			for(i=loI,j=0; i<= hiI; i++)
 			{
 				k = i-1;
-				emissionX = ptmatrix->getLogEquilibriumFreqClass((*seq1)[i-1]);
-				xm = M->getValueAt(k,j) + X->getTransitionProbabilityFromMatch();
-				xx = X->getValueAt(k,j) + X->getTransitionProbabilityFromInsert();
-				xy = Y->getValueAt(k,j) + X->getTransitionProbabilityFromDelete();
-				X->setValueAt(i,j, emissionX + maths->logSum(xm,xx,xy));
+				emissionX = Emission::single(ptmatrix, (*seq1)[i-1]);
+				xm = M->getValueAt<MatrixType>(k,j) + X->getTransitionProbabilityFromMatch();
+				xx = X->getValueAt<MatrixType>(k,j) + X->getTransitionProbabilityFromInsert();
+				xy = Y->getValueAt<MatrixType>(k,j) + X->getTransitionProbabilityFromDelete();
+				X->setValueAt<MatrixType>(i,j, emissionX + LogSumExp::logSum(xm,xx,xy));
 			}
 		}
 		for(j=1; j<ySize; j++)
@@ -149,11 +288,11 @@ double ForwardPairHMM::runAlgorithm()
 				for(i = loD; i <= hiD; i++)
 				{
 					k = j-1;
-					emissionY = ptmatrix->getLogEquilibriumFreqClass((*seq2)[j-1]);
-					ym = M->getValueAt(i,k) + Y->getTransitionProbabilityFromMatch();
-					yx = X->getValueAt(i,k) + Y->getTransitionProbabilityFromInsert();
-					yy = Y->getValueAt(i,k) + Y->getTransitionProbabilityFromDelete();
-					Y->setValueAt(i,j, emissionY + maths->logSum(ym,yx,yy));
+					emissionY = Emission::single(ptmatrix, (*seq2)[j-1]);
+					ym = M->getValueAt<MatrixType>(i,k) + Y->getTransitionProbabilityFromMatch();
+					yx = X->getValueAt<MatrixType>(i,k) + Y->getTransitionProbabilityFromInsert();
+					yy = Y->getValueAt<MatrixType>(i,k) + Y->getTransitionProbabilityFromDelete();
+					Y->setValueAt<MatrixType>(i,j, emissionY + LogSumExp::logSum(ym,yx,yy));
 				}
 			}
 			if (loM > 0)
@@ -163,11 +302,11 @@ double ForwardPairHMM::runAlgorithm()
 				{
 					k = i-1;
 					l = j-1;
-					emissionM = ptmatrix->getLogPairTransitionClass((*seq1)[i-1], (*seq2)[j-1]);
-					mm = M->getValueAt(k,l) + M->getTransitionProbabilityFromMatch();
-					mx = X->getValueAt(k,l) + M->getTransitionProbabilityFromInsert();
-					my = Y->getValueAt(k,l) + M->getTransitionProbabilityFromDelete();
-					M->setValueAt(i,j, emissionM + maths->logSum(mm,mx,my));
+					emissionM = Emission::pair(ptmatrix, (*seq1)[i-1], (*seq2)[j-1]);
+					mm = M->getValueAt<MatrixType>(k,l) + M->getTransitionProbabilityFromMatch();
+					mx = X->getValueAt<MatrixType>(k,l) + M->getTransitionProbabilityFromInsert();
+					my = Y->getValueAt<MatrixType>(k,l) + M->getTransitionProbabilityFromDelete();
+					M->setValueAt<MatrixType>(i,j, emissionM + LogSumExp::logSum(mm,mx,my));
 				}
 			}
 
@@ -177,21 +316,21 @@ double ForwardPairHMM::runAlgorithm()
 				for(i = loI; i <= hiI; i++)
 				{
 					k = i-1;
-					emissionX = ptmatrix->getLogEquilibriumFreqClass((*seq1)[i-1]);
-					xm = M->getValueAt(k,j) + X->getTransitionProbabilityFromMatch();
-					xx = X->getValueAt(k,j) + X->getTransitionProbabilityFromInsert();
-					xy = Y->getValueAt(k,j) + X->getTransitionProbabilityFromDelete();
-					X->setValueAt(i,j, emissionX + maths->logSum(xm,xx,xy));
+					emissionX = Emission::single(ptmatrix, (*seq1)[i-1]);
+					xm = M->getValueAt<MatrixType>(k,j) + X->getTransitionProbabilityFromMatch();
+					xx = X->getValueAt<MatrixType>(k,j) + X->getTransitionProbabilityFromInsert();
+					xy = Y->getValueAt<MatrixType>(k,j) + X->getTransitionProbabilityFromDelete();
+					X->setValueAt<MatrixType>(i,j, emissionX + LogSumExp::logSum(xm,xx,xy));
 				}
 			}
 		}
 	}
 
-	sM = M->getValueAt(xSize-1, ySize-1);
-	sX = X->getValueAt(xSize-1, ySize-1);
-	sY = Y->getValueAt(xSize-1, ySize-1);
+	sM = M->getValueAt<MatrixType>(xSize-1, ySize-1);
+	sX = X->getValueAt<MatrixType>(xSize-1, ySize-1);
+	sY = Y->getValueAt<MatrixType>(xSize-1, ySize-1);
 
-	sS = maths->logSum(sM,sX,sY) + log(xi);
+	sS = LogSumExp::logSum(sM,sX,sY) + log(xi);
 
 	this->setTotalLikelihood(sS);
 
@@ -204,4 +343,1528 @@ double ForwardPairHMM::runAlgorithm()
 
 
 
+double ForwardPairHMM::runWavefront()
+{
+	using VectorMaths::vdouble;
+	using VectorMaths::vlong;
+	using VectorMaths::broadcast;
+	using VectorMaths::load;
+	using VectorMaths::store;
+
+	const int W = VectorMaths::lanes;
+	const int n1 = xSize-1;
+	const int n2 = ySize-1;
+	const double minVal = Definitions::minMatrixLikelihood;
+
+	int i,j,k,d,s;
+	int lo, hi;
+
+	double sX,sY,sM, sS;
+
+	M->initializeData(this->piM);
+	X->initializeData(this->piI);
+	Y->initializeData(this->piD);
+
+	DpWorkspace& ws = getWorkspace();
+
+	//in-band rows of every column for M/X/Y (indexed by StateId)
+	vector<int>* colLo = &ws.getBuffer<int>(DpWorkspace::ColumnLo);
+	vector<int>* colHi = &ws.getBuffer<int>(DpWorkspace::ColumnHi);
+	getColumnRanges(colLo, colHi);
+
+	//row span of every anti-diagonal d = i + j covering all in-band cells
+	vector<int>& diagLo = ws.getBuffer<int>(DpWorkspace::DiagonalLo);
+	vector<int>& diagHi = ws.getBuffer<int>(DpWorkspace::DiagonalHi);
+	diagLo.assign(n1+n2+1, n1+1);
+	diagHi.assign(n1+n2+1, -1);
+
+	for(j = 0; j <= n2; j++)
+	{
+		lo = n1+1;
+		hi = -1;
+		for(s = 0; s < Definitions::stateCount; s++)
+		{
+			if (colLo[s][j] > colHi[s][j])
+				continue;
+			lo = std::min(lo, colLo[s][j]);
+			hi = std::max(hi, colHi[s][j]);
+		}
+		for(i = lo; i <= hi; i++)
+		{
+			d = i+j;
+			diagLo[d] = std::min(diagLo[d], i);
+			diagHi[d] = std::max(diagHi[d], i);
+		}
+	}
+
+	//Column-indexed data is stored reversed (r = n2 - j + W) so that consecutive
+	//rows on a diagonal read consecutive entries. Padding holds empty ranges.
+	const int revSize = n2 + 2*W;
+	vector<double>* revLo = &ws.getBuffer<double>(DpWorkspace::ReversedLo);
+	vector<double>* revHi = &ws.getBuffer<double>(DpWorkspace::ReversedHi);
+
+	for(s = 0; s < Definitions::stateCount; s++)
+	{
+		revLo[s].assign(revSize, 1.0);
+		revHi[s].assign(revSize, 0.0);
+		for(j = 0; j <= n2; j++)
+		{
+			revLo[s][n2-j+W] = colLo[s][j];
+			revHi[s][n2-j+W] = colHi[s][j];
+		}
+	}
+
+	//emission profiles, column-indexed ones reversed like the ranges
+	vector<double>& profX = ws.getBuffer<double>(DpWorkspace::EmissionX);
+	vector<double>& profY = ws.getBuffer<double>(DpWorkspace::EmissionY);
+	vector<double>& emisM = ws.getBuffer<double>(DpWorkspace::EmissionM);
+	vector<unsigned int>& profSymX = ws.getBuffer<unsigned int>(DpWorkspace::SymbolsX);
+	vector<unsigned int>& profSymY = ws.getBuffer<unsigned int>(DpWorkspace::SymbolsY);
+	getEmissionProfiles(profX, profY, emisM, profSymX, profSymY);
+
+	vector<double>& emisX = ws.getBuffer<double>(DpWorkspace::PaddedX);
+	vector<unsigned int>& symX = ws.getBuffer<unsigned int>(DpWorkspace::PaddedSymbolsX);
+	emisX.assign(xSize+W, 0.0);
+	symX.assign(xSize+W, 0);
+	std::copy(profX.begin(), profX.end(), emisX.begin());
+	std::copy(profSymX.begin(), profSymX.end(), symX.begin());
+
+	vector<double>& emisY = ws.getBuffer<double>(DpWorkspace::PaddedY);
+	vector<unsigned int>& symY = ws.getBuffer<unsigned int>(DpWorkspace::PaddedSymbolsY);
+	emisY.assign(revSize, 0.0);
+	symY.assign(revSize, 0);
+	for(j = 0; j <= n2; j++)
+	{
+		emisY[n2-j+W] = profY[j];
+		symY[n2-j+W] = profSymY[j];
+	}
+
+	//three rolling diagonals per state, indexed by row with W cells of padding on each side
+	const int stride = xSize + 2*W;
+	double* diagBuffer = ws.getColumns<double>(Definitions::stateCount * 3 * stride, minVal);
+	int slotLo[3] = {0, 0, 0};
+	int slotHi[3] = {-1, -1, -1};
+
+	auto diagonal = [&](int st, int diag) -> double*
+	{
+		return diagBuffer + (st*3 + (diag+3)%3)*stride + W;
+	};
+
+	diagonal(Definitions::Match, 0)[0] = this->piM;
+	diagonal(Definitions::Insert, 0)[0] = this->piI;
+	diagonal(Definitions::Delete, 0)[0] = this->piD;
+	slotHi[0] = 0;
+
+	//the forward matrices are kept up to date for posterior calculations
+	PairwiseHmmStateBase* states[Definitions::stateCount];
+	bool writeBack = matrixType == Definitions::DpMatrixType::Full || matrixType == Definitions::DpMatrixType::Banded ||
+			matrixType == Definitions::DpMatrixType::FullFloat;
+	states[Definitions::Match] = M;
+	states[Definitions::Insert] = X;
+	states[Definitions::Delete] = Y;
+
+	auto storeCell = [&](unsigned int st, unsigned int row, unsigned int col, double val)
+	{
+		if (matrixType == Definitions::DpMatrixType::Banded)
+			states[st]->setValueAt<DpMatrixBanded>(row,col,val);
+		else if (matrixType == Definitions::DpMatrixType::FullFloat)
+			states[st]->setValueAt<DpMatrixFloat>(row,col,val);
+		else
+			states[st]->setValueAt<DpMatrixFull>(row,col,val);
+	};
+
+	const vdouble xm = broadcast(X->getTransitionProbabilityFromMatch());
+	const vdouble xx = broadcast(X->getTransitionProbabilityFromInsert());
+	const vdouble xy = broadcast(X->getTransitionProbabilityFromDelete());
+	const vdouble ym = broadcast(Y->getTransitionProbabilityFromMatch());
+	const vdouble yx = broadcast(Y->getTransitionProbabilityFromInsert());
+	const vdouble yy = broadcast(Y->getTransitionProbabilityFromDelete());
+	const vdouble mm = broadcast(M->getTransitionProbabilityFromMatch());
+	const vdouble mx = broadcast(M->getTransitionProbabilityFromInsert());
+	const vdouble my = broadcast(M->getTransitionProbabilityFromDelete());
+	const vdouble minV = broadcast(minVal);
+
+	vdouble laneOffsets;
+	for(k = 0; k < W; k++)
+		laneOffsets[k] = k;
+
+	double emissionM[VectorMaths::lanes];
+
+	for(d = 1; d <= n1+n2; d++)
+	{
+		int cs = d%3;
+
+		double* curM = diagonal(Definitions::Match, d);
+		double* curX = diagonal(Definitions::Insert, d);
+		double* curY = diagonal(Definitions::Delete, d);
+		double* prevM = diagonal(Definitions::Match, d-1);
+		double* prevX = diagonal(Definitions::Insert, d-1);
+		double* prevY = diagonal(Definitions::Delete, d-1);
+		double* prev2M = diagonal(Definitions::Match, d-2);
+		double* prev2X = diagonal(Definitions::Insert, d-2);
+		double* prev2Y = diagonal(Definitions::Delete, d-2);
+
+		//drop whatever diagonal d-3 left in this slot
+		if (slotLo[cs] <= slotHi[cs])
+		{
+			std::fill(curM + slotLo[cs], curM + slotHi[cs] + 1, minVal);
+			std::fill(curX + slotLo[cs], curX + slotHi[cs] + 1, minVal);
+			std::fill(curY + slotLo[cs], curY + slotHi[cs] + 1, minVal);
+		}
+
+		lo = diagLo[d];
+		hi = diagHi[d];
+		slotLo[cs] = lo;
+		slotHi[cs] = lo-1;
+
+		for(i = lo; i <= hi; i += W)
+		{
+			vdouble rows = broadcast(i) + laneOffsets;
+			//reversed index of column j = d - i
+			int r = n2 - d + i + W;
+
+			vlong inM = (rows >= load(&revLo[Definitions::Match][r])) & (rows <= load(&revHi[Definitions::Match][r]));
+			vlong inX = (rows >= load(&revLo[Definitions::Insert][r])) & (rows <= load(&revHi[Definitions::Insert][r]));
+			vlong inY = (rows >= load(&revLo[Definitions::Delete][r])) & (rows <= load(&revHi[Definitions::Delete][r]));
+
+			vdouble valX = load(&emisX[i]) + LogSumExp::logSum(load(prevM+i-1) + xm, load(prevX+i-1) + xx, load(prevY+i-1) + xy);
+			vdouble valY = load(&emisY[r]) + LogSumExp::logSum(load(prevM+i) + ym, load(prevX+i) + yx, load(prevY+i) + yy);
+
+			for(k = 0; k < W; k++)
+				emissionM[k] = emisM[symX[i+k] + symY[r+k]];
+			vdouble valM = load(emissionM) + LogSumExp::logSum(load(prev2M+i-1) + mm, load(prev2X+i-1) + mx, load(prev2Y+i-1) + my);
+
+			store(curM+i, inM ? valM : minV);
+			store(curX+i, inX ? valX : minV);
+			store(curY+i, inY ? valY : minV);
+
+			slotHi[cs] = i+W-1;
+		}
+
+		if (writeBack)
+		{
+			for(i = lo; i <= hi; i++)
+			{
+				j = d-i;
+				if (colLo[Definitions::Match][j] <= i && i <= colHi[Definitions::Match][j])
+					storeCell(Definitions::Match, i, j, curM[i]);
+				if (colLo[Definitions::Insert][j] <= i && i <= colHi[Definitions::Insert][j])
+					storeCell(Definitions::Insert, i, j, curX[i]);
+				if (colLo[Definitions::Delete][j] <= i && i <= colHi[Definitions::Delete][j])
+					storeCell(Definitions::Delete, i, j, curY[i]);
+			}
+		}
+	}
+
+	sM = diagonal(Definitions::Match, n1+n2)[n1];
+	sX = diagonal(Definitions::Insert, n1+n2)[n1];
+	sY = diagonal(Definitions::Delete, n1+n2)[n1];
+
+	sS = LogSumExp::logSum(sM,sX,sY) + log(xi);
+
+	//hand the diagonals back clean
+	for(d = 0; d < 3; d++)
+		for(s = 0; s < Definitions::stateCount; s++)
+			if (slotLo[d] <= slotHi[d])
+				std::fill(diagonal(s, d) + slotLo[d], diagonal(s, d) + slotHi[d] + 1, minVal);
+	ws.releaseColumns<double>();
+
+	this->setTotalLikelihood(sS);
+
+	DUMP ("Forward wavefront lnls I, D, M, Total " << sX << "\t" << sY << "\t" << sM << "\t" << sS);
+
+	return sS* -1.0;
+}
+
+
+
+double ForwardPairHMM::runTiled()
+{
+	const int n1 = xSize-1;
+	const int n2 = ySize-1;
+	const int T = Definitions::wavefrontTileSize;
+	const int S = Definitions::stateCount;
+	const double minVal = Definitions::minMatrixLikelihood;
+
+	int j,s;
+	int lo, hi;
+
+	double sX,sY,sM, sS;
+
+	M->initializeData(this->piM);
+	X->initializeData(this->piI);
+	Y->initializeData(this->piD);
+
+	DpWorkspace& ws = getWorkspace();
+
+	vector<int>* colLo = &ws.getBuffer<int>(DpWorkspace::ColumnLo);
+	vector<int>* colHi = &ws.getBuffer<int>(DpWorkspace::ColumnHi);
+	getColumnRanges(colLo, colHi);
+
+	vector<double>& emisX = ws.getBuffer<double>(DpWorkspace::EmissionX);
+	vector<double>& emisY = ws.getBuffer<double>(DpWorkspace::EmissionY);
+	vector<double>& emisM = ws.getBuffer<double>(DpWorkspace::EmissionM);
+	vector<unsigned int>& symX = ws.getBuffer<unsigned int>(DpWorkspace::SymbolsX);
+	vector<unsigned int>& symY = ws.getBuffer<unsigned int>(DpWorkspace::SymbolsY);
+	getEmissionProfiles(emisX, emisY, emisM, symX, symY);
+
+	//the start cell belongs to column 0
+	WavefrontScheduler scheduler(xSize, ySize, T);
+	for(j = 0; j <= n2; j++)
+	{
+		lo = j == 0 ? 0 : n1+1;
+		hi = j == 0 ? 0 : -1;
+		for(s = 0; s < S; s++)
+		{
+			if (colLo[s][j] > colHi[s][j])
+				continue;
+			lo = std::min(lo, colLo[s][j]);
+			hi = std::max(hi, colHi[s][j]);
+		}
+		scheduler.addColumn(j, lo, hi);
+	}
+
+	//row i0-1 of every column and column j0-1 of every row as the tiles above and to the left
+	//left them, the bottom right cell of every tile for its lower right neighbour
+	const int tileCols = (ySize + T - 1) / T;
+	vector<double>* edgeRow = &ws.getBuffer<double>(DpWorkspace::TileRows);
+	vector<double>* edgeCol = &ws.getBuffer<double>(DpWorkspace::TileColumns);
+	vector<double>& corners = ws.getBuffer<double>(DpWorkspace::TileCorners);
+	for(s = 0; s < S; s++)
+	{
+		edgeRow[s].assign(ySize, minVal);
+		edgeCol[s].assign(xSize, minVal);
+	}
+	corners.assign(((xSize + T - 1) / T) * tileCols * S, minVal);
+
+	PairwiseHmmStateBase* states[Definitions::stateCount];
+	bool writeBack = matrixType == Definitions::DpMatrixType::Full || matrixType == Definitions::DpMatrixType::Banded ||
+			matrixType == Definitions::DpMatrixType::FullFloat;
+	states[Definitions::Match] = M;
+	states[Definitions::Insert] = X;
+	states[Definitions::Delete] = Y;
+
+	//tiles write disjoint cells
+	auto storeCell = [&](unsigned int st, unsigned int row, unsigned int col, double val)
+	{
+		if (matrixType == Definitions::DpMatrixType::Banded)
+			states[st]->setValueAt<DpMatrixBanded>(row,col,val);
+		else if (matrixType == Definitions::DpMatrixType::FullFloat)
+			states[st]->setValueAt<DpMatrixFloat>(row,col,val);
+		else
+			states[st]->setValueAt<DpMatrixFull>(row,col,val);
+	};
+
+	const double xm = X->getTransitionProbabilityFromMatch();
+	const double xx = X->getTransitionProbabilityFromInsert();
+	const double xy = X->getTransitionProbabilityFromDelete();
+	const double ym = Y->getTransitionProbabilityFromMatch();
+	const double yx = Y->getTransitionProbabilityFromInsert();
+	const double yy = Y->getTransitionProbabilityFromDelete();
+	const double mm = M->getTransitionProbabilityFromMatch();
+	const double mx = M->getTransitionProbabilityFromInsert();
+	const double my = M->getTransitionProbabilityFromDelete();
+	const double start[Definitions::stateCount] = {piM, piI, piD};
+
+	//two columns per state for every thread, entry 0 is row i0-1
+	const unsigned int workers = scheduler.getMaxParallelism();
+	vector<vector<double> > local(workers);
+
+	scheduler.run(workers-1, [&](unsigned int w, unsigned int r, unsigned int c)
+	{
+		const int i0 = r*T;
+		const int i1 = std::min(n1, i0+T-1);
+		const int j0 = c*T;
+		const int j1 = std::min(n2, j0+T-1);
+		const int h = i1-i0+2;
+		int jj, st, t, lo, hi;
+
+		local[w].resize(2*S*h);
+		double* cur[Definitions::stateCount];
+		double* prev[Definitions::stateCount];
+		for(st = 0; st < S; st++)
+		{
+			cur[st] = local[w].data() + st*h;
+			prev[st] = local[w].data() + (S+st)*h;
+			prev[st][0] = r > 0 && c > 0 ? corners[((r-1)*tileCols + c-1)*S + st] : minVal;
+			std::copy(edgeCol[st].begin() + i0, edgeCol[st].begin() + i1 + 1, prev[st] + 1);
+		}
+
+		for(jj = j0; jj <= j1; jj++)
+		{
+			//in-band rows of the state in this tile, as local indices
+			auto rows = [&](int st, int& tLo, int& tHi)
+			{
+				tLo = std::max(colLo[st][jj], i0) - i0 + 1;
+				tHi = std::min(colHi[st][jj], i1) - i0 + 1;
+			};
+
+			for(st = 0; st < S; st++)
+			{
+				cur[st][0] = edgeRow[st][jj];
+				std::fill(cur[st] + 1, cur[st] + h, minVal);
+			}
+
+			rows(Definitions::Delete, lo, hi);
+			for(t = lo; t <= hi; t++)
+				cur[Definitions::Delete][t] = emisY[jj] + LogSumExp::logSum(prev[Definitions::Match][t] + ym,
+						prev[Definitions::Insert][t] + yx, prev[Definitions::Delete][t] + yy);
+
+			rows(Definitions::Match, lo, hi);
+			for(t = lo; t <= hi; t++)
+				cur[Definitions::Match][t] = emisM[symX[i0+t-1] + symY[jj]] + LogSumExp::logSum(prev[Definitions::Match][t-1] + mm,
+						prev[Definitions::Insert][t-1] + mx, prev[Definitions::Delete][t-1] + my);
+
+			if (i0 == 0 && jj == 0)
+				for(st = 0; st < S; st++)
+					cur[st][1] = start[st];
+
+			rows(Definitions::Insert, lo, hi);
+			for(t = lo; t <= hi; t++)
+				cur[Definitions::Insert][t] = emisX[i0+t-1] + LogSumExp::logSum(cur[Definitions::Match][t-1] + xm,
+						cur[Definitions::Insert][t-1] + xx, cur[Definitions::Delete][t-1] + xy);
+
+			if (writeBack)
+				for(st = 0; st < S; st++)
+				{
+					rows(st, lo, hi);
+					for(t = lo; t <= hi; t++)
+						storeCell(st, i0+t-1, jj, cur[st][t]);
+				}
+
+			for(st = 0; st < S; st++)
+			{
+				edgeRow[st][jj] = cur[st][h-1];
+				std::swap(cur[st], prev[st]);
+			}
+		}
+
+		for(st = 0; st < S; st++)
+		{
+			corners[(r*tileCols + c)*S + st] = prev[st][h-1];
+			std::copy(prev[st] + 1, prev[st] + h, edgeCol[st].begin() + i0);
+		}
+	});
+
+	sM = edgeCol[Definitions::Match][n1];
+	sX = edgeCol[Definitions::Insert][n1];
+	sY = edgeCol[Definitions::Delete][n1];
+
+	sS = LogSumExp::logSum(sM,sX,sY) + log(xi);
+
+	this->setTotalLikelihood(sS);
+
+	DUMP ("Forward tiled lnls I, D, M, Total " << sX << "\t" << sY << "\t" << sM << "\t" << sS);
+
+	return sS* -1.0;
+}
+
+#if defined(__AVX__)
+double ForwardPairHMM::runInterleaved()
+{
+	using VectorMaths::vstate;
+	using VectorMaths::vstatel;
+	using VectorMaths::splat;
+	using VectorMaths::loadState;
+	using VectorMaths::storeState;
+
+	//M, X, Y and padding of one cell
+	const int C = 4;
+	const int n1 = xSize-1;
+	const int n2 = ySize-1;
+	const double minVal = Definitions::minMatrixLikelihood;
+
+	int i,j,s;
+	int lo, hi;
+
+	double sX,sY,sM, sS;
+
+	M->initializeData(this->piM);
+	X->initializeData(this->piI);
+	Y->initializeData(this->piD);
+
+	DpWorkspace& ws = getWorkspace();
+
+	vector<int>* colLo = &ws.getBuffer<int>(DpWorkspace::ColumnLo);
+	vector<int>* colHi = &ws.getBuffer<int>(DpWorkspace::ColumnHi);
+	getColumnRanges(colLo, colHi);
+
+	vector<double>& emisX = ws.getBuffer<double>(DpWorkspace::EmissionX);
+	vector<double>& emisY = ws.getBuffer<double>(DpWorkspace::EmissionY);
+	vector<double>& emisM = ws.getBuffer<double>(DpWorkspace::EmissionM);
+	vector<unsigned int>& symX = ws.getBuffer<unsigned int>(DpWorkspace::SymbolsX);
+	vector<unsigned int>& symY = ws.getBuffer<unsigned int>(DpWorkspace::SymbolsY);
+	getEmissionProfiles(emisX, emisY, emisM, symX, symY);
+
+	//two interleaved columns, cell of row i at C*(i+1) - the cell above row 0 stays empty
+	double* columns = ws.getColumns<double>(2 * C * (xSize+1), minVal);
+	double* cur = columns + C;
+	double* prev = columns + C*(xSize+2);
+	int curLo = 0, curHi = -1;
+	int prevLo = 0, prevHi = -1;
+
+	PairwiseHmmStateBase* states[Definitions::stateCount];
+	bool writeBack = matrixType == Definitions::DpMatrixType::Full || matrixType == Definitions::DpMatrixType::Banded ||
+			matrixType == Definitions::DpMatrixType::FullFloat;
+	states[Definitions::Match] = M;
+	states[Definitions::Insert] = X;
+	states[Definitions::Delete] = Y;
+
+	auto storeCell = [&](unsigned int st, unsigned int row, unsigned int col, double val)
+	{
+		if (matrixType == Definitions::DpMatrixType::Banded)
+			states[st]->setValueAt<DpMatrixBanded>(row,col,val);
+		else if (matrixType == Definitions::DpMatrixType::FullFloat)
+			states[st]->setValueAt<DpMatrixFloat>(row,col,val);
+		else
+			states[st]->setValueAt<DpMatrixFull>(row,col,val);
+	};
+
+	//transitions out of M, X and Y into the M, X, Y lanes
+	const vstate fromM = {M->getTransitionProbabilityFromMatch(), X->getTransitionProbabilityFromMatch(), Y->getTransitionProbabilityFromMatch(), 0.0};
+	const vstate fromX = {M->getTransitionProbabilityFromInsert(), X->getTransitionProbabilityFromInsert(), Y->getTransitionProbabilityFromInsert(), 0.0};
+	const vstate fromY = {M->getTransitionProbabilityFromDelete(), X->getTransitionProbabilityFromDelete(), Y->getTransitionProbabilityFromDelete(), 0.0};
+	const vstate minV = splat<vstate>(minVal);
+
+	//(0,0) start cell
+	const vstate start = {this->piM, this->piI, this->piD, minVal};
+	storeState(cur, start);
+	curLo = 0;
+	curHi = 0;
+
+	for(j = 0; j <= n2; j++)
+	{
+		if (j > 0)
+		{
+			std::swap(cur, prev);
+			std::swap(curLo, prevLo);
+			std::swap(curHi, prevHi);
+
+			//drop what column j-2 left behind
+			if (curLo <= curHi)
+				std::fill(cur + C*curLo, cur + C*(curHi+1), minVal);
+			curLo = 0;
+			curHi = -1;
+		}
+
+		lo = n1+1;
+		hi = -1;
+		for(s = 0; s < Definitions::stateCount; s++)
+		{
+			if (colLo[s][j] > colHi[s][j])
+				continue;
+			lo = std::min(lo, colLo[s][j]);
+			hi = std::max(hi, colHi[s][j]);
+		}
+		//the start cell is not recomputed
+		if (j == 0)
+			lo = std::max(lo, 1);
+		if (lo > hi)
+			continue;
+		curLo = j == 0 ? 0 : lo;
+		curHi = hi;
+
+		//the padding lane is never in band
+		const vstate bandLo = {static_cast<double>(colLo[Definitions::Match][j]), static_cast<double>(colLo[Definitions::Insert][j]),
+				static_cast<double>(colLo[Definitions::Delete][j]), 1.0};
+		const vstate bandHi = {static_cast<double>(colHi[Definitions::Match][j]), static_cast<double>(colHi[Definitions::Insert][j]),
+				static_cast<double>(colHi[Definitions::Delete][j]), 0.0};
+
+		const double emissionY = emisY[j];
+		const double* emissionM = emisM.data() + symY[j];
+
+		//the cell above, carried in registers down the column
+		vstate up = loadState(cur + C*(lo-1));
+
+		for(i = lo; i <= hi; i++)
+		{
+			//M from the diagonal, X from above, Y from the left
+			vstate diag = loadState(prev + C*(i-1));
+			vstate left = loadState(prev + C*i);
+
+			vstate srcM = {diag[0], up[0], left[0], minVal};
+			vstate srcX = {diag[1], up[1], left[1], minVal};
+			vstate srcY = {diag[2], up[2], left[2], minVal};
+			vstate emission = {emissionM[symX[i]], emisX[i], emissionY, 0.0};
+
+			vstate val = emission + LogSumExp::logSum(srcM + fromM, srcX + fromX, srcY + fromY);
+
+			vstate rows = splat<vstate>(i);
+			vstatel inBand = (rows >= bandLo) & (rows <= bandHi);
+			val = inBand ? val : minV;
+			storeState(cur + C*i, val);
+			up = val;
+
+			if (writeBack)
+				for(s = 0; s < Definitions::stateCount; s++)
+					if (inBand[s])
+						storeCell(s, i, j, val[s]);
+		}
+	}
+
+	sM = cur[C*n1 + Definitions::Match];
+	sX = cur[C*n1 + Definitions::Insert];
+	sY = cur[C*n1 + Definitions::Delete];
+
+	sS = LogSumExp::logSum(sM,sX,sY) + log(xi);
+
+	//hand the columns back clean
+	if (curLo <= curHi)
+		std::fill(cur + C*curLo, cur + C*(curHi+1), minVal);
+	if (prevLo <= prevHi)
+		std::fill(prev + C*prevLo, prev + C*(prevHi+1), minVal);
+	ws.releaseColumns<double>();
+
+	this->setTotalLikelihood(sS);
+
+	DUMP ("Forward interleaved lnls I, D, M, Total " << sX << "\t" << sY << "\t" << sM << "\t" << sS);
+
+	return sS* -1.0;
+}
+#endif
+
+
+
+void ForwardPairHMM::findAmbiguousRuns(vector<SequenceElement*>* seq, Definitions::StateId stay, vector<AmbiguousRun>& runs)
+{
+	const unsigned int alphabet = substModel->getMatrixSize();
+	unsigned int start = 0;
+
+	for(unsigned int k = 0; k <= seq->size(); k++)
+	{
+		if (k < seq->size() && (*seq)[k]->isFastaClass() && (*seq)[k]->getClassSize() == alphabet)
+			continue;
+		//elements start..k-1 are rows or columns start+1..k
+		if (k - start >= Definitions::ambiguousRunMinLength)
+			runs.push_back(AmbiguousRun(start+1, k, stay));
+		start = k+1;
+	}
+}
+
+void ForwardPairHMM::prepareAmbiguousRuns(vector<int>* colLo, vector<int>* colHi, const double trans[Definitions::stateCount][Definitions::stateCount])
+{
+	const int n1 = xSize-1;
+	const int n2 = ySize-1;
+	int j, s;
+
+	//rows of column col in band for any state, the start cell included
+	auto columnRange = [&](int col, int& lo, int& hi)
+	{
+		lo = col == 0 ? 0 : n1+1;
+		hi = col == 0 ? 0 : -1;
+		for(unsigned int st = 0; st < Definitions::stateCount; st++)
+		{
+			if (colLo[st][col] > colHi[st][col])
+				continue;
+			lo = std::min(lo, colLo[st][col]);
+			hi = std::max(hi, colHi[st][col]);
+		}
+	};
+
+	//band of the other sequence at the boundaries of a run, rows for a column run and columns for a row run
+	vector<int> bandLo, bandHi;
+
+	for(auto& run : columnRuns)
+	{
+		const unsigned int length = run.last - run.first + 1;
+		double cells = 0;
+		run.used = false;
+		bandLo.resize(length+1);
+		bandHi.resize(length+1);
+		for(j = run.first-1; j <= run.last; j++)
+		{
+			columnRange(j, bandLo[j-run.first+1], bandHi[j-run.first+1]);
+			for(s = 0; s < Definitions::stateCount; s++)
+				cells += std::max(0, colHi[s][j] - colLo[s][j] + 1);
+		}
+		const int lo0 = bandLo.front(), hi0 = bandHi.front();
+		const int lo1 = bandLo.back(), hi1 = bandHi.back();
+		if (lo0 > hi0 || lo1 > hi1 || hi1 < lo0)
+			continue;
+
+		run.transfer.setTransitions(trans);
+		run.transfer.setBand(bandLo, bandHi);
+		if (run.transfer.getCost(double(hi0-lo0+1) * (hi1-lo1+1)) >= cells * Definitions::ambiguousRunCellCost)
+			continue;
+		run.transfer.calculate();
+		run.used = true;
+	}
+
+	for(auto& run : rowRuns)
+	{
+		const unsigned int length = run.last - run.first + 1;
+		double cells = 0;
+		int lo, hi;
+		run.used = false;
+		bandLo.assign(length+1, n2+1);
+		bandHi.assign(length+1, -1);
+		for(j = 0; j <= n2; j++)
+		{
+			columnRange(j, lo, hi);
+			for(int row = std::max(lo, run.first-1); row <= std::min(hi, run.last); row++)
+			{
+				bandLo[row-run.first+1] = std::min(bandLo[row-run.first+1], j);
+				bandHi[row-run.first+1] = std::max(bandHi[row-run.first+1], j);
+			}
+			for(s = 0; s < Definitions::stateCount; s++)
+				cells += std::max(0, std::min(colHi[s][j], run.last) - std::max(colLo[s][j], run.first) + 1);
+		}
+		const int a0 = bandLo.front(), b0 = bandHi.front();
+		const int a1 = bandLo.back(), b1 = bandHi.back();
+		if (a0 > b0 || a1 > b1 || b1 < a0)
+			continue;
+
+		//the rows of a column run are not calculated, its columns can't feed the row run
+		bool crossed = false;
+		for(auto& columnRun : columnRuns)
+			crossed |= columnRun.used && columnRun.first-1 <= b1 && columnRun.last >= a0;
+		if (crossed)
+			continue;
+
+		run.transfer.setTransitions(trans);
+		run.transfer.setBand(bandLo, bandHi);
+		if (run.transfer.getCost(double(b0-a0+1) * (b1-a1+1)) >= cells * Definitions::ambiguousRunCellCost)
+			continue;
+		run.transfer.calculate();
+		run.used = true;
+
+		for(s = 0; s < Definitions::stateCount; s++)
+			run.entry[s].assign(ySize, 0.0);
+		run.entryLog2.assign(ySize, -HUGE_VAL);
+	}
+}
+
+double ForwardPairHMM::runScaled()
+{
+	if (precision == Definitions::DpPrecision::Single)
+		return runScaledKernel<float>();
+	return runScaledKernel<double>();
+}
+
+template<typename Real>
+double ForwardPairHMM::runScaledKernel()
+{
+	using VectorMaths::vdouble;
+	using VectorMaths::vlong;
+
+	const int W = VectorMaths::lanes;
+	const int n1 = xSize-1;
+	const int n2 = ySize-1;
+	const double minVal = Definitions::minMatrixLikelihood;
+	const double ln2 = 0.693147180559945309417;
+	const Real tinyVal = std::numeric_limits<Real>::min();
+
+	int i,j,k,s;
+	int lo, hi;
+	int exponent;
+
+	double sX,sY,sM, sS;
+
+	M->initializeData(this->piM);
+	X->initializeData(this->piI);
+	Y->initializeData(this->piD);
+
+	DpWorkspace& ws = getWorkspace();
+
+	vector<int>* colLo = &ws.getBuffer<int>(DpWorkspace::ColumnLo);
+	vector<int>* colHi = &ws.getBuffer<int>(DpWorkspace::ColumnHi);
+	getColumnRanges(colLo, colHi);
+
+	//linear space emissions
+	vector<double>& emisX = ws.getBuffer<double>(DpWorkspace::EmissionX);
+	vector<double>& emisY = ws.getBuffer<double>(DpWorkspace::EmissionY);
+	vector<double>& emisM = ws.getBuffer<double>(DpWorkspace::EmissionM);
+	vector<unsigned int>& symX = ws.getBuffer<unsigned int>(DpWorkspace::SymbolsX);
+	vector<unsigned int>& symY = ws.getBuffer<unsigned int>(DpWorkspace::SymbolsY);
+	getEmissionProfiles(emisX, emisY, emisM, symX, symY);
+
+	//runs of ambiguous symbols are crossed in one step where only the likelihood is kept
+	const bool crossRuns = (matrixType == Definitions::DpMatrixType::Rolling || matrixType == Definitions::DpMatrixType::Limited) &&
+			!(rowRuns.empty() && columnRuns.empty());
+
+	//log emissions of the first i symbols alone, what a path pays for them inside a run of the other sequence
+	vector<double>& prefixX = ws.getBuffer<double>(DpWorkspace::RunPrefixX);
+	vector<double>& prefixY = ws.getBuffer<double>(DpWorkspace::RunPrefixY);
+	if (crossRuns)
+	{
+		prefixX.assign(xSize, 0.0);
+		prefixY.assign(ySize, 0.0);
+		for(i = 1; i <= n1; i++)
+			prefixX[i] = prefixX[i-1] + emisX[i];
+		for(j = 1; j <= n2; j++)
+			prefixY[j] = prefixY[j-1] + emisY[j];
+	}
+
+	for(auto& val : emisX)
+		val = exp(val);
+	for(auto& val : emisY)
+		val = exp(val);
+	for(auto& val : emisM)
+		val = exp(val);
+
+	vector<Real>& linX = ws.getBuffer<Real>(DpWorkspace::LinearX);
+	vector<Real>& linY = ws.getBuffer<Real>(DpWorkspace::LinearY);
+	vector<Real>& linM = ws.getBuffer<Real>(DpWorkspace::LinearM);
+	linX.assign(emisX.begin(), emisX.end());
+	linY.assign(emisY.begin(), emisY.end());
+	linM.assign(emisM.begin(), emisM.end());
+
+	const Real xm = exp(X->getTransitionProbabilityFromMatch());
+	const Real xx = exp(X->getTransitionProbabilityFromInsert());
+	const Real xy = exp(X->getTransitionProbabilityFromDelete());
+	const Real ym = exp(Y->getTransitionProbabilityFromMatch());
+	const Real yx = exp(Y->getTransitionProbabilityFromInsert());
+	const Real yy = exp(Y->getTransitionProbabilityFromDelete());
+	const Real mm = exp(M->getTransitionProbabilityFromMatch());
+	const Real mx = exp(M->getTransitionProbabilityFromInsert());
+	const Real my = exp(M->getTransitionProbabilityFromDelete());
+
+	//rows outside the row runs the transfer crosses, the run after segment k is usedRowRuns[k]
+	vector<std::pair<int,int> > rowSegments;
+	vector<AmbiguousRun*> usedRowRuns;
+	vector<AmbiguousRun*> usedColumnRuns;
+	if (crossRuns)
+	{
+		//trans[from][to]
+		double trans[Definitions::stateCount][Definitions::stateCount];
+		trans[Definitions::Match][Definitions::Match] = exp(M->getTransitionProbabilityFromMatch());
+		trans[Definitions::Insert][Definitions::Match] = exp(M->getTransitionProbabilityFromInsert());
+		trans[Definitions::Delete][Definitions::Match] = exp(M->getTransitionProbabilityFromDelete());
+		trans[Definitions::Match][Definitions::Insert] = exp(X->getTransitionProbabilityFromMatch());
+		trans[Definitions::Insert][Definitions::Insert] = exp(X->getTransitionProbabilityFromInsert());
+		trans[Definitions::Delete][Definitions::Insert] = exp(X->getTransitionProbabilityFromDelete());
+		trans[Definitions::Match][Definitions::Delete] = exp(Y->getTransitionProbabilityFromMatch());
+		trans[Definitions::Insert][Definitions::Delete] = exp(Y->getTransitionProbabilityFromInsert());
+		trans[Definitions::Delete][Definitions::Delete] = exp(Y->getTransitionProbabilityFromDelete());
+		prepareAmbiguousRuns(colLo, colHi, trans);
+
+		for(auto& run : columnRuns)
+			if (run.used)
+				usedColumnRuns.push_back(&run);
+		for(auto& run : rowRuns)
+			if (run.used)
+				usedRowRuns.push_back(&run);
+	}
+	int segmentStart = 0;
+	for(auto run : usedRowRuns)
+	{
+		rowSegments.push_back(std::make_pair(segmentStart, run->first-1));
+		segmentStart = run->last+1;
+	}
+	rowSegments.push_back(std::make_pair(segmentStart, n1));
+
+	//two columns per state, true probability = stored value * 2^columnScale
+	Real* columns = ws.getColumns<Real>(Definitions::stateCount * 2 * (xSize+W), 0.0);
+	Real* cur[Definitions::stateCount];
+	Real* prev[Definitions::stateCount];
+	int curLo = 0, curHi = -1;
+	int prevLo = 0, prevHi = -1;
+	long columnScale = 0;
+
+	for(s = 0; s < Definitions::stateCount; s++)
+	{
+		cur[s] = columns + (2*s)*(xSize+W);
+		prev[s] = columns + (2*s+1)*(xSize+W);
+	}
+
+	PairwiseHmmStateBase* states[Definitions::stateCount];
+	bool writeBack = matrixType == Definitions::DpMatrixType::Full || matrixType == Definitions::DpMatrixType::Banded ||
+			matrixType == Definitions::DpMatrixType::FullFloat;
+	states[Definitions::Match] = M;
+	states[Definitions::Insert] = X;
+	states[Definitions::Delete] = Y;
+
+	auto storeCell = [&](unsigned int st, unsigned int row, unsigned int col, double val)
+	{
+		if (matrixType == Definitions::DpMatrixType::Banded)
+			states[st]->setValueAt<DpMatrixBanded>(row,col,val);
+		else if (matrixType == Definitions::DpMatrixType::FullFloat)
+			states[st]->setValueAt<DpMatrixFloat>(row,col,val);
+		else
+			states[st]->setValueAt<DpMatrixFull>(row,col,val);
+	};
+
+	//converts the in-band part of the current column back to log space
+	double logBuffer[VectorMaths::lanes];
+	auto storeColumn = [&](int col)
+	{
+		const vdouble offset = VectorMaths::broadcast(columnScale * ln2);
+		const vdouble minV = VectorMaths::broadcast(minVal);
+		for(s = 0; s < Definitions::stateCount; s++)
+		{
+			for(i = colLo[s][col]; i <= colHi[s][col]; i += W)
+			{
+				for(k = 0; k < W; k++)
+					logBuffer[k] = cur[s][i+k];
+				vdouble val = VectorMaths::load(logBuffer);
+				vlong tiny = val < static_cast<double>(tinyVal);
+				VectorMaths::store(logBuffer, tiny ? minV : VectorMaths::log(val) + offset);
+				for(k = 0; k < W && i+k <= colHi[s][col]; k++)
+					storeCell(s, i+k, col, logBuffer[k]);
+			}
+		}
+	};
+
+	//the current column holds nothing but zeros so far
+	bool columnEmpty = true;
+
+	//rescales the current column so that its largest entry lies in [0.5,1)
+	auto rescaleColumn = [&]()
+	{
+		Real maxVal = 0;
+		for(s = 0; s < Definitions::stateCount; s++)
+			for(i = curLo; i <= curHi; i++)
+				maxVal = std::max(maxVal, cur[s][i]);
+		columnEmpty = maxVal == 0;
+		if (maxVal == 0)
+			return;
+		frexp(maxVal, &exponent);
+		//kept in double - 2^-exponent of a subnormal float maximum overflows a float
+		const double factor = ldexp(1.0, -exponent);
+		for(s = 0; s < Definitions::stateCount; s++)
+			for(i = curLo; i <= curHi; i++)
+				cur[s][i] = cur[s][i] * factor;
+		columnScale += exponent;
+	};
+
+	//keeps the row above each crossed row run for the columns that follow
+	auto recordEntries = [&](int col)
+	{
+		for(auto run : usedRowRuns)
+		{
+			const int row = run->first-1;
+			bool inBand = row >= curLo && row <= curHi && !columnEmpty;
+			for(unsigned int st = 0; st < Definitions::stateCount; st++)
+				run->entry[st][col] = inBand ? cur[st][row] : 0.0;
+			run->entryLog2[col] = inBand ? columnScale - prefixY[col] / ln2 : -HUGE_VAL;
+		}
+	};
+
+	//the last row of a crossed row run in column col, from the row above the run in this and the previous columns.
+	//The entries carry the emissions of the columns up to theirs, the columns in between are paid by prefixY
+	auto crossRowRun = [&](AmbiguousRun& run, int col)
+	{
+		const int entryRow = run.first-1;
+		const int exitRow = run.last;
+		const AmbiguousRunTransfer& transfer = run.transfer;
+		if (exitRow < curLo || exitRow > curHi)
+			return;
+		const int first = std::max(0, col - transfer.getHi());
+		const int last = std::min(col, col - transfer.getLo());
+
+		bool curEntry = false;
+		for(unsigned int st = 0; st < Definitions::stateCount; st++)
+			curEntry |= cur[st][entryRow] > 0;
+		const double curLog2 = curEntry ? columnScale - prefixY[col] / ln2 : -HUGE_VAL;
+
+		double base = -HUGE_VAL;
+		for(int jj = first; jj <= last; jj++)
+			base = std::max(base, jj == col ? curLog2 : run.entryLog2[jj]);
+		if (base == -HUGE_VAL)
+			return;
+
+		double acc[Definitions::stateCount] = {0.0, 0.0, 0.0};
+		for(int jj = first; jj <= last; jj++)
+		{
+			const double entryLog2 = jj == col ? curLog2 : run.entryLog2[jj];
+			if (entryLog2 == -HUGE_VAL)
+				continue;
+			const double weight = exp2(entryLog2 - base);
+			for(unsigned int from = 0; from < Definitions::stateCount; from++)
+			{
+				const double val = weight * (jj == col ? cur[from][entryRow] : run.entry[from][jj]);
+				for(unsigned int to = 0; to < Definitions::stateCount; to++)
+					acc[to] += val * transfer.get(from, to, col-jj);
+			}
+		}
+
+		//log2 scale of acc, the column moves to it if it is empty or smaller
+		const double total = base + prefixY[col] / ln2 + transfer.getExponent();
+		if (columnEmpty || total > columnScale)
+		{
+			const long newScale = static_cast<long>(floor(total));
+			if (!columnEmpty)
+			{
+				const double factor = ldexp(1.0, static_cast<int>(columnScale - newScale));
+				for(unsigned int st = 0; st < Definitions::stateCount; st++)
+					for(int row = curLo; row <= curHi; row++)
+						cur[st][row] = cur[st][row] * factor;
+			}
+			columnScale = newScale;
+			columnEmpty = false;
+		}
+		const double factor = exp2(total - columnScale);
+		for(unsigned int to = 0; to < Definitions::stateCount; to++)
+			if (colLo[to][col] <= exitRow && exitRow <= colHi[to][col])
+				cur[to][exitRow] = acc[to] * factor;
+	};
+
+	//column run.last from column run.first-1 in prev. Between the rows i and i' a path pays the emissions of
+	//rows i+1..i' alone, split into a factor of i and one of i' around the rows both columns hold
+	auto crossColumnRun = [&](AmbiguousRun& run)
+	{
+		const int col = run.last;
+		const AmbiguousRunTransfer& transfer = run.transfer;
+		const double entryOffset = prefixX[prevHi];
+		const double exitOffset = prefixX[curLo];
+
+		for(unsigned int to = 0; to < Definitions::stateCount; to++)
+		{
+			for(int row = colLo[to][col]; row <= colHi[to][col]; row++)
+			{
+				const int first = std::max(prevLo, row - transfer.getHi());
+				const int last = std::min(prevHi, row - transfer.getLo());
+				double acc = 0;
+				for(int entryRow = first; entryRow <= last; entryRow++)
+				{
+					double val = 0;
+					for(unsigned int from = 0; from < Definitions::stateCount; from++)
+						val += prev[from][entryRow] * transfer.get(from, to, row-entryRow);
+					if (val > 0)
+						acc += val * exp(entryOffset - prefixX[entryRow]);
+				}
+				cur[to][row] = acc * exp(prefixX[row] - exitOffset);
+			}
+		}
+
+		const double total = columnScale + transfer.getExponent() + (exitOffset - entryOffset) / ln2;
+		columnScale = static_cast<long>(floor(total));
+		const double factor = exp2(total - columnScale);
+		for(unsigned int st = 0; st < Definitions::stateCount; st++)
+			for(int row = curLo; row <= curHi; row++)
+				cur[st][row] = cur[st][row] * factor;
+	};
+
+	//1st column, X only below the (0,0) start cell
+	cur[Definitions::Match][0] = exp(this->piM);
+	cur[Definitions::Insert][0] = exp(this->piI);
+	cur[Definitions::Delete][0] = exp(this->piD);
+	curLo = 0;
+	curHi = std::max(0, colHi[Definitions::Insert][0]);
+
+	for(i = colLo[Definitions::Insert][0]; i <= colHi[Definitions::Insert][0]; i++)
+		cur[Definitions::Insert][i] = linX[i] * (xm * cur[Definitions::Match][i-1] + xx * cur[Definitions::Insert][i-1]
+				+ xy * cur[Definitions::Delete][i-1]);
+
+	rescaleColumn();
+	if (writeBack)
+		storeColumn(0);
+	recordEntries(0);
+
+	unsigned int nextColumnRun = 0;
+	for(j = 1; j <= n2; j++)
+	{
+		for(s = 0; s < Definitions::stateCount; s++)
+			std::swap(cur[s], prev[s]);
+		std::swap(curLo, prevLo);
+		std::swap(curHi, prevHi);
+
+		//drop what column j-2 left behind
+		for(s = 0; s < Definitions::stateCount; s++)
+			std::fill(cur[s] + curLo, cur[s] + curHi + 1, 0.0);
+
+		lo = n1+1;
+		hi = -1;
+		for(s = 0; s < Definitions::stateCount; s++)
+		{
+			if (colLo[s][j] > colHi[s][j])
+				continue;
+			lo = std::min(lo, colLo[s][j]);
+			hi = std::max(hi, colHi[s][j]);
+		}
+		curLo = lo;
+		curHi = hi;
+
+		if (nextColumnRun < usedColumnRuns.size() && usedColumnRuns[nextColumnRun]->first == j)
+		{
+			//jumps to the last column of the run, the columns of the run are never calculated
+			AmbiguousRun& run = *usedColumnRuns[nextColumnRun++];
+			j = run.last;
+			curLo = n1+1;
+			curHi = -1;
+			for(s = 0; s < Definitions::stateCount; s++)
+			{
+				if (colLo[s][j] > colHi[s][j])
+					continue;
+				curLo = std::min(curLo, colLo[s][j]);
+				curHi = std::max(curHi, colHi[s][j]);
+			}
+			crossColumnRun(run);
+			rescaleColumn();
+			recordEntries(j);
+			continue;
+		}
+
+		const Real emissionY = linY[j];
+		for(auto& segment : rowSegments)
+			for(i = std::max(segment.first, colLo[Definitions::Delete][j]); i <= std::min(segment.second, colHi[Definitions::Delete][j]); i++)
+				cur[Definitions::Delete][i] = emissionY * (ym * prev[Definitions::Match][i] + yx * prev[Definitions::Insert][i]
+						+ yy * prev[Definitions::Delete][i]);
+
+		const Real* emissionM = linM.data() + symY[j];
+		for(auto& segment : rowSegments)
+			for(i = std::max(segment.first, colLo[Definitions::Match][j]); i <= std::min(segment.second, colHi[Definitions::Match][j]); i++)
+				cur[Definitions::Match][i] = emissionM[symX[i]] * (mm * prev[Definitions::Match][i-1] + mx * prev[Definitions::Insert][i-1]
+						+ my * prev[Definitions::Delete][i-1]);
+
+		//the last row of a row run is in place before the insert recursion carries on below it
+		for(k = 0; k < (int) rowSegments.size(); k++)
+		{
+			for(i = std::max(rowSegments[k].first, colLo[Definitions::Insert][j]); i <= std::min(rowSegments[k].second, colHi[Definitions::Insert][j]); i++)
+				cur[Definitions::Insert][i] = linX[i] * (xm * cur[Definitions::Match][i-1] + xx * cur[Definitions::Insert][i-1]
+						+ xy * cur[Definitions::Delete][i-1]);
+			if (k < (int) usedRowRuns.size())
+				crossRowRun(*usedRowRuns[k], j);
+		}
+
+		columnEmpty = true;
+		if (curLo <= curHi)
+			rescaleColumn();
+		if (writeBack)
+			storeColumn(j);
+		recordEntries(j);
+	}
+
+	auto toLog = [&](double val)
+	{
+		return val < tinyVal ? minVal : log(val) + columnScale * ln2;
+	};
+
+	sM = toLog(cur[Definitions::Match][n1]);
+	sX = toLog(cur[Definitions::Insert][n1]);
+	sY = toLog(cur[Definitions::Delete][n1]);
+
+	sS = LogSumExp::logSum(sM,sX,sY) + log(xi);
+
+	//only the last two columns hold anything
+	for(s = 0; s < Definitions::stateCount; s++)
+	{
+		std::fill(cur[s] + curLo, cur[s] + curHi + 1, 0.0);
+		std::fill(prev[s] + prevLo, prev[s] + prevHi + 1, 0.0);
+	}
+	ws.releaseColumns<Real>();
+
+	this->setTotalLikelihood(sS);
+
+	DUMP ("Forward scaled lnls I, D, M, Total " << sX << "\t" << sY << "\t" << sM << "\t" << sS);
+
+	return sS* -1.0;
+}
+
+bool ForwardPairHMM::providesDerivatives()
+{
+	return precision == Definitions::DpPrecision::Single || WavefrontScheduler::getThreadBudget() < Definitions::wavefrontBrentMinThreads ||
+			getDpCells() < Definitions::wavefrontMinCells;
+}
+
+double ForwardPairHMM::runAlgorithmWithDerivatives(double& first, double& second)
+{
+	if (precision == Definitions::DpPrecision::Single)
+		return runDerivativesKernel<float>(first, second);
+	return runDerivativesKernel<double>(first, second);
+}
+
+template<typename Real>
+double ForwardPairHMM::runDerivativesKernel(double& first, double& second)
+{
+	//orders of the time derivative carried along with the probabilities
+	const int orders = 3;
+	const int n1 = xSize-1;
+	const int n2 = ySize-1;
+	const double minVal = Definitions::minMatrixLikelihood;
+	const double ln2 = 0.693147180559945309417;
+	const Real tinyVal = std::numeric_limits<Real>::min();
+
+	int i,j,k,o,s;
+	int lo, hi;
+	int exponent;
+
+	double sX,sY,sM, sS;
+
+	DpWorkspace& ws = getWorkspace();
+
+	vector<int>* colLo = &ws.getBuffer<int>(DpWorkspace::ColumnLo);
+	vector<int>* colHi = &ws.getBuffer<int>(DpWorkspace::ColumnHi);
+	getColumnRanges(colLo, colHi);
+
+	//linear space emissions, the pair emissions with their time derivatives
+	vector<double>& emisX = ws.getBuffer<double>(DpWorkspace::EmissionX);
+	vector<double>& emisY = ws.getBuffer<double>(DpWorkspace::EmissionY);
+	vector<double>& emisM = ws.getBuffer<double>(DpWorkspace::EmissionM);
+	vector<double>& emisMDt = ws.getBuffer<double>(DpWorkspace::EmissionMDt);
+	vector<double>& emisMDt2 = ws.getBuffer<double>(DpWorkspace::EmissionMDt2);
+	vector<unsigned int>& symX = ws.getBuffer<unsigned int>(DpWorkspace::SymbolsX);
+	vector<unsigned int>& symY = ws.getBuffer<unsigned int>(DpWorkspace::SymbolsY);
+	getEmissionProfiles(emisX, emisY, emisM, symX, symY, &emisMDt, &emisMDt2);
+
+	for(auto& val : emisX)
+		val = exp(val);
+	for(auto& val : emisY)
+		val = exp(val);
+	for(auto& val : emisM)
+		val = exp(val);
+
+	vector<Real>& linX = ws.getBuffer<Real>(DpWorkspace::LinearX);
+	vector<Real>& linY = ws.getBuffer<Real>(DpWorkspace::LinearY);
+	vector<Real>& linM = ws.getBuffer<Real>(DpWorkspace::LinearM);
+	vector<Real>& linMDt = ws.getBuffer<Real>(DpWorkspace::LinearMDt);
+	vector<Real>& linMDt2 = ws.getBuffer<Real>(DpWorkspace::LinearMDt2);
+	linX.assign(emisX.begin(), emisX.end());
+	linY.assign(emisY.begin(), emisY.end());
+	linM.assign(emisM.begin(), emisM.end());
+	linMDt.assign(emisMDt.begin(), emisMDt.end());
+	linMDt2.assign(emisMDt2.begin(), emisMDt2.end());
+
+	//every transition is linear in the gap opening probability g, e and xi do not depend on the time
+	const double gDt = tpb->getGapOpeningDt();
+	const double gDt2 = tpb->getGapOpeningDt2();
+
+	PairwiseHmmStateBase* states[Definitions::stateCount];
+	states[Definitions::Match] = M;
+	states[Definitions::Insert] = X;
+	states[Definitions::Delete] = Y;
+
+	//transitions into state s from state k, first and second time derivatives
+	Real trans[orders][Definitions::stateCount][Definitions::stateCount];
+	double transDg[Definitions::stateCount][Definitions::stateCount] = {
+			{-2.0*(1-xi), -2.0*(1-e-xi), -2.0*(1-e-xi)},
+			{1-xi, 1-e-xi, 1-e-xi},
+			{1-xi, 1-e-xi, 1-e-xi}};
+
+	for(s = 0; s < Definitions::stateCount; s++)
+	{
+		trans[0][s][Definitions::Match] = exp(states[s]->getTransitionProbabilityFromMatch());
+		trans[0][s][Definitions::Insert] = exp(states[s]->getTransitionProbabilityFromInsert());
+		trans[0][s][Definitions::Delete] = exp(states[s]->getTransitionProbabilityFromDelete());
+		for(k = 0; k < Definitions::stateCount; k++)
+		{
+			trans[1][s][k] = transDg[s][k] * gDt;
+			trans[2][s][k] = transDg[s][k] * gDt2;
+		}
+	}
+
+	//start probabilities, the equilibriums are differentiated numerically in g
+	Real start[orders][Definitions::stateCount];
+	double mdTmp[Definitions::stateCount][Definitions::stateCount];
+	double piG[3][Definitions::stateCount];
+	const double logPi[Definitions::stateCount] = {piM, piI, piD};
+	const double h = 1e-3 * g;
+
+	calculateStateEquilibriums(g-h, e, mdTmp, piG[0][Definitions::Match], piG[0][Definitions::Insert], piG[0][Definitions::Delete]);
+	calculateStateEquilibriums(g, e, mdTmp, piG[1][Definitions::Match], piG[1][Definitions::Insert], piG[1][Definitions::Delete]);
+	calculateStateEquilibriums(g+h, e, mdTmp, piG[2][Definitions::Match], piG[2][Definitions::Insert], piG[2][Definitions::Delete]);
+
+	for(s = 0; s < Definitions::stateCount; s++)
+	{
+		start[0][s] = exp(logPi[s]);
+		start[1][s] = start[2][s] = 0;
+		if (!equilibriumFreqs || logPi[s] <= minVal)
+			continue;
+		double dg = (piG[2][s] - piG[0][s]) / (2*h);
+		double dg2 = (piG[2][s] - 2*piG[1][s] + piG[0][s]) / (h*h);
+		start[1][s] = dg * gDt;
+		start[2][s] = dg2 * gDt * gDt + dg * gDt2;
+	}
+
+	//two columns per state and order, true value = stored value * 2^columnScale
+	Real* columns = ws.getColumns<Real>(orders * Definitions::stateCount * 2 * xSize, 0.0);
+	Real* cur[orders][Definitions::stateCount];
+	Real* prev[orders][Definitions::stateCount];
+	int curLo = 0, curHi = -1;
+	int prevLo = 0, prevHi = -1;
+	long columnScale = 0;
+
+	for(o = 0; o < orders; o++)
+		for(s = 0; s < Definitions::stateCount; s++)
+		{
+			cur[o][s] = columns + (2*(o*Definitions::stateCount+s))*xSize;
+			prev[o][s] = columns + (2*(o*Definitions::stateCount+s)+1)*xSize;
+		}
+
+	//F, F' and F'' of cell (row, current column) of state st, sources taken from row r of src
+	auto computeCell = [&](int st, Real* (&src)[orders][Definitions::stateCount], int r, int row,
+			Real em, Real emDt, Real emDt2)
+	{
+		Real s0 = 0, s1 = 0, s2 = 0;
+		for(int kk = 0; kk < Definitions::stateCount; kk++)
+		{
+			const Real f = src[0][kk][r];
+			const Real f1 = src[1][kk][r];
+			const Real f2 = src[2][kk][r];
+			s0 += trans[0][st][kk] * f;
+			s1 += trans[1][st][kk] * f + trans[0][st][kk] * f1;
+			s2 += trans[2][st][kk] * f + 2 * trans[1][st][kk] * f1 + trans[0][st][kk] * f2;
+		}
+		cur[0][st][row] = em * s0;
+		cur[1][st][row] = emDt * s0 + em * s1;
+		cur[2][st][row] = emDt2 * s0 + 2 * emDt * s1 + em * s2;
+	};
+
+	//rescales the current column so that its largest probability lies in [0.5,1), derivatives follow
+	auto rescaleColumn = [&]()
+	{
+		Real maxVal = 0;
+		for(s = 0; s < Definitions::stateCount; s++)
+			for(i = curLo; i <= curHi; i++)
+				maxVal = std::max(maxVal, cur[0][s][i]);
+		if (maxVal == 0)
+			return;
+		frexp(maxVal, &exponent);
+		const double factor = ldexp(1.0, -exponent);
+		for(o = 0; o < orders; o++)
+			for(s = 0; s < Definitions::stateCount; s++)
+				for(i = curLo; i <= curHi; i++)
+					cur[o][s][i] = cur[o][s][i] * factor;
+		columnScale += exponent;
+	};
+
+	//1st column, X only below the (0,0) start cell
+	for(o = 0; o < orders; o++)
+		for(s = 0; s < Definitions::stateCount; s++)
+			cur[o][s][0] = start[o][s];
+	curLo = 0;
+	curHi = std::max(0, colHi[Definitions::Insert][0]);
+
+	for(i = colLo[Definitions::Insert][0]; i <= colHi[Definitions::Insert][0]; i++)
+		computeCell(Definitions::Insert, cur, i-1, i, linX[i], 0, 0);
+
+	rescaleColumn();
+
+	for(j = 1; j <= n2; j++)
+	{
+		for(o = 0; o < orders; o++)
+			for(s = 0; s < Definitions::stateCount; s++)
+				std::swap(cur[o][s], prev[o][s]);
+		std::swap(curLo, prevLo);
+		std::swap(curHi, prevHi);
+
+		//drop what column j-2 left behind
+		for(o = 0; o < orders; o++)
+			for(s = 0; s < Definitions::stateCount; s++)
+				std::fill(cur[o][s] + curLo, cur[o][s] + curHi + 1, 0.0);
+
+		lo = n1+1;
+		hi = -1;
+		for(s = 0; s < Definitions::stateCount; s++)
+		{
+			if (colLo[s][j] > colHi[s][j])
+				continue;
+			lo = std::min(lo, colLo[s][j]);
+			hi = std::max(hi, colHi[s][j]);
+		}
+		curLo = lo;
+		curHi = hi;
+
+		for(i = colLo[Definitions::Delete][j]; i <= colHi[Definitions::Delete][j]; i++)
+			computeCell(Definitions::Delete, prev, i, i, linY[j], 0, 0);
+
+		for(i = colLo[Definitions::Match][j]; i <= colHi[Definitions::Match][j]; i++)
+		{
+			const unsigned int pair = symX[i] + symY[j];
+			computeCell(Definitions::Match, prev, i-1, i, linM[pair], linMDt[pair], linMDt2[pair]);
+		}
+
+		for(i = colLo[Definitions::Insert][j]; i <= colHi[Definitions::Insert][j]; i++)
+			computeCell(Definitions::Insert, cur, i-1, i, linX[i], 0, 0);
+
+		if (curLo <= curHi)
+			rescaleColumn();
+	}
+
+	auto toLog = [&](double val)
+	{
+		return val < tinyVal ? minVal : log(val) + columnScale * ln2;
+	};
+
+	sM = toLog(cur[0][Definitions::Match][n1]);
+	sX = toLog(cur[0][Definitions::Insert][n1]);
+	sY = toLog(cur[0][Definitions::Delete][n1]);
+
+	sS = LogSumExp::logSum(sM,sX,sY) + log(xi);
+
+	this->setTotalLikelihood(sS);
+
+	//d lnL = F'/F, d2 lnL = F''/F - (F'/F)^2, the column scale and xi cancel out
+	double total[orders];
+	for(o = 0; o < orders; o++)
+		total[o] = (double) cur[o][Definitions::Match][n1] + cur[o][Definitions::Insert][n1] + cur[o][Definitions::Delete][n1];
+
+	first = second = 0;
+	if (total[0] > 0)
+	{
+		first = -1.0 * total[1] / total[0];
+		second = -1.0 * (total[2] / total[0] - first * first);
+	}
+
+	//only the last two columns hold anything
+	for(o = 0; o < orders; o++)
+		for(s = 0; s < Definitions::stateCount; s++)
+		{
+			std::fill(cur[o][s] + curLo, cur[o][s] + curHi + 1, 0.0);
+			std::fill(prev[o][s] + prevLo, prev[o][s] + prevHi + 1, 0.0);
+		}
+	ws.releaseColumns<Real>();
+
+	DUMP ("Forward derivatives lnl, -dlnl/dt, -d2lnl/dt2 " << sS << "\t" << first << "\t" << second);
+
+	return sS* -1.0;
+}
+
+vector<double> ForwardPairHMM::runAlgorithmBatch(const vector<double>& times)
+{
+	using VectorMaths::vdouble;
+	using VectorMaths::load;
+	using VectorMaths::store;
+	using VectorMaths::broadcast;
+
+	const unsigned int W = VectorMaths::lanes;
+	const int n1 = xSize-1;
+	const int n2 = ySize-1;
+	const double minVal = Definitions::minMatrixLikelihood;
+
+	int i,j,s;
+	unsigned int l;
+
+	vector<double> result(times.size());
+
+	if (times.empty())
+		return result;
+
+	if(this->band == NULL)
+	{
+		//the unbanded recursion has its own boundary cells - one time after another
+		for(l = 0; l < times.size(); l++)
+		{
+			setDivergenceTimeAndCalculateModels(times[l]);
+			result[l] = runAlgorithm();
+		}
+		return result;
+	}
+
+	DpWorkspace& ws = getWorkspace();
+
+	vector<int>* colLo = &ws.getBuffer<int>(DpWorkspace::ColumnLo);
+	vector<int>* colHi = &ws.getBuffer<int>(DpWorkspace::ColumnHi);
+	getColumnRanges(colLo, colHi);
+
+	vector<double>& emisX = ws.getBuffer<double>(DpWorkspace::EmissionX);
+	vector<double>& emisY = ws.getBuffer<double>(DpWorkspace::EmissionY);
+	vector<double>& emisM = ws.getBuffer<double>(DpWorkspace::EmissionM);
+	vector<unsigned int>& symX = ws.getBuffer<unsigned int>(DpWorkspace::SymbolsX);
+	vector<unsigned int>& symY = ws.getBuffer<unsigned int>(DpWorkspace::SymbolsY);
+
+	//per lane pair emissions, lanes of one symbol pair are adjacent
+	vector<double>& pairTable = ws.getBuffer<double>(DpWorkspace::PairTable);
+
+	//per lane transitions and start probabilities
+	enum {MM, MX, MY, XM, XX, XY, YM, YX, YY, PM, PI, PD, parameterCount};
+	double laneParams[parameterCount][VectorMaths::lanes];
+	vdouble params[parameterCount];
+
+	//two columns per state, W lanes per cell
+	double* columns = ws.getColumns<double>(2 * Definitions::stateCount * xSize * W, minVal);
+	auto cell = [&](int col, int st, int row) -> double*
+	{
+		return columns + (((col & 1) * Definitions::stateCount + st) * xSize + row) * W;
+	};
+
+	const vdouble minV = broadcast(minVal);
+
+	//in-band cells of a column back to the sentinel, column 0 also has the start cells
+	auto clearColumn = [&](int col)
+	{
+		for(s = 0; s < Definitions::stateCount; s++)
+		{
+			for(i = colLo[s][col]; i <= colHi[s][col]; i++)
+				store(cell(col,s,i), minV);
+			if (col == 0)
+				store(cell(col,s,0), minV);
+		}
+	};
+
+	for(unsigned int first = 0; first < times.size(); first += W)
+	{
+		//spare lanes repeat the last time so the models end up at times.back()
+		for(l = 0; l < W; l++)
+		{
+			setDivergenceTimeAndCalculateModels(times[std::min<size_t>(first+l, times.size()-1)]);
+			getEmissionProfiles(emisX, emisY, emisM, symX, symY);
+
+			pairTable.resize(emisM.size() * W);
+			for(unsigned int k = 0; k < emisM.size(); k++)
+				pairTable[k*W + l] = emisM[k];
+
+			laneParams[MM][l] = M->getTransitionProbabilityFromMatch();
+			laneParams[MX][l] = M->getTransitionProbabilityFromInsert();
+			laneParams[MY][l] = M->getTransitionProbabilityFromDelete();
+			laneParams[XM][l] = X->getTransitionProbabilityFromMatch();
+			laneParams[XX][l] = X->getTransitionProbabilityFromInsert();
+			laneParams[XY][l] = X->getTransitionProbabilityFromDelete();
+			laneParams[YM][l] = Y->getTransitionProbabilityFromMatch();
+			laneParams[YX][l] = Y->getTransitionProbabilityFromInsert();
+			laneParams[YY][l] = Y->getTransitionProbabilityFromDelete();
+			laneParams[PM][l] = this->piM;
+			laneParams[PI][l] = this->piI;
+			laneParams[PD][l] = this->piD;
+		}
+		for(s = 0; s < parameterCount; s++)
+			params[s] = load(laneParams[s]);
+
+		for(j = 0; j <= n2; j++)
+		{
+			//the buffer held column j-2, its cells go back to the sentinel
+			if (j >= 2)
+				clearColumn(j-2);
+
+			if (j == 0)
+			{
+				store(cell(0,Definitions::Match,0), params[PM]);
+				store(cell(0,Definitions::Insert,0), params[PI]);
+				store(cell(0,Definitions::Delete,0), params[PD]);
+			}
+			else
+			{
+				const vdouble emissionY = broadcast(emisY[j]);
+				for(i = colLo[Definitions::Delete][j]; i <= colHi[Definitions::Delete][j]; i++)
+				{
+					store(cell(j,Definitions::Delete,i), emissionY + LogSumExp::logSum(
+							load(cell(j-1,Definitions::Match,i)) + params[YM],
+							load(cell(j-1,Definitions::Insert,i)) + params[YX],
+							load(cell(j-1,Definitions::Delete,i)) + params[YY]));
+				}
+				for(i = colLo[Definitions::Match][j]; i <= colHi[Definitions::Match][j]; i++)
+				{
+					store(cell(j,Definitions::Match,i), load(&pairTable[(symX[i] + symY[j]) * W]) + LogSumExp::logSum(
+							load(cell(j-1,Definitions::Match,i-1)) + params[MM],
+							load(cell(j-1,Definitions::Insert,i-1)) + params[MX],
+							load(cell(j-1,Definitions::Delete,i-1)) + params[MY]));
+				}
+			}
+			for(i = colLo[Definitions::Insert][j]; i <= colHi[Definitions::Insert][j]; i++)
+			{
+				store(cell(j,Definitions::Insert,i), broadcast(emisX[i]) + LogSumExp::logSum(
+						load(cell(j,Definitions::Match,i-1)) + params[XM],
+						load(cell(j,Definitions::Insert,i-1)) + params[XX],
+						load(cell(j,Definitions::Delete,i-1)) + params[XY]));
+			}
+		}
+
+		for(l = 0; l < W && first+l < times.size(); l++)
+		{
+			result[first+l] = (LogSumExp::logSum(cell(n2,Definitions::Match,n1)[l], cell(n2,Definitions::Insert,n1)[l],
+					cell(n2,Definitions::Delete,n1)[l]) + log(xi)) * -1.0;
+			DUMP("Forward batch time " << times[first+l] << " lnL " << -result[first+l]);
+		}
+
+		//the next batch of times starts from clean columns
+		for(j = std::max(0, n2-1); j <= n2; j++)
+			clearColumn(j);
+	}
+	ws.releaseColumns<double>();
+
+	this->setTotalLikelihood(result.back() * -1.0);
+
+	return result;
+}
+
 } /* namespace EBC */
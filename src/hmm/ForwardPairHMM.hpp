@@ -22,6 +22,7 @@
 #define FORWARDPAIRHMM_HPP_
 
 #include "hmm/EvolutionaryPairHMM.hpp"
+#include "hmm/AmbiguousRunTransfer.hpp"
 
 
 namespace EBC
@@ -35,7 +36,85 @@ protected:
 	vector<double> userIndelParameters;
 	vector<double> userSubstParameters;
 
+	Definitions::ForwardKernelType kernel;
+
+	//a run of fully ambiguous symbols, dp rows (seq1) or columns (seq2) first to last
+	struct AmbiguousRun
+	{
+		int first, last;
+		AmbiguousRunTransfer transfer;
+		//crossed by the transfer in the current run of the kernel
+		bool used;
+		//row runs - row first-1 of every column and the log2 of its scale over the emissions of the columns so far
+		vector<double> entry[Definitions::stateCount];
+		vector<double> entryLog2;
+
+		AmbiguousRun(int f, int l, Definitions::StateId stay) : first(f), last(l), transfer(stay), used(false) {}
+	};
+
+	vector<AmbiguousRun> rowRuns;
+	vector<AmbiguousRun> columnRuns;
+
+	//runs of at least ambiguousRunMinLength fully ambiguous symbols of seq, the stay state moves along the other sequence
+	void findAmbiguousRuns(vector<SequenceElement*>* seq, Definitions::StateId stay, vector<AmbiguousRun>& runs);
+
+	//marks the runs the transfer crosses with fewer operations than the dp and calculates their kernels
+	void prepareAmbiguousRuns(vector<int>* colLo, vector<int>* colHi, const double trans[Definitions::stateCount][Definitions::stateCount]);
+
+	//cell by cell recursion over the DP matrices
+	double runScalar();
+
+	template<class MatrixType, bool Ambiguous>
+	double runScalarKernel();
+
+	//anti-diagonal recursion, whole diagonals of M/X/Y computed in SIMD lanes
+	double runWavefront();
+
+#if defined(__AVX__)
+	//column recursion over {M,X,Y,pad} interleaved cells, the three states of a cell share one ymm register.
+	//Covers the union of the state ranges in one loop, suits narrow bands with short diagonals
+	double runInterleaved();
+#endif
+
+	//tiles of the matrix on the spare threads, in anti-diagonal order of the tiles. Cells within a tile
+	//go column by column, tiles hand their last row and column on through edge buffers
+	double runTiled();
+
+	//linear probabilities with power of two rescaling of every column.
+	//Crosses long runs of fully ambiguous symbols in one transfer step if nothing is written back
+	double runScaled();
+
+	//scaled kernels in Real precision, scale factors and the final sums stay in double
+	template<typename Real>
+	double runScaledKernel();
+
+	template<typename Real>
+	double runDerivativesKernel(double& first, double& second);
+
 public:
+
+	//log emissions of sequences s1 and s2 and their symbol pair table under ptm, symX holds row offsets into the table
+	//optionally the linear space first and second time derivatives of the pair table
+	static void getEmissionProfiles(vector<SequenceElement*>* s1, vector<SequenceElement*>* s2, PMatrixDouble* ptm,
+			vector<double>& emisX, vector<double>& emisY, vector<double>& emisM,
+			vector<unsigned int>& symX, vector<unsigned int>& symY,
+			vector<double>* emisMDt = nullptr, vector<double>* emisMDt2 = nullptr);
+
+protected:
+
+	//emission profiles of this pair under the current P(t)
+	void getEmissionProfiles(vector<double>& emisX, vector<double>& emisY, vector<double>& emisM,
+			vector<unsigned int>& symX, vector<unsigned int>& symY,
+			vector<double>* emisMDt = nullptr, vector<double>* emisMDt2 = nullptr);
+
+public:
+
+	//kernel picked by newly created forward HMMs
+	static Definitions::ForwardKernelType defaultKernel;
+
+	//runs of fully ambiguous symbols of newly created forward HMMs
+	static Definitions::AmbiguousRunMode defaultAmbiguousRunMode;
+
 	ForwardPairHMM(vector<SequenceElement*>* s1, vector<SequenceElement*>* s2,
 			SubstitutionModelBase* smdl, IndelModel* imdl,
 			Definitions::DpMatrixType mt, Band* bandObj = nullptr, bool useEquilibriumProbabilities = true);
@@ -44,6 +123,29 @@ public:
 
 	double runAlgorithm();
 
+	//-lnL at the current divergence time, first and second derivative of -lnL with respect to the time.
+	//Likelihood only, nothing is written to the dp matrices
+	double runAlgorithmWithDerivatives(double& first, double& second);
+
+	//false for long pairs when enough threads are configured - the derivative kernel rescales whole
+	//columns and runs on one thread, Brent on tiled forward runs finishes sooner. Depends on the
+	//configuration only, so the distances do not change with the thread timing
+	bool providesDerivatives();
+
+	//-lnL for every divergence time in one banded sweep, the times share SIMD lanes.
+	//Leaves the models set to times.back()
+	vector<double> runAlgorithmBatch(const vector<double>& times);
+
+	inline void setKernel(Definitions::ForwardKernelType kt)
+	{
+		this->kernel = kt;
+	}
+
+	inline Definitions::ForwardKernelType getKernel() const
+	{
+		return kernel;
+	}
+
 };
 
 } /* namespace EBC */
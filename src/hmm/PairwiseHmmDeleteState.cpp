@@ -35,7 +35,10 @@ PairwiseHmmDeleteState::PairwiseHmmDeleteState(unsigned int x, unsigned int y)
 
 PairwiseHmmDeleteState::PairwiseHmmDeleteState(DpMatrixBase *matrix)
 {
+	this->rows = matrix->getXSize();
+	this->cols = matrix->getYSize();
 	this->dpMatrix = matrix;
+	stateId = Definitions::StateId::Delete;
 	//initializeData();
 }
 
@@ -35,7 +35,10 @@ PairwiseHmmInsertState::PairwiseHmmInsertState(unsigned int x, unsigned int y)
 
 PairwiseHmmInsertState::PairwiseHmmInsertState(DpMatrixBase *matrix)
 {
+	this->rows = matrix->getXSize();
+	this->cols = matrix->getYSize();
 	this->dpMatrix = matrix;
+	stateId = Definitions::StateId::Insert;
 	//initializeData();
 }
 
@@ -35,7 +35,10 @@ PairwiseHmmMatchState::PairwiseHmmMatchState(unsigned int x, unsigned int y)
 
 PairwiseHmmMatchState::PairwiseHmmMatchState(DpMatrixBase *matrix)
 {
+	this->rows = matrix->getXSize();
+	this->cols = matrix->getYSize();
 	this->dpMatrix = matrix;
+	stateId = Definitions::StateId::Match;
 	//initializeData();
 }
 
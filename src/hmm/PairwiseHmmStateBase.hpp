@@ -61,6 +61,20 @@ public:
 		this->dpMatrix->setValue(row,column,data);
 	}
 
+	//Statically bound access for kernels instantiated on the concrete matrix type.
+	//The qualified call bypasses the vtable so the accessor can be inlined.
+	template<class MatrixType>
+	inline double getValueAt(unsigned int row, unsigned int column)
+	{
+		return static_cast<MatrixType*>(this->dpMatrix)->MatrixType::valueAt(row,column);
+	}
+
+	template<class MatrixType>
+	inline void setValueAt(unsigned int row, unsigned int column, double data)
+	{
+		static_cast<MatrixType*>(this->dpMatrix)->MatrixType::setValue(row,column,data);
+	}
+
 	virtual ~PairwiseHmmStateBase()
 	{
 		delete this->dpMatrix;
@@ -0,0 +1,51 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+
+#include "hmm/TracebackMatrix.hpp"
+
+namespace EBC
+{
+
+TracebackMatrix::TracebackMatrix(unsigned int xS, unsigned int yS, const vector<int>& lo, const vector<int>& hi) :
+		xSize(xS), ySize(yS), columnLo(lo), columnHi(hi), columnOffset(yS)
+{
+	long cells = 0;
+
+	for(unsigned int j = 0; j < ySize; j++)
+	{
+		if (columnLo[j] > columnHi[j])
+		{
+			columnLo[j] = 1;
+			columnHi[j] = 0;
+		}
+		columnOffset[j] = cells - columnLo[j];
+		cells += columnHi[j] - columnLo[j] + 1;
+	}
+
+	data.assign((cells + 3) / 4, 0);
+
+	DUMP("Traceback matrix " << xSize << "x" << ySize << " stores " << cells << " cells in " << data.size() << " bytes");
+}
+
+TracebackMatrix::~TracebackMatrix()
+{
+}
+
+} /* namespace EBC */
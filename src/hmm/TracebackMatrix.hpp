@@ -0,0 +1,81 @@
+//==============================================================================
+// Pair-HMM phylogenetic tree estimator
+// 
+// Copyright (c) 2015 Marcin Bogusz.
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses>.
+//==============================================================================
+
+
+#ifndef TRACEBACKMATRIX_H_
+#define TRACEBACKMATRIX_H_
+
+#include "core/Definitions.hpp"
+
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+namespace EBC
+{
+
+//2 bits per cell traceback codes (a StateId) for the rows lo..hi of every column,
+//4 cells per byte. Cells outside the stored rows read as Match.
+class TracebackMatrix
+{
+
+protected:
+
+	unsigned int xSize;
+	unsigned int ySize;
+
+	vector<int> columnLo;
+	vector<int> columnHi;
+
+	//cell index of row 0 of every column (may point before the column start)
+	vector<long> columnOffset;
+
+	vector<uint8_t> data;
+
+public:
+
+	//stored rows of every column, empty columns have lo > hi
+	TracebackMatrix(unsigned int xSize, unsigned int ySize, const vector<int>& lo, const vector<int>& hi);
+
+	virtual ~TracebackMatrix();
+
+	//every cell is set at most once
+	inline void setCode(unsigned int i, unsigned int j, Definitions::StateId code)
+	{
+		long cell = columnOffset[j] + i;
+		data[cell >> 2] |= static_cast<uint8_t>(code) << ((cell & 3) << 1);
+	}
+
+	inline Definitions::StateId getCode(unsigned int i, unsigned int j)
+	{
+		if (static_cast<int>(i) < columnLo[j] || static_cast<int>(i) > columnHi[j])
+			return Definitions::Match;
+		long cell = columnOffset[j] + i;
+		return static_cast<Definitions::StateId>((data[cell >> 2] >> ((cell & 3) << 1)) & 3);
+	}
+
+	inline size_t getStoredBytes()
+	{
+		return data.size();
+	}
+};
+
+} /* namespace EBC */
+#endif /* TRACEBACKMATRIX_H_ */
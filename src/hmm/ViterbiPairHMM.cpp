@@ -19,7 +19,13 @@
 
 
 #include "core/Definitions.hpp"
+#include "core/HmmException.hpp"
+#include "core/VectorMaths.hpp"
 #include "hmm/ViterbiPairHMM.hpp"
+#include "hmm/ForwardPairHMM.hpp"
+#include "hmm/DpMatrixFull.hpp"
+#include "hmm/DpMatrixFloat.hpp"
+#include "hmm/TracebackMatrix.hpp"
 #include <algorithm>
 
 namespace EBC
@@ -84,6 +90,19 @@ double ViterbiPairHMM::getMax(double m, double x, double y, unsigned int i, unsi
 }
 
 double ViterbiPairHMM::runAlgorithm()
+{
+	//likelihood only storage, no traceback possible - integer scores
+	if (matrixType == Definitions::DpMatrixType::Banded || matrixType == Definitions::DpMatrixType::Rolling)
+		return runQuantized();
+	if (matrixType == Definitions::DpMatrixType::Limited)
+		return ambiguousSequences ? runKernel<DpMatrixLoMem, true>() : runKernel<DpMatrixLoMem, false>();
+	if (matrixType == Definitions::DpMatrixType::FullFloat)
+		return ambiguousSequences ? runKernel<DpMatrixFloat, true>() : runKernel<DpMatrixFloat, false>();
+	return ambiguousSequences ? runKernel<DpMatrixFull, true>() : runKernel<DpMatrixFull, false>();
+}
+
+template<class MatrixType, bool Ambiguous>
+double ViterbiPairHMM::runKernel()
 {
 	unsigned int i,j,k,l;
 
@@ -93,6 +112,8 @@ double ViterbiPairHMM::runAlgorithm()
 	double emissionX;
 	double emissionY;
 
+	typedef EmissionPolicy<Ambiguous> Emission;
+
 	DUMP("Viterbi equilibriums : PiM\t" << piM << "\tPiI\t" << piI << "\tPiD\t" << piD);
 
 	M->initializeData(this->piM);
@@ -101,46 +122,47 @@ double ViterbiPairHMM::runAlgorithm()
 
 		//while (i != xSize && j != ySize)
 
-	for (i = 0; i<xSize; i++)
+	//column by column, the full matrices are column-major
+	for (j = 0; j<ySize; j++)
 	{
-		for (j = 0; j<ySize; j++)
+		for (i = 0; i<xSize; i++)
 		{
 			if(i!=0)
 			{
 
 				k = i-1;
-				emissionX = ptmatrix->getLogEquilibriumFreq((*seq1)[i-1]->getMatrixIndex());
-				xm = M->getValueAt(k,j) + X->getTransitionProbabilityFromMatch();
-				xx = X->getValueAt(k,j) + X->getTransitionProbabilityFromInsert();
-				xy = Y->getValueAt(k,j) + X->getTransitionProbabilityFromDelete();
+				emissionX = Emission::single(ptmatrix, (*seq1)[i-1]);
+				xm = M->getValueAt<MatrixType>(k,j) + X->getTransitionProbabilityFromMatch();
+				xx = X->getValueAt<MatrixType>(k,j) + X->getTransitionProbabilityFromInsert();
+				xy = Y->getValueAt<MatrixType>(k,j) + X->getTransitionProbabilityFromDelete();
 
-				X->setValueAt(i,j,getMax(xm,xx,xy,i,j,X) + emissionX);
+				X->setValueAt<MatrixType>(i,j,getMax(xm,xx,xy,i,j,X) + emissionX);
 			}
 			if(j!=0)
 			{
 				k = j-1;
-				emissionY = ptmatrix->getLogEquilibriumFreq((*seq2)[j-1]->getMatrixIndex());
-				ym = M->getValueAt(i,k) + Y->getTransitionProbabilityFromMatch();
-				yx = X->getValueAt(i,k) + Y->getTransitionProbabilityFromInsert();
-				yy = Y->getValueAt(i,k) + Y->getTransitionProbabilityFromDelete();
-				Y->setValueAt(i,j,getMax(ym,yx,yy,i,j,Y) + emissionY);
+				emissionY = Emission::single(ptmatrix, (*seq2)[j-1]);
+				ym = M->getValueAt<MatrixType>(i,k) + Y->getTransitionProbabilityFromMatch();
+				yx = X->getValueAt<MatrixType>(i,k) + Y->getTransitionProbabilityFromInsert();
+				yy = Y->getValueAt<MatrixType>(i,k) + Y->getTransitionProbabilityFromDelete();
+				Y->setValueAt<MatrixType>(i,j,getMax(ym,yx,yy,i,j,Y) + emissionY);
 			}
 
 			if(i!=0 && j!=0)
 			{
 				k = i-1;
 				l = j-1;
-				emissionM = ptmatrix->getLogPairTransition((*seq1)[i-1]->getMatrixIndex(), (*seq2)[j-1]->getMatrixIndex());
-				mm = M->getValueAt(k,l) + M->getTransitionProbabilityFromMatch();
-				mx = X->getValueAt(k,l) + M->getTransitionProbabilityFromInsert();
-				my = Y->getValueAt(k,l) + M->getTransitionProbabilityFromDelete();
-				M->setValueAt(i,j,getMax(mm,mx,my,i,j,M) + emissionM);
+				emissionM = Emission::pair(ptmatrix, (*seq1)[i-1], (*seq2)[j-1]);
+				mm = M->getValueAt<MatrixType>(k,l) + M->getTransitionProbabilityFromMatch();
+				mx = X->getValueAt<MatrixType>(k,l) + M->getTransitionProbabilityFromInsert();
+				my = Y->getValueAt<MatrixType>(k,l) + M->getTransitionProbabilityFromDelete();
+				M->setValueAt<MatrixType>(i,j,getMax(mm,mx,my,i,j,M) + emissionM);
 			}
 		}
 	}
-	mx = X->getValueAt(xSize-1,ySize-1);
-	my = Y->getValueAt(xSize-1,ySize-1);
-	mm = M->getValueAt(xSize-1,ySize-1);
+	mx = X->getValueAt<MatrixType>(xSize-1,ySize-1);
+	my = Y->getValueAt<MatrixType>(xSize-1,ySize-1);
+	mm = M->getValueAt<MatrixType>(xSize-1,ySize-1);
 
 /*
 	if(mm >=mx && mm >=my)
@@ -164,4 +186,410 @@ return (std::max(mm,std::max(mx,my)))*-1.0;
 }
 
 
+double ViterbiPairHMM::runAlgorithmWithAlignment()
+{
+	return ambiguousSequences ? runTracebackKernel<true>() : runTracebackKernel<false>();
+}
+
+Band* ViterbiPairHMM::createPathBand(int delta)
+{
+	if (pathLo.size() != ySize)
+		throw HmmException("ViterbiPairHMM : the path band needs the Viterbi path, run runAlgorithmWithAlignment first");
+
+	const int lastRow = xSize-1;
+	Band* pathBand = new Band(ySize);
+	for(unsigned int col = 0; col < ySize; col++)
+	{
+		int min = std::max(0, pathLo[col] - delta);
+		int max = std::min(lastRow, pathHi[col] + delta);
+		if (col == 0)
+		{
+			pathBand->setMatchRangeAt(0,-1,-1);
+			pathBand->setInsertRangeAt(0,0,max);
+			pathBand->setDeleteRangeAt(0,-1,-1);
+			continue;
+		}
+		pathBand->setMatchRangeAt(col,min+1,max);
+		pathBand->setInsertRangeAt(col,min+1,max);
+		pathBand->setDeleteRangeAt(col,min,max);
+	}
+	return pathBand;
+}
+
+template<bool Ambiguous>
+double ViterbiPairHMM::runTracebackKernel()
+{
+	const int n1 = xSize-1;
+	const int n2 = ySize-1;
+	const double minVal = Definitions::minMatrixLikelihood;
+	const unsigned int gapElem = this->substModel->getMatrixSize(); // last matrix element is the gap ID!
+
+	int i, j, s;
+	int lo, hi;
+
+	double emissionM, emissionX, emissionY;
+	double mm, mx, my;
+
+	Definitions::StateId from;
+
+	typedef EmissionPolicy<Ambiguous> Emission;
+
+	//same tie breaking as getMax
+	auto best = [&](double m, double x, double y) -> double
+	{
+		if (m > x && m > y)
+		{
+			from = Definitions::Match;
+			return m;
+		}
+		if (x > y)
+		{
+			from = Definitions::Insert;
+			return x;
+		}
+		from = Definitions::Delete;
+		return y;
+	};
+
+	vector<int> colLo[Definitions::stateCount];
+	vector<int> colHi[Definitions::stateCount];
+	getColumnRanges(colLo, colHi);
+
+	//predecessor state of every in-band cell, one traceback per state
+	TracebackMatrix traceM(xSize, ySize, colLo[Definitions::Match], colHi[Definitions::Match]);
+	TracebackMatrix traceX(xSize, ySize, colLo[Definitions::Insert], colHi[Definitions::Insert]);
+	TracebackMatrix traceY(xSize, ySize, colLo[Definitions::Delete], colHi[Definitions::Delete]);
+	TracebackMatrix* trace[Definitions::stateCount];
+	trace[Definitions::Match] = &traceM;
+	trace[Definitions::Insert] = &traceX;
+	trace[Definitions::Delete] = &traceY;
+
+	//scores roll over two columns per state
+	vector<double> columns(2 * Definitions::stateCount * xSize, minVal);
+	double* cur[Definitions::stateCount];
+	double* prev[Definitions::stateCount];
+	for(s = 0; s < Definitions::stateCount; s++)
+	{
+		cur[s] = columns.data() + (2*s)*xSize;
+		prev[s] = columns.data() + (2*s+1)*xSize;
+	}
+	int curLo = 0, curHi = 0;
+	int prevLo = 0, prevHi = -1;
+
+	cur[Definitions::Match][0] = this->piM;
+	cur[Definitions::Insert][0] = this->piI;
+	cur[Definitions::Delete][0] = this->piD;
+
+	//1st column, X only below the (0,0) start cell
+	for(i = colLo[Definitions::Insert][0]; i <= colHi[Definitions::Insert][0]; i++)
+	{
+		emissionX = Emission::single(ptmatrix, (*seq1)[i-1]);
+		cur[Definitions::Insert][i] = best(cur[Definitions::Match][i-1] + X->getTransitionProbabilityFromMatch(),
+				cur[Definitions::Insert][i-1] + X->getTransitionProbabilityFromInsert(),
+				cur[Definitions::Delete][i-1] + X->getTransitionProbabilityFromDelete()) + emissionX;
+		traceX.setCode(i, 0, from);
+		curHi = i;
+	}
+
+	for(j = 1; j <= n2; j++)
+	{
+		for(s = 0; s < Definitions::stateCount; s++)
+			std::swap(cur[s], prev[s]);
+		std::swap(curLo, prevLo);
+		std::swap(curHi, prevHi);
+
+		//drop what column j-2 left behind
+		for(s = 0; s < Definitions::stateCount; s++)
+			std::fill(cur[s] + curLo, cur[s] + curHi + 1, minVal);
+
+		lo = n1+1;
+		hi = -1;
+		for(s = 0; s < Definitions::stateCount; s++)
+		{
+			if (colLo[s][j] > colHi[s][j])
+				continue;
+			lo = std::min(lo, colLo[s][j]);
+			hi = std::max(hi, colHi[s][j]);
+		}
+		curLo = lo;
+		curHi = hi;
+
+		emissionY = Emission::single(ptmatrix, (*seq2)[j-1]);
+		for(i = colLo[Definitions::Delete][j]; i <= colHi[Definitions::Delete][j]; i++)
+		{
+			cur[Definitions::Delete][i] = best(prev[Definitions::Match][i] + Y->getTransitionProbabilityFromMatch(),
+					prev[Definitions::Insert][i] + Y->getTransitionProbabilityFromInsert(),
+					prev[Definitions::Delete][i] + Y->getTransitionProbabilityFromDelete()) + emissionY;
+			traceY.setCode(i, j, from);
+		}
+
+		for(i = colLo[Definitions::Match][j]; i <= colHi[Definitions::Match][j]; i++)
+		{
+			emissionM = Emission::pair(ptmatrix, (*seq1)[i-1], (*seq2)[j-1]);
+			cur[Definitions::Match][i] = best(prev[Definitions::Match][i-1] + M->getTransitionProbabilityFromMatch(),
+					prev[Definitions::Insert][i-1] + M->getTransitionProbabilityFromInsert(),
+					prev[Definitions::Delete][i-1] + M->getTransitionProbabilityFromDelete()) + emissionM;
+			traceM.setCode(i, j, from);
+		}
+
+		for(i = colLo[Definitions::Insert][j]; i <= colHi[Definitions::Insert][j]; i++)
+		{
+			emissionX = Emission::single(ptmatrix, (*seq1)[i-1]);
+			cur[Definitions::Insert][i] = best(cur[Definitions::Match][i-1] + X->getTransitionProbabilityFromMatch(),
+					cur[Definitions::Insert][i-1] + X->getTransitionProbabilityFromInsert(),
+					cur[Definitions::Delete][i-1] + X->getTransitionProbabilityFromDelete()) + emissionX;
+			traceX.setCode(i, j, from);
+		}
+	}
+
+	mm = cur[Definitions::Match][n1];
+	mx = cur[Definitions::Insert][n1];
+	my = cur[Definitions::Delete][n1];
+
+	//walk the codes back from the best end state, the first row only has Y and the first column only X
+	Definitions::StateId state = (mm >= mx && mm >= my) ? Definitions::Match : (mx >= my ? Definitions::Insert : Definitions::Delete);
+	alignment.clear();
+	pathLo.assign(ySize, n1+1);
+	pathHi.assign(ySize, -1);
+	i = n1;
+	j = n2;
+	while(i > 0 || j > 0)
+	{
+		pathLo[j] = std::min(pathLo[j], i);
+		pathHi[j] = std::max(pathHi[j], i);
+		if (i == 0)
+			state = Definitions::Delete;
+		else if (j == 0)
+			state = Definitions::Insert;
+
+		from = trace[state]->getCode(i,j);
+		switch(state)
+		{
+		case Definitions::Match :
+			alignment.push_back(std::make_pair((*seq1)[i-1]->getMatrixIndex(), (*seq2)[j-1]->getMatrixIndex()));
+			i--;
+			j--;
+			break;
+		case Definitions::Insert :
+			alignment.push_back(std::make_pair((*seq1)[i-1]->getMatrixIndex(), gapElem));
+			i--;
+			break;
+		default :
+			alignment.push_back(std::make_pair(gapElem, (*seq2)[j-1]->getMatrixIndex()));
+			j--;
+		}
+		state = from;
+	}
+	reverse(alignment.begin(), alignment.end());
+	pathLo[0] = 0;
+
+	DUMP("Viterbi with traceback M, X, Y " << mm << "\t" << mx << "\t" << my << " alignment length " << alignment.size());
+
+	return (std::max(mm,std::max(mx,my)))*-1.0;
+}
+
+double ViterbiPairHMM::runQuantized()
+{
+	using VectorMaths::vint;
+	using VectorMaths::load;
+	using VectorMaths::store;
+	using VectorMaths::broadcastInt;
+
+	const int W = VectorMaths::intLanes;
+	const int n1 = xSize-1;
+	const int n2 = ySize-1;
+	const double minVal = Definitions::minMatrixLikelihood;
+	//below any reachable score, adding a few transitions can not overflow
+	const int negInf = -2 * Definitions::viterbiScoreRange;
+
+	int i,j,s,k;
+	int lo, hi;
+
+	DpWorkspace& ws = getWorkspace();
+
+	vector<int>* colLo = &ws.getBuffer<int>(DpWorkspace::ColumnLo);
+	vector<int>* colHi = &ws.getBuffer<int>(DpWorkspace::ColumnHi);
+	getColumnRanges(colLo, colHi);
+
+	vector<double>& emisX = ws.getBuffer<double>(DpWorkspace::EmissionX);
+	vector<double>& emisY = ws.getBuffer<double>(DpWorkspace::EmissionY);
+	vector<double>& emisM = ws.getBuffer<double>(DpWorkspace::EmissionM);
+	vector<unsigned int>& symX = ws.getBuffer<unsigned int>(DpWorkspace::SymbolsX);
+	vector<unsigned int>& symY = ws.getBuffer<unsigned int>(DpWorkspace::SymbolsY);
+	ForwardPairHMM::getEmissionProfiles(seq1, seq2, ptmatrix, emisX, emisY, emisM, symX, symY);
+	const unsigned int symbolCount = (unsigned int) lround(sqrt((double) emisM.size()));
+
+	PairwiseHmmStateBase* states[Definitions::stateCount];
+	states[Definitions::Match] = M;
+	states[Definitions::Insert] = X;
+	states[Definitions::Delete] = Y;
+
+	double trans[Definitions::stateCount][Definitions::stateCount];
+	for(s = 0; s < Definitions::stateCount; s++)
+	{
+		trans[s][Definitions::Match] = states[s]->getTransitionProbabilityFromMatch();
+		trans[s][Definitions::Insert] = states[s]->getTransitionProbabilityFromInsert();
+		trans[s][Definitions::Delete] = states[s]->getTransitionProbabilityFromDelete();
+	}
+	const double start[Definitions::stateCount] = {piM, piI, piD};
+
+	//finest power of two scale that keeps the worst possible path score within viterbiScoreRange
+	double worstTrans = 0, worstEmission = 0, worstStart = 0;
+	for(s = 0; s < Definitions::stateCount; s++)
+	{
+		for(k = 0; k < Definitions::stateCount; k++)
+			if (trans[s][k] > minVal)
+				worstTrans = std::max(worstTrans, -trans[s][k]);
+		if (start[s] > minVal)
+			worstStart = std::max(worstStart, -start[s]);
+	}
+	for(auto vec : {&emisX, &emisY, &emisM})
+		for(auto val : *vec)
+			if (val > minVal)
+				worstEmission = std::max(worstEmission, -val);
+
+	const double bound = (n1 + n2 + 1) * (worstTrans + worstEmission) + worstStart;
+	double scale = Definitions::viterbiScoreScale;
+	while (scale * bound > Definitions::viterbiScoreRange)
+		scale /= 2;
+
+	auto quantize = [&](double val)
+	{
+		return val <= minVal ? negInf : (int) lround(val * scale);
+	};
+
+	int qt[Definitions::stateCount][Definitions::stateCount];
+	for(s = 0; s < Definitions::stateCount; s++)
+		for(k = 0; k < Definitions::stateCount; k++)
+			qt[s][k] = quantize(trans[s][k]);
+
+	vector<int>& qX = ws.getBuffer<int>(DpWorkspace::PaddedX);
+	qX.assign(xSize+W, negInf);
+	for(i = 1; i <= n1; i++)
+		qX[i] = quantize(emisX[i]);
+
+	//query profile - match emissions of every row against each symbol of the 2nd sequence
+	vector<int>& profile = ws.getBuffer<int>(DpWorkspace::Profile);
+	profile.assign(symbolCount * (xSize+W), negInf);
+	for(unsigned int b = 0; b < symbolCount; b++)
+		for(i = 1; i <= n1; i++)
+			profile[b*(xSize+W) + i] = quantize(emisM[symX[i] + b]);
+
+	int* columns = ws.getColumns<int>(Definitions::stateCount * 2 * (xSize+W), negInf);
+	int* cur[Definitions::stateCount];
+	int* prev[Definitions::stateCount];
+	int curLo = 0, curHi = -1;
+	int prevLo = 0, prevHi = -1;
+
+	for(s = 0; s < Definitions::stateCount; s++)
+	{
+		cur[s] = columns + (2*s)*(xSize+W);
+		prev[s] = columns + (2*s+1)*(xSize+W);
+	}
+
+	const vint negV = broadcastInt(negInf);
+
+	//cells of state st from rows r+off of the source columns src, emissions em[r], vector body and scalar tail
+	auto maxPlus = [&](int st, int* (&src)[Definitions::stateCount], int off, const int* em, int from, int to)
+	{
+		const vint tm = broadcastInt(qt[st][Definitions::Match]);
+		const vint tx = broadcastInt(qt[st][Definitions::Insert]);
+		const vint ty = broadcastInt(qt[st][Definitions::Delete]);
+		int r = from;
+		for(; r + W - 1 <= to; r += W)
+		{
+			vint val = VectorMaths::max(VectorMaths::max(load(src[Definitions::Match]+r+off) + tm,
+					load(src[Definitions::Insert]+r+off) + tx), load(src[Definitions::Delete]+r+off) + ty);
+			store(cur[st]+r, VectorMaths::max(val + load(em+r), negV));
+		}
+		for(; r <= to; r++)
+		{
+			int val = std::max(std::max(src[Definitions::Match][r+off] + qt[st][Definitions::Match],
+					src[Definitions::Insert][r+off] + qt[st][Definitions::Insert]), src[Definitions::Delete][r+off] + qt[st][Definitions::Delete]);
+			cur[st][r] = std::max(val + em[r], negInf);
+		}
+	};
+
+	//Insert reads its own column - M and D sources in lanes, then the serial X to X pass
+	auto insertColumn = [&](int from, int to)
+	{
+		const int xm = qt[Definitions::Insert][Definitions::Match];
+		const int xx = qt[Definitions::Insert][Definitions::Insert];
+		const int xy = qt[Definitions::Insert][Definitions::Delete];
+		const vint vxm = broadcastInt(xm);
+		const vint vxy = broadcastInt(xy);
+		int* curX = cur[Definitions::Insert];
+		int r = from;
+		for(; r + W - 1 <= to; r += W)
+		{
+			vint val = VectorMaths::max(load(cur[Definitions::Match]+r-1) + vxm, load(cur[Definitions::Delete]+r-1) + vxy);
+			store(curX+r, val + load(qX.data()+r));
+		}
+		for(; r <= to; r++)
+			curX[r] = std::max(cur[Definitions::Match][r-1] + xm, cur[Definitions::Delete][r-1] + xy) + qX[r];
+		for(r = from; r <= to; r++)
+			curX[r] = std::max(std::max(curX[r], curX[r-1] + xx + qX[r]), negInf);
+	};
+
+	//1st column, X only below the (0,0) start cell
+	cur[Definitions::Match][0] = quantize(piM);
+	cur[Definitions::Insert][0] = quantize(piI);
+	cur[Definitions::Delete][0] = quantize(piD);
+	curLo = 0;
+	curHi = std::max(0, colHi[Definitions::Insert][0]);
+
+	insertColumn(colLo[Definitions::Insert][0], colHi[Definitions::Insert][0]);
+
+	vector<int>& qY = ws.getBuffer<int>(DpWorkspace::PaddedY);
+	qY.assign(xSize+W, negInf);
+	for(j = 1; j <= n2; j++)
+	{
+		for(s = 0; s < Definitions::stateCount; s++)
+			std::swap(cur[s], prev[s]);
+		std::swap(curLo, prevLo);
+		std::swap(curHi, prevHi);
+
+		//drop what column j-2 left behind
+		for(s = 0; s < Definitions::stateCount; s++)
+			std::fill(cur[s] + curLo, cur[s] + curHi + 1, negInf);
+
+		lo = n1+1;
+		hi = -1;
+		for(s = 0; s < Definitions::stateCount; s++)
+		{
+			if (colLo[s][j] > colHi[s][j])
+				continue;
+			lo = std::min(lo, colLo[s][j]);
+			hi = std::max(hi, colHi[s][j]);
+		}
+		curLo = lo;
+		curHi = hi;
+
+		//the delete emission is constant down the column
+		std::fill(qY.begin() + colLo[Definitions::Delete][j], qY.begin() + colHi[Definitions::Delete][j] + 1, quantize(emisY[j]));
+		maxPlus(Definitions::Delete, prev, 0, qY.data(), colLo[Definitions::Delete][j], colHi[Definitions::Delete][j]);
+
+		maxPlus(Definitions::Match, prev, -1, profile.data() + symY[j]*(xSize+W), colLo[Definitions::Match][j], colHi[Definitions::Match][j]);
+
+		insertColumn(colLo[Definitions::Insert][j], colHi[Definitions::Insert][j]);
+	}
+
+	int best = std::max(cur[Definitions::Match][n1], std::max(cur[Definitions::Insert][n1], cur[Definitions::Delete][n1]));
+	double lnl = best <= negInf / 2 ? minVal : best / scale;
+
+	//only the last two columns hold anything
+	for(s = 0; s < Definitions::stateCount; s++)
+	{
+		std::fill(cur[s] + curLo, cur[s] + curHi + 1, negInf);
+		std::fill(prev[s] + prevLo, prev[s] + prevHi + 1, negInf);
+	}
+	ws.releaseColumns<int>();
+
+	this->setTotalLikelihood(lnl);
+
+	DUMP("Integer Viterbi score " << best << " at scale " << scale << " lnl " << lnl);
+
+	return lnl * -1.0;
+}
+
 } /* namespace EBC */
@@ -36,8 +36,23 @@ protected:
 
 	vector<std::pair<unsigned int, unsigned int> > alignment;
 
+	//first and last row of the Viterbi path in every column
+	vector<int> pathLo;
+	vector<int> pathHi;
+
 	double getMax(double m, double x, double y, unsigned int i, unsigned int j, PairwiseHmmStateBase* state);
 
+	template<class MatrixType, bool Ambiguous>
+	double runKernel();
+
+	//banded max-plus recursion on int32 scores, lanes of VectorMaths::vint along the column.
+	//Score only - nothing is written to the dp matrices
+	double runQuantized();
+
+	//banded recursion over two score columns per state, the predecessor of every cell kept in 2 bits
+	template<bool Ambiguous>
+	double runTracebackKernel();
+
 public:
 	ViterbiPairHMM(vector<SequenceElement*>* s1, vector<SequenceElement*>* s2,
 			SubstitutionModelBase* smdl, IndelModel* imdl,
@@ -47,8 +62,22 @@ public:
 
 	double runAlgorithm();
 
+	//-lnL of the Viterbi path in linear score memory, the path is left in the alignment.
+	//Nothing is written to the dp matrices
+	double runAlgorithmWithAlignment();
+
+	//matrix index pairs of the Viterbi alignment, the gap is the substitution matrix size
+	const vector<std::pair<unsigned int, unsigned int> >& getAlignment() const
+	{
+		return alignment;
+	}
+
+	//substitution part of the lnL of the Viterbi alignment, requires runAlgorithmWithAlignment
 	double getViterbiSubstitutionLikelihood();
 
+	//band of delta rows on both sides of the Viterbi path, requires runAlgorithmWithAlignment
+	Band* createPathBand(int delta);
+
 
 };
 
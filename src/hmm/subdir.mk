@@ -1,35 +1,62 @@
 # Add inputs and outputs from these tool invocations to the build variables 
 CPP_SRCS += \
+../src/hmm/AmbiguousRunTransfer.cpp \
 ../src/hmm/BackwardPairHMM.cpp \
+../src/hmm/BatchedForwardPairHMM.cpp \
+../src/hmm/CheckpointedPairHMM.cpp \
+../src/hmm/DpArena.cpp \
+../src/hmm/DpMatrixBanded.cpp \
+../src/hmm/DpMatrixFloat.cpp \
 ../src/hmm/DpMatrixFull.cpp \
 ../src/hmm/DpMatrixLoMem.cpp \
+../src/hmm/DpMatrixRolling.cpp \
+../src/hmm/DpWorkspace.cpp \
 ../src/hmm/EvolutionaryPairHMM.cpp \
 ../src/hmm/ForwardPairHMM.cpp \
 ../src/hmm/PairwiseHmmDeleteState.cpp \
 ../src/hmm/PairwiseHmmInsertState.cpp \
 ../src/hmm/PairwiseHmmMatchState.cpp \
+../src/hmm/TracebackMatrix.cpp \
 ../src/hmm/ViterbiPairHMM.cpp 
 
 OBJS += \
+./src/hmm/AmbiguousRunTransfer.o \
 ./src/hmm/BackwardPairHMM.o \
+./src/hmm/BatchedForwardPairHMM.o \
+./src/hmm/CheckpointedPairHMM.o \
+./src/hmm/DpArena.o \
+./src/hmm/DpMatrixBanded.o \
+./src/hmm/DpMatrixFloat.o \
 ./src/hmm/DpMatrixFull.o \
 ./src/hmm/DpMatrixLoMem.o \
+./src/hmm/DpMatrixRolling.o \
+./src/hmm/DpWorkspace.o \
 ./src/hmm/EvolutionaryPairHMM.o \
 ./src/hmm/ForwardPairHMM.o \
 ./src/hmm/PairwiseHmmDeleteState.o \
 ./src/hmm/PairwiseHmmInsertState.o \
 ./src/hmm/PairwiseHmmMatchState.o \
+./src/hmm/TracebackMatrix.o \
 ./src/hmm/ViterbiPairHMM.o 
 
 CPP_DEPS += \
+./src/hmm/AmbiguousRunTransfer.d \
 ./src/hmm/BackwardPairHMM.d \
+./src/hmm/BatchedForwardPairHMM.d \
+./src/hmm/CheckpointedPairHMM.d \
+./src/hmm/DpArena.d \
+./src/hmm/DpMatrixBanded.d \
+./src/hmm/DpMatrixFloat.d \
 ./src/hmm/DpMatrixFull.d \
 ./src/hmm/DpMatrixLoMem.d \
+./src/hmm/DpMatrixRolling.d \
+./src/hmm/DpWorkspace.d \
 ./src/hmm/EvolutionaryPairHMM.d \
 ./src/hmm/ForwardPairHMM.d \
 ./src/hmm/PairwiseHmmDeleteState.d \
 ./src/hmm/PairwiseHmmInsertState.d \
 ./src/hmm/PairwiseHmmMatchState.d \
+./src/hmm/TracebackMatrix.d \
 ./src/hmm/ViterbiPairHMM.d 
 
 
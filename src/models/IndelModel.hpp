@@ -51,6 +51,9 @@ public:
 	virtual double calculateGapOpening(double time) = 0;
 	virtual double calculateGapExtension(double time) = 0;
 
+	//first (order 1) or second (order 2) derivative of the gap opening probability with respect to time
+	virtual double calculateGapOpeningDerivative(double time, unsigned int order) = 0;
+
 
 	//set parameters - time + the rest of parameters
 	virtual void setParameters(double*) = 0;
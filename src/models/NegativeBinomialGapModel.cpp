@@ -47,6 +47,13 @@ double NegativeBinomialGapModel::calculateGapOpening(double time)
 	return 1.0-exp(NegLambdaT);
 }
 
+double NegativeBinomialGapModel::calculateGapOpeningDerivative(double time, unsigned int order)
+{
+	//d/dt (1 - e^-lt) = l e^-lt, d2/dt2 = -l^2 e^-lt
+	double expNegLambdaT = exp(-1.0*lambda*time);
+	return order == 1 ? lambda*expNegLambdaT : -1.0*lambda*lambda*expNegLambdaT;
+}
+
 double NegativeBinomialGapModel::calculateGapExtension(double time)
 {
 	return this->gapExtensionProbability;
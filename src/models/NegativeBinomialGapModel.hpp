@@ -41,6 +41,8 @@ public:
 	double calculateGapOpening(double time);
 	double calculateGapExtension(double time);
 
+	double calculateGapOpeningDerivative(double time, unsigned int order);
+
 	virtual ~NegativeBinomialGapModel();
 
 	void calculateGeometricProbability(double lambda, double t);
@@ -106,6 +106,20 @@ double* SubstitutionModelBase::calculatePt(double t, unsigned int rateCategory)
 	return matrix;
 }
 
+double* SubstitutionModelBase::calculatePtDerivative(double t, unsigned int order, unsigned int rateCategory)
+{
+	double *tmpRoots, *tmpUroots, *matrix;
+	double rate = gammaRates[rateCategory];
+	tmpRoots = maths->expLambdaT(roots, t*rate, matrixSize);
+	for(unsigned int i = 0; i < matrixSize; i++)
+		tmpRoots[i] *= pow(roots[i]*rate, order);
+	tmpUroots = maths->matrixByDiagonalMultiply(uMatrix, tmpRoots, matrixSize);
+	matrix = this->maths->matrixMultiply(tmpUroots, vMatrix, matrixSize);
+	delete[] tmpRoots;
+	delete[] tmpUroots;
+	return matrix;
+}
+
 void SubstitutionModelBase::setDiagonalMeans()
 {
 		unsigned int i,j;
@@ -176,16 +190,6 @@ void SubstitutionModelBase::setObservedFrequencies(double* observedFrequencies)
 	}
 }
 
-double SubstitutionModelBase::getEquilibriumFrequencies(unsigned int xi)
-{
-	return piFreqs[xi];
-}
-
-double SubstitutionModelBase::getLogEquilibriumFrequencies(unsigned int xi)
-{
-	return piLogFreqs[xi];
-}
-
 void SubstitutionModelBase::summarizeRates()
 {
 	if(this->rateCategories != 1)
@@ -115,15 +115,24 @@ public:
 
 	double* calculatePt(double time, unsigned int rateCategory = 0);
 
+	//order-th time derivative of P(t), U diag((l*r)^order * exp(l*r*t)) V
+	double* calculatePtDerivative(double time, unsigned int order, unsigned int rateCategory = 0);
+
 	virtual void setObservedFrequencies(double* observedFrequencies);
 
 	//double getPiXiPXiYi(unsigned int xi, unsigned int yi);
 
 	//double getPXiYi(unsigned int xi, unsigned int yi);
 
-	double getEquilibriumFrequencies(unsigned int xi);
+	inline double getEquilibriumFrequencies(unsigned int xi)
+	{
+		return piFreqs[xi];
+	}
 
-	double getLogEquilibriumFrequencies(unsigned int xi);
+	inline double getLogEquilibriumFrequencies(unsigned int xi)
+	{
+		return piLogFreqs[xi];
+	}
 
 	//double getSitePattern(unsigned int xi, unsigned int yi);
 
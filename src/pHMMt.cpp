@@ -21,6 +21,7 @@
 #include "core/Sequences.hpp"
 #include "core/HmmException.hpp"
 #include "core/BandingEstimator.hpp"
+#include "core/WavefrontScheduler.hpp"
 #include "core/BioNJ.hpp"
 #include <iostream>
 #include <fstream>
@@ -64,6 +65,18 @@ int main(int argc, char ** argv) {
 
 		IParser* parser = cmdReader->getParser();
 
+		ForwardPairHMM::defaultKernel = cmdReader->getForwardKernel();
+		EvolutionaryPairHMM::defaultPrecision = cmdReader->getPrecision();
+		EvolutionaryPairHMM::defaultPageMode = cmdReader->getPageMode();
+		BandingEstimator::shortPairMode = cmdReader->getShortPairMode();
+		BandingEstimator::comparePrecision = cmdReader->checkPrecision();
+		EvolutionaryPairHMM::defaultPosteriorMode = cmdReader->getPosteriorMode();
+		BandCalculator::nearIdenticalMode = cmdReader->getNearIdenticalMode();
+		ForwardPairHMM::defaultAmbiguousRunMode = cmdReader->getAmbiguousRunMode();
+		LogSumExp::setAccuracy(cmdReader->getLogSumAccuracy());
+		//the main thread runs the dp itself, the other threads may help with the tiles of long pairs
+		WavefrontScheduler::setThreadBudget(cmdReader->getThreadCount()-1);
+
 		//Remove gaps if the user provides a MSA file
 		bool removeGaps = true;
 
@@ -113,8 +126,9 @@ int main(int argc, char ** argv) {
 
 		cout << "Estimating pairwise distances..." << endl;
 
-		BandingEstimator* be = new BandingEstimator(Definitions::AlgorithmType::Forward, inputSeqs, cmdReader->getModelType() ,indelParams,
-				substParams, cmdReader->getOptimizationType(), cmdReader->getCategories(),alpha, tme->getGuideTree());
+		BandingEstimator* be = new BandingEstimator(cmdReader->getAlgorithm(), inputSeqs, cmdReader->getModelType() ,indelParams,
+				substParams, cmdReader->getOptimizationType(), cmdReader->getCategories(),alpha, tme->getGuideTree(),
+				cmdReader->getThreadCount(), cmdReader->getDivergenceOptimizer());
 		be->optimizePairByPair();
 
 